@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../macos/codec.h"
+#include "../macos/game.h"
+#include "../macos/replay.h"
+#include "archive.h"
+#include "cli.h"
+
+/**
+ * ARCHIVE
+ * ############################################################################
+ * Reads a replay's events into memory, then times codec.c compressing and decompressing them.
+ * MB/s are megabytes of the original replay file per second, so they compare directly with
+ * reading it from disk.
+ */
+
+struct EventList {
+  ReplayEvent* events;
+  long count;
+  long capacity;
+  uint32_t lastFrame;  // Of the end marker
+  long pieces;
+} typedef EventList;
+
+static void addEvent(EventList* list, const ReplayEvent* event) {
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 4096;
+    list->events = realloc(list->events, list->capacity * sizeof(ReplayEvent));
+  }
+  list->events[list->count++] = *event;
+}
+
+/**
+ * Collect the events, and play them to count pieces for the per-piece sizes
+ */
+static bool readEvents(char* bytes, long length, EventList* list) {
+  FILE* stream = fmemopen(bytes, length, "rb");
+  ReplayReader reader;
+  if (!stream || !replay_startReader(&reader, stream)) {
+    if (stream) fclose(stream);
+    return false;
+  }
+
+  GameInstance game;
+  game_init(&game);
+
+  ReplayEvent event;
+  while (replay_next(&reader, &event)) {
+    if (event.input == INPUT_RESTART) list->pieces += game.state.pieces;
+    replay_apply(&game, &event);
+    addEvent(list, &event);
+  }
+  list->pieces += game.state.pieces;
+  list->lastFrame = reader.frame;
+
+  fclose(stream);
+  return list->events != NULL;
+}
+
+static void compress(const EventList* list, FILE* file) {
+  CodecEncoder encoder;
+  if (!codec_startEncoder(&encoder, file)) {
+    fprintf(stderr, "archive: out of memory\n");
+    exit(1);
+  }
+  for (long i = 0; i < list->count; i++) {
+    codec_encode(&encoder, &list->events[i]);
+  }
+  codec_finishEncoder(&encoder, list->lastFrame);
+}
+
+/**
+ * Decompress, checking every event against the original
+ */
+static bool decompress(const EventList* list, char* bytes, size_t length) {
+  FILE* stream = fmemopen(bytes, length, "rb");
+  CodecDecoder decoder;
+  bool ok = stream && codec_startDecoder(&decoder, stream);
+
+  ReplayEvent event;
+  long i = 0;
+  while (ok && codec_decode(&decoder, &event)) {
+    const ReplayEvent* expected = &list->events[i];
+    ok = i < list->count && event.frame == expected->frame && event.input == expected->input
+      && event.seed == expected->seed;
+    i++;
+  }
+  ok = ok && i == list->count && decoder.finished && decoder.frame == list->lastFrame;
+
+  codec_finishDecoder(&decoder);
+  if (stream) fclose(stream);
+  return ok;
+}
+
+/**
+ * Decode until the decoder gives up. Corrupt input must end in false without finishing, and
+ * without crashing on the way
+ */
+static bool rejects(char* bytes, size_t length) {
+  FILE* stream = fmemopen(bytes, length, "rb");
+  if (!stream) return false;
+  CodecDecoder decoder;
+  ReplayEvent event;
+  if (codec_startDecoder(&decoder, stream)) {
+    while (codec_decode(&decoder, &event)) {}
+  }
+  bool rejected = !decoder.finished;
+  codec_finishDecoder(&decoder);
+  fclose(stream);
+  return rejected;
+}
+
+static size_t putVarint(char* out, uint64_t value) {
+  size_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  out[length++] = value;
+  return length;
+}
+
+/**
+ * A one-event file whose first context has the given symbols and frequencies, and whose other
+ * contexts are empty
+ */
+static size_t craftBlock(char* out, const int symbols[], const uint64_t frequencies[], int used) {
+  size_t length = 0;
+  memcpy(out, "NTRC", 4);
+  length += 4;
+  out[length++] = 1;  // Version
+  length += putVarint(out + length, 1);
+  for (int c = 0; c < CODEC_CONTEXTS; c++) {
+    if (c != INPUT_NONE) {
+      out[length++] = 0;
+      continue;
+    }
+    length += putVarint(out + length, used);
+    for (int i = 0; i < used; i++) {
+      out[length++] = symbols[i];
+      length += putVarint(out + length, frequencies[i]);
+    }
+  }
+  out[length++] = 0;  // No extra bytes
+  out[length++] = 4;  // Just the rANS state
+  memcpy(out + length, "\0\0\x80\0", 4);
+  length += 4;
+  out[length++] = 0;  // End of file
+  return length;
+}
+
+/**
+ * Check the decoder turns down the compressed file cut short at many points, then a set of
+ * crafted frequency tables. Returns the number of cases it accepted
+ */
+static int checkCorrupt(const char* compressed, size_t compressedLength) {
+  int accepted = 0;
+  char* bytes = malloc(compressedLength);
+  memcpy(bytes, compressed, compressedLength);
+  // The decoder stops at the quit event, so it never reads the final 0 and losing it is harmless
+  size_t end = compressedLength - 1;
+  size_t step = end / 256 + 1;
+  for (size_t length = 0; length < end; length += length + 16 < end ? step : 1) {
+    accepted += !rejects(bytes, length);
+  }
+  free(bytes);
+
+  const int symbols[][2] = { { 0, 1 }, { 3, 3 }, { 3, 4 }, { 3 }, { 0 } };
+  const uint64_t frequencies[][2] = {
+    { 2 << CODEC_SCALE_BITS, (1ull << 32) - (1 << CODEC_SCALE_BITS) },  // Adds up to SCALE in an int
+    { 1 << (CODEC_SCALE_BITS - 1), 1 << (CODEC_SCALE_BITS - 1) },       // The same symbol twice
+    { 0, 1 << CODEC_SCALE_BITS },                                      // A zero frequency
+    { 100 },                                                           // Short of SCALE
+    { 0 },                                                             // Nothing in the context used
+  };
+  const int used[] = { 2, 2, 2, 1, 0 };
+  for (size_t i = 0; i < sizeof(used) / sizeof(used[0]); i++) {
+    char crafted[128];
+    size_t length = craftBlock(crafted, symbols[i], frequencies[i], used[i]);
+    accepted += !rejects(crafted, length);
+  }
+  return accepted;
+}
+
+int archive_main(int argc, char* argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "archive: needs a replay file\n");
+    return 1;
+  }
+  long repeat = cli_argInt(argc, argv, "--repeat", 1);
+  const char* outPath = cli_argString(argc, argv, "--out", NULL);
+  if (repeat < 1) {
+    fprintf(stderr, "archive: --repeat must be positive\n");
+    return 1;
+  }
+
+  char* bytes;
+  long length;
+  EventList list = { 0 };
+  if (!cli_readFile(argv[1], &bytes, &length) || !readEvents(bytes, length, &list)) {
+    fprintf(stderr, "archive: can't read a replay from %s\n", argv[1]);
+    return 1;
+  }
+
+  char* compressed = NULL;
+  size_t compressedLength = 0;
+  uint64_t start = cli_nowNs();
+  for (long i = 0; i < repeat; i++) {
+    free(compressed);
+    FILE* stream = open_memstream(&compressed, &compressedLength);
+    compress(&list, stream);
+    fclose(stream);
+  }
+  double encodeSeconds = (cli_nowNs() - start) / 1e9 / repeat;
+
+  start = cli_nowNs();
+  bool ok = true;
+  for (long i = 0; i < repeat && ok; i++) {
+    ok = decompress(&list, compressed, compressedLength);
+  }
+  double decodeSeconds = (cli_nowNs() - start) / 1e9 / repeat;
+
+  double pieces = list.pieces ? list.pieces : 1;
+  printf("events       %ld\n", list.count);
+  printf("pieces       %ld\n", list.pieces);
+  printf("replay       %ld bytes, %.2f bytes/piece\n", length, length / pieces);
+  printf("compressed   %zu bytes, %.2f bytes/piece (%.1f%%)\n", compressedLength, compressedLength / pieces,
+    100.0 * compressedLength / length);
+  printf("encode       %.1f MB/s, %.1f M events/s\n", length / encodeSeconds / 1e6, list.count / encodeSeconds / 1e6);
+  printf("decode       %.1f MB/s, %.1f M events/s\n", length / decodeSeconds / 1e6, list.count / decodeSeconds / 1e6);
+  printf("round trip   %s\n", ok ? "ok" : "MISMATCH");
+
+  int accepted = checkCorrupt(compressed, compressedLength);
+  printf("corrupt      %s\n", accepted ? "ACCEPTED" : "rejected");
+  ok = ok && !accepted;
+
+  if (ok && outPath) {
+    FILE* out = fopen(outPath, "wb");
+    if (!out || fwrite(compressed, 1, compressedLength, out) != compressedLength) {
+      fprintf(stderr, "archive: can't write %s\n", outPath);
+      ok = false;
+    }
+    if (out) fclose(out);
+  }
+
+  free(compressed);
+  free(list.events);
+  free(bytes);
+  return ok ? 0 : 1;
+}
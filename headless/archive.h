@@ -0,0 +1,12 @@
+// Once-only wrapper
+#ifndef ARCHIVE_H_SEEN
+#define ARCHIVE_H_SEEN
+
+/**
+ * Compress a replay for archiving, check it decompresses to the same events, and report the size
+ * and speed of both directions
+ */
+int archive_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // ARCHIVE_H_SEEN
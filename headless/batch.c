@@ -0,0 +1,239 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../macos/game.h"
+#include "batch.h"
+#include "cli.h"
+#include "play.h"
+
+/**
+ * BATCH
+ * ############################################################################
+ * Spreads games across threads with work stealing.
+ *
+ * Games are numbered 0..N-1 and each thread starts with an even slice of that range. A thread's
+ * queue is a single atomic word holding [begin, end): the owner takes small chunks from the front,
+ * and idle threads steal the back half of someone else's range, so one long game can't strand the
+ * rest of its slice. Every update is one compare-and-swap, so there are no locks. Game numbers are
+ * never reused, so a range value can't come back after being emptied (no ABA).
+ *
+ * Stats are kept per thread in their own cache lines and summed after the threads are joined.
+ */
+
+#define MAX_THREADS 256
+
+#define RANGE_PACK(begin, end) (((uint64_t) (begin) << 32) | (uint32_t) (end))
+#define RANGE_BEGIN(range) ((uint32_t) ((range) >> 32))
+#define RANGE_END(range) ((uint32_t) (range))
+
+struct WorkQueue {
+  alignas(64) _Atomic uint64_t range;
+} typedef WorkQueue;
+
+struct BatchStats {
+  alignas(64) long games;
+  long pieces;
+  long frames;
+  long lines;
+  long steals;
+  uint64_t elapsedNs;
+} typedef BatchStats;
+
+struct BatchOptions {
+  long games;
+  int threads;
+  uint32_t chunk;
+  unsigned seed;
+  PlayOptions play;
+} typedef BatchOptions;
+
+struct Worker {
+  int id;
+  const BatchOptions* options;
+  WorkQueue* queues;
+  BatchStats* stats;
+  _Atomic long* remaining;
+} typedef Worker;
+
+/**
+ * Owner: take up to 'chunk' games from the front of the queue
+ */
+static bool queue_take(WorkQueue* queue, uint32_t chunk, uint32_t* begin, uint32_t* end) {
+  uint64_t range = atomic_load(&queue->range);
+  uint64_t next;
+  do {
+    uint32_t b = RANGE_BEGIN(range);
+    uint32_t e = RANGE_END(range);
+    if (b >= e) return false;
+
+    *begin = b;
+    *end = (e - b) > chunk ? b + chunk : e;
+    next = RANGE_PACK(*end, e);
+  } while (!atomic_compare_exchange_weak(&queue->range, &range, next));
+  return true;
+}
+
+/**
+ * Thief: take the back half of the queue (rounded up, so a single game can still be stolen)
+ */
+static bool queue_steal(WorkQueue* queue, uint32_t* begin, uint32_t* end) {
+  uint64_t range = atomic_load(&queue->range);
+  uint64_t next;
+  do {
+    uint32_t b = RANGE_BEGIN(range);
+    uint32_t e = RANGE_END(range);
+    if (b >= e) return false;
+
+    uint32_t half = (e - b + 1) / 2;
+    *begin = e - half;
+    *end = e;
+    next = RANGE_PACK(b, e - half);
+  } while (!atomic_compare_exchange_weak(&queue->range, &range, next));
+  return true;
+}
+
+/**
+ * Try every other queue once, starting from a random victim. Stolen work goes into our own queue
+ * (which is empty, or we wouldn't be stealing) so that others can steal from us in turn
+ */
+static bool stealWork(Worker* worker, unsigned* seed) {
+  int threads = worker->options->threads;
+  int start = rand_r(seed) % threads;
+  for (int i = 0; i < threads; i++) {
+    int victim = (start + i) % threads;
+    if (victim == worker->id) continue;
+
+    uint32_t begin, end;
+    if (queue_steal(&worker->queues[victim], &begin, &end)) {
+      atomic_store(&worker->queues[worker->id].range, RANGE_PACK(begin, end));
+      worker->stats->steals++;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void* runWorker(void* arg) {
+  Worker* worker = arg;
+  const BatchOptions* options = worker->options;
+  WorkQueue* queue = &worker->queues[worker->id];
+  BatchStats* stats = worker->stats;
+  unsigned stealSeed = options->seed ^ (worker->id * 0x9E3779B9u);
+  GameInstance game;
+  game_init(&game);
+
+  uint64_t start = cli_nowNs();
+  while (atomic_load(worker->remaining) > 0) {
+    uint32_t begin, end;
+    if (!queue_take(queue, options->chunk, &begin, &end)) {
+      // Nothing left locally. Work may still be in flight between queues, so keep looking until
+      // every game is done
+      if (!stealWork(worker, &stealSeed)) {
+        sched_yield();
+      }
+      continue;
+    }
+
+    for (uint32_t g = begin; g < end; g++) {
+      // Pieces and inputs depend only on the game number, not on which thread plays it
+      unsigned inputSeed = options->seed + g;
+      stats->frames += play_game(&game, &options->play, options->seed + g, &inputSeed);
+      stats->pieces += game.state.pieces;
+      stats->lines += game.state.clearedLines;
+      stats->games++;
+    }
+    atomic_fetch_sub(worker->remaining, end - begin);
+  }
+  stats->elapsedNs = cli_nowNs() - start;
+  return NULL;
+}
+
+static void printReport(const BatchOptions* options, const BatchStats* stats, uint64_t elapsedNs) {
+  BatchStats total = { 0 };
+  for (int t = 0; t < options->threads; t++) {
+    total.games += stats[t].games;
+    total.pieces += stats[t].pieces;
+    total.frames += stats[t].frames;
+    total.lines += stats[t].lines;
+    total.steals += stats[t].steals;
+  }
+
+  double seconds = elapsedNs / 1e9;
+  printf("threads      %d\n", options->threads);
+  printf("games        %ld\n", total.games);
+  printf("pieces       %ld\n", total.pieces);
+  printf("lines        %ld\n", total.lines);
+  printf("frames       %ld\n", total.frames);
+  printf("steals       %ld\n", total.steals);
+  printf("elapsed      %.3f s\n", seconds);
+  printf("games/s      %.0f\n", total.games / seconds);
+  printf("pieces/s     %.0f\n", total.pieces / seconds);
+
+  printf("\n%-8s %10s %12s %8s %10s %12s %12s\n",
+    "thread", "games", "pieces", "steals", "elapsed s", "games/s", "pieces/s");
+  for (int t = 0; t < options->threads; t++) {
+    double threadSeconds = stats[t].elapsedNs / 1e9;
+    printf("%-8d %10ld %12ld %8ld %10.3f %12.0f %12.0f\n",
+      t, stats[t].games, stats[t].pieces, stats[t].steals, threadSeconds,
+      stats[t].games / threadSeconds, stats[t].pieces / threadSeconds);
+  }
+}
+
+int batch_main(int argc, char* argv[]) {
+  BatchOptions options = {
+    .games = cli_argInt(argc, argv, "--games", 100000),
+    .threads = cli_argInt(argc, argv, "--threads", sysconf(_SC_NPROCESSORS_ONLN)),
+    .chunk = cli_argInt(argc, argv, "--chunk", 16),
+    .seed = cli_argInt(argc, argv, "--seed", 1),
+  };
+  if (!play_parseOptions(&options.play, argc, argv)) return 1;
+  if (options.games < 1 || options.games > UINT32_MAX) {
+    fprintf(stderr, "batch: --games must be between 1 and %u\n", UINT32_MAX);
+    return 1;
+  }
+  if (options.threads < 1 || options.threads > MAX_THREADS || options.chunk < 1) {
+    fprintf(stderr, "batch: --threads must be between 1 and %d, --chunk must be positive\n", MAX_THREADS);
+    return 1;
+  }
+
+  WorkQueue* queues = aligned_alloc(64, sizeof(WorkQueue) * options.threads);
+  BatchStats* stats = aligned_alloc(64, sizeof(BatchStats) * options.threads);
+  Worker workers[MAX_THREADS];
+  pthread_t threads[MAX_THREADS];
+  _Atomic long remaining = options.games;
+
+  // Even slices to begin with; stealing sorts out the imbalance
+  for (int t = 0; t < options.threads; t++) {
+    uint32_t begin = options.games * t / options.threads;
+    uint32_t end = options.games * (t + 1) / options.threads;
+    atomic_init(&queues[t].range, RANGE_PACK(begin, end));
+    stats[t] = (BatchStats) { 0 };
+    workers[t] = (Worker) {
+      .id = t,
+      .options = &options,
+      .queues = queues,
+      .stats = &stats[t],
+      .remaining = &remaining,
+    };
+  }
+
+  uint64_t start = cli_nowNs();
+  for (int t = 0; t < options.threads; t++) {
+    pthread_create(&threads[t], NULL, runWorker, &workers[t]);
+  }
+  for (int t = 0; t < options.threads; t++) {
+    pthread_join(threads[t], NULL);
+  }
+  uint64_t elapsed = cli_nowNs() - start;
+
+  printReport(&options, stats, elapsed);
+
+  free(queues);
+  free(stats);
+  return 0;
+}
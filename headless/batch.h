@@ -0,0 +1,11 @@
+// Once-only wrapper
+#ifndef BATCH_H_SEEN
+#define BATCH_H_SEEN
+
+/**
+ * Run games across every core and report throughput per thread
+ */
+int batch_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // BATCH_H_SEEN
@@ -0,0 +1,80 @@
+#include <stdio.h>
+
+#include "../macos/bot.h"
+#include "../macos/game.h"
+#include "bot.h"
+#include "cli.h"
+
+/**
+ * BOT
+ * ############################################################################
+ * Plays games with bot_play() from consecutive seeds, each to game over or --max-pieces. Times every
+ * decision, and reports lines per game with nodes (placements scored) per second, so it serves both
+ * to tune the bot and as a steady CPU load.
+ */
+
+struct BotTotals {
+  long pieces;
+  long lines;
+  long toppedOut;
+  uint64_t decideNs;
+  uint64_t slowestNs;
+} typedef BotTotals;
+
+int bot_main(int argc, char* argv[]) {
+  long games = cli_argInt(argc, argv, "--games", 10);
+  unsigned seed = cli_argInt(argc, argv, "--seed", 1);
+  long maxPieces = cli_argInt(argc, argv, "--max-pieces", 1000);
+  BotOptions options;
+  bot_defaultOptions(&options);
+  options.beamWidth = cli_argInt(argc, argv, "--beam", options.beamWidth);
+  options.lookahead = cli_argInt(argc, argv, "--lookahead", options.lookahead);
+  long tableKb = cli_argInt(argc, argv, "--table-kb", options.tableBytes / 1024);
+  options.tableBytes = tableKb > 0 ? tableKb * 1024 : 0;
+
+  static Bot bot;
+  if (games < 1 || maxPieces < 1 || tableKb < 0 || !bot_init(&bot, &options)) {
+    fprintf(stderr, "bot: --games and --max-pieces must be positive, --beam at least 1, --lookahead 0 to %d,"
+      " --table-kb not negative\n",
+      BOT_MAX_LOOKAHEAD);
+    return 1;
+  }
+
+  static GameInstance game;
+  game_init(&game);
+  BotTotals totals = { 0 };
+
+  for (long g = 0; g < games; g++) {
+    game_actionRestart(&game, seed + g);
+
+    while (game.state.playState == PLAY_PLAYING && game.state.pieces < maxPieces) {
+      uint64_t start = cli_nowNs();
+      bool played = bot_play(&bot, &game);
+      uint64_t ns = cli_nowNs() - start;
+      totals.decideNs += ns;
+      if (ns > totals.slowestNs) totals.slowestNs = ns;
+      if (!played) break;
+    }
+    totals.pieces += game.state.pieces;
+    totals.lines += game.state.clearedLines;
+    totals.toppedOut += game.state.playState != PLAY_PLAYING;
+  }
+
+  printf("beam         %d, lookahead %d\n", options.beamWidth, options.lookahead);
+  printf("games        %ld, %ld topped out\n", games, totals.toppedOut);
+  printf("pieces       %.1f per game\n", (double) totals.pieces / games);
+  printf("lines        %.1f per game\n", (double) totals.lines / games);
+  printf("decision     %.3f ms average, %.3f ms slowest\n", totals.decideNs / 1e6 / bot.decisions,
+    totals.slowestNs / 1e6);
+  printf("nodes/s      %.0f\n", bot.nodes / (totals.decideNs / 1e9));
+  printf("arena        %zu bytes\n", bot.arena.capacity);
+  if (bot.table.buckets) {
+    const TTStats* stats = &bot.table.stats;
+    printf("table        %zu KB, %.1f%% hit rate, %llu stores, %llu replaced\n", tt_bytes(&bot.table) / 1024,
+      stats->probes ? 100.0 * stats->hits / stats->probes : 0, (unsigned long long) stats->stores,
+      (unsigned long long) stats->replacements);
+    printf("duplicates   %.1f per decision\n", (double) bot.duplicates / bot.decisions);
+  }
+  bot_free(&bot);
+  return 0;
+}
@@ -0,0 +1,11 @@
+// Once-only wrapper
+#ifndef HEADLESS_BOT_H_SEEN
+#define HEADLESS_BOT_H_SEEN
+
+/**
+ * Play games with the beam search bot, reporting how well it plays and how fast it searches
+ */
+int bot_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // HEADLESS_BOT_H_SEEN
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cli.h"
+
+uint64_t cli_nowNs() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+uint64_t cli_timerOverheadNs() {
+  const int samples = 100000;
+  uint64_t total = 0;
+  for (int i = 0; i < samples; i++) {
+    uint64_t start = cli_nowNs();
+    total += cli_nowNs() - start;
+  }
+  return total / samples;
+}
+
+static int findArg(int argc, char* argv[], const char* name) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return i;
+  }
+  return -1;
+}
+
+long cli_argInt(int argc, char* argv[], const char* name, long fallback) {
+  const char* value = cli_argString(argc, argv, name, NULL);
+  return value ? strtol(value, NULL, 0) : fallback;
+}
+
+const char* cli_argString(int argc, char* argv[], const char* name, const char* fallback) {
+  int i = findArg(argc, argv, name);
+  if (i < 0 || i + 1 >= argc) return fallback;
+  return argv[i + 1];
+}
+
+bool cli_hasFlag(int argc, char* argv[], const char* name) {
+  return findArg(argc, argv, name) >= 0;
+}
+
+bool cli_readFile(const char* path, char** bytes, long* length) {
+  FILE* file = fopen(path, "rb");
+  if (!file) return false;
+
+  fseek(file, 0, SEEK_END);
+  *length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  *bytes = malloc(*length);
+  bool ok = *bytes && fread(*bytes, 1, *length, file) == (size_t) *length;
+  fclose(file);
+  return ok;
+}
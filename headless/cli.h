@@ -0,0 +1,37 @@
+// Once-only wrapper
+#ifndef CLI_H_SEEN
+#define CLI_H_SEEN
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Helpers shared by the headless commands: timing, argument parsing and reading files
+ */
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+uint64_t cli_nowNs();
+
+/**
+ * Cost of one pair of cli_nowNs() calls, to subtract from timed sections
+ */
+uint64_t cli_timerOverheadNs();
+
+/**
+ * Value after "--name" in argv, or fallback if absent
+ */
+long cli_argInt(int argc, char* argv[], const char* name, long fallback);
+
+const char* cli_argString(int argc, char* argv[], const char* name, const char* fallback);
+
+bool cli_hasFlag(int argc, char* argv[], const char* name);
+
+/**
+ * Read a whole file into a new buffer, for timing work without the disk. Free it after
+ */
+bool cli_readFile(const char* path, char** bytes, long* length);
+
+// Once-only wrapper
+#endif // CLI_H_SEEN
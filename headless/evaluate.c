@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../macos/evaluate.h"
+#include "../macos/game.h"
+#include "../macos/movegen.h"
+#include "cli.h"
+#include "evaluate.h"
+
+/**
+ * EVALUATE
+ * ############################################################################
+ * Plays games as the features command does, lowest landing or a random one. At every spawn each
+ * available kernel evaluates the whole move list, and every candidate's board and features are
+ * compared with the scalar kernel's. Reports ns per batch and candidates/s for each kernel.
+ */
+
+struct KernelTotals {
+  uint64_t ns;
+  long mismatches;
+} typedef KernelTotals;
+
+static bool sameCandidate(const EvalBatch* a, const EvalBatch* b, int i) {
+  for (int y = 0; y < HEIGHT; y++) {
+    if (a->rows[y][i] != b->rows[y][i]) return false;
+  }
+  FieldFeatures featuresA, featuresB;
+  eval_getFeatures(a, i, &featuresA);
+  eval_getFeatures(b, i, &featuresB);
+  return memcmp(&featuresA, &featuresB, sizeof(FieldFeatures)) == 0 && a->linesCleared[i] == b->linesCleared[i];
+}
+
+int evaluate_main(int argc, char* argv[]) {
+  long games = cli_argInt(argc, argv, "--games", 1000);
+  unsigned seed = cli_argInt(argc, argv, "--seed", 1);
+  if (games < 1) {
+    fprintf(stderr, "evaluate: --games must be positive\n");
+    return 1;
+  }
+
+  static GameInstance game;
+  static MoveList list;
+  static EvalBatch batches[EVAL_KERNELS];
+  game_init(&game);
+  KernelTotals totals[EVAL_KERNELS] = { { 0 } };
+  long spawns = 0;
+  long candidates = 0;
+  unsigned moveSeed = seed;
+
+  for (long g = 0; g < games; g++) {
+    game_actionRestart(&game, seed + g);
+
+    while (game.state.playState == PLAY_PLAYING) {
+      movegen_generate(&game, &list);
+      spawns++;
+      candidates += list.count;
+
+      for (EvalKernel kernel = EVAL_SCALAR; kernel < EVAL_KERNELS; kernel++) {
+        if (!eval_hasKernel(kernel)) continue;
+
+        uint64_t start = cli_nowNs();
+        eval_placementsWith(kernel, &game, &list, &batches[kernel]);
+        totals[kernel].ns += cli_nowNs() - start;
+
+        for (int i = 0; i < list.count; i++) {
+          if (!sameCandidate(&batches[kernel], &batches[EVAL_SCALAR], i)) totals[kernel].mismatches++;
+        }
+      }
+
+      const Move* move = &list.moves[rand_r(&moveSeed) % list.count];
+      if (rand_r(&moveSeed) % 4) {
+        for (int i = 0; i < list.count; i++) {
+          if (list.moves[i].y > move->y) move = &list.moves[i];
+        }
+      }
+      game_actionPlace(&game, move->x, move->rotation, move->y);
+    }
+  }
+
+  long mismatches = 0;
+  printf("spawns       %ld\n", spawns);
+  printf("candidates   %.1f per spawn\n", (double) candidates / spawns);
+  printf("%-12s %12s %14s %10s %12s\n", "kernel", "ns/batch", "candidates/s", "speedup", "mismatches");
+  for (EvalKernel kernel = EVAL_SCALAR; kernel < EVAL_KERNELS; kernel++) {
+    if (!eval_hasKernel(kernel)) continue;
+    double seconds = totals[kernel].ns / 1e9;
+    printf("%-12s %12.1f %14.0f %9.2fx %12ld\n", eval_kernelName(kernel), totals[kernel].ns / (double) spawns,
+      candidates / seconds, (double) totals[EVAL_SCALAR].ns / totals[kernel].ns, totals[kernel].mismatches);
+    mismatches += totals[kernel].mismatches;
+  }
+  printf("best         %s\n", eval_kernelName(eval_bestKernel()));
+  return mismatches ? 1 : 0;
+}
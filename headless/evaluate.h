@@ -0,0 +1,12 @@
+// Once-only wrapper
+#ifndef HEADLESS_EVALUATE_H_SEEN
+#define HEADLESS_EVALUATE_H_SEEN
+
+/**
+ * Time each placement evaluation kernel on real move lists, checking every one against the scalar
+ * fallback
+ */
+int evaluate_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // HEADLESS_EVALUATE_H_SEEN
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../macos/blocks.h"
+#include "../macos/events.h"
+#include "../macos/game.h"
+#include "../macos/movegen.h"
+#include "cli.h"
+#include "events.h"
+#include "play.h"
+
+/**
+ * EVENTS
+ * ############################################################################
+ * Plays games as sim does with an EventQueue attached, draining it every --drain frames into a
+ * copy of the game built from events alone: the piece, pieces locked, lines, rows last cleared and
+ * play state. After each drain the copy must match game->state. With a long enough --drain the
+ * queue fills up, and the copy resyncs from the state whenever events_dropped() goes up, as a real
+ * consumer would. Every game is played again without the queue to time what publishing costs.
+ *
+ * Random play hardly ever clears a line, so the run ends with scripted clears of 1, 2 and 4 rows,
+ * checked the same way. A run that saw no lines events at all fails.
+ */
+
+static const char* eventNames[] = { "restart", "spawn", "move", "rotate", "lock", "lines", "gameover" };
+
+#define EVENT_TYPES (sizeof(eventNames) / sizeof(eventNames[0]))
+
+struct EventCopy {
+  BlockNames blockName;
+  int blockRotation;
+  int positionX;
+  int positionY;
+  uint32_t pieces;
+  uint32_t clearedLines;
+  uint32_t clearedRows;
+  PlayStates playState;
+} typedef EventCopy;
+
+struct EventsTotals {
+  long frames;
+  long counts[EVENT_TYPES];
+  long drains;
+  long resyncs;
+  long mismatches;
+  uint64_t withNs;
+  uint64_t withoutNs;
+} typedef EventsTotals;
+
+static void applyEvent(EventCopy* copy, const GameEvent* event) {
+  copy->blockName = event->blockName;
+  copy->blockRotation = event->blockRotation;
+  copy->positionX = event->positionX;
+  copy->positionY = event->positionY;
+
+  switch (event->type) {
+    case EVENT_RESTART:
+      copy->pieces = 0;
+      copy->clearedLines = 0;
+      copy->clearedRows = 0;
+      copy->playState = PLAY_PLAYING;
+      break;
+    case EVENT_LOCK:
+      copy->pieces++;
+      copy->clearedRows = 0;
+      break;
+    case EVENT_LINES:
+      copy->clearedLines += __builtin_popcount(event->data);
+      copy->clearedRows = event->data;
+      break;
+    case EVENT_GAMEOVER:
+      copy->playState = PLAY_GAMEOVER;
+      break;
+    default:
+      break;
+  }
+}
+
+static void copyState(EventCopy* copy, const GameState* state) {
+  *copy = (EventCopy) {
+    state->blockName, state->blockRotation, state->positionX, state->positionY,
+    state->pieces, state->clearedLines, state->clearedRows, state->playState
+  };
+}
+
+static void drain(EventQueue* queue, const GameInstance* game, EventCopy* copy, uint32_t* dropped,
+  EventsTotals* totals) {
+  GameEvent event;
+  while (events_pop(queue, &event)) {
+    applyEvent(copy, &event);
+    totals->counts[event.type]++;
+  }
+  totals->drains++;
+
+  if (events_dropped(queue) != *dropped) {
+    *dropped = events_dropped(queue);
+    copyState(copy, &game->state);
+    totals->resyncs++;
+    return;
+  }
+
+  EventCopy expected;
+  copyState(&expected, &game->state);
+  if (memcmp(&expected, copy, sizeof(EventCopy)) != 0) {
+    if (!totals->mismatches) printf("first mismatch, at frame %u\n", game->frame);
+    totals->mismatches++;
+    *copy = expected;
+  }
+}
+
+/**
+ * The landing that drops a vertical I to the floor down column 0
+ */
+static bool findWellLanding(const GameInstance* game, Move* landing) {
+  static MoveList list;
+  movegen_generate(game, &list);
+  for (int i = 0; i < list.count; i++) {
+    const Move* move = &list.moves[i];
+    const ShapePlacement* placement = getShapePlacement(BLOCK_I, move->rotation, move->x);
+    bool inWell = move->y + placement->bottom == HEIGHT - 1;
+    for (int row = placement->top; row <= placement->bottom; row++) {
+      inWell = inWell && placement->rows[row] == ROW_CELL_BIT(0);
+    }
+    if (inWell && placement->bottom - placement->top == 3) {
+      *landing = *move;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Lay 'lines' rows along the floor with column 0 empty, and 4 - lines above them with columns 0 and
+ * 1 empty, then drop an I down column 0. It fills the first lot, and only those clear. The rows are
+ * written directly, as perft lays out its fields, so only the spawn and the placing publish events
+ */
+static void clearScripted(GameInstance* game, EventQueue* queue, int lines, EventCopy* copy, uint32_t* dropped,
+  EventsTotals* totals) {
+  game_setEvents(game, queue);
+  game_actionRestart(game, lines);
+  for (int y = HEIGHT - 4; y < HEIGHT; y++) {
+    FieldRow gap = y >= HEIGHT - lines ? ROW_CELL_BIT(0) : ROW_CELL_BIT(0) | ROW_CELL_BIT(1);
+    game->field.rows[y] = ROW_FULL & ~gap;
+  }
+  game_computeFeatures(&game->field, &game->field.features);
+  game->field.hash = game_hashField(&game->field);
+
+  game_spawnPiece(game, BLOCK_I);
+  Move landing;
+  if (!findWellLanding(game, &landing)) {
+    printf("no landing down the well for %d lines\n", lines);
+    totals->mismatches++;
+    return;
+  }
+  game_actionPlace(game, landing.x, landing.rotation, landing.y);
+  drain(queue, game, copy, dropped, totals);
+
+  uint32_t expected = (uint32_t) ((1ull << HEIGHT) - 1) & ~((1u << (HEIGHT - lines)) - 1);
+  if (game->state.clearedRows != expected || copy->clearedRows != expected) {
+    printf("scripted %d lines cleared rows %x, events say %x\n", lines, game->state.clearedRows, copy->clearedRows);
+    totals->mismatches++;
+  }
+}
+
+int events_main(int argc, char* argv[]) {
+  long games = cli_argInt(argc, argv, "--games", 1000);
+  unsigned seed = cli_argInt(argc, argv, "--seed", 1);
+  long drainFrames = cli_argInt(argc, argv, "--drain", 1);
+  PlayOptions options;
+  if (!play_parseOptions(&options, argc, argv) || games < 1 || drainFrames < 1) {
+    fprintf(stderr, "events: --games and --drain must be positive\n");
+    return 1;
+  }
+
+  static GameInstance game;
+  static EventQueue queue;
+  game_init(&game);
+  events_init(&queue);
+  EventsTotals totals = { 0 };
+  EventCopy copy = { 0 };
+  uint32_t dropped = 0;
+
+  for (long g = 0; g < games; g++) {
+    // With events
+    unsigned inputSeed = seed + g;
+    game_setEvents(&game, &queue);
+    uint64_t start = cli_nowNs();
+    game_actionRestart(&game, seed + g);
+    long frame = 0;
+    for (; game.state.playState == PLAY_PLAYING && frame < options.maxFrames; frame++) {
+      play_frame(&game, &options, frame, &inputSeed);
+      game_tick(&game);
+      if ((frame + 1) % drainFrames == 0) drain(&queue, &game, &copy, &dropped, &totals);
+    }
+    drain(&queue, &game, &copy, &dropped, &totals);
+    totals.withNs += cli_nowNs() - start;
+    totals.frames += frame;
+
+    // The same game without
+    inputSeed = seed + g;
+    game_setEvents(&game, NULL);
+    start = cli_nowNs();
+    play_game(&game, &options, seed + g, &inputSeed);
+    totals.withoutNs += cli_nowNs() - start;
+  }
+
+  const int scriptedLines[] = { 1, 2, 4 };
+  for (size_t i = 0; i < sizeof(scriptedLines) / sizeof(scriptedLines[0]); i++) {
+    clearScripted(&game, &queue, scriptedLines[i], &copy, &dropped, &totals);
+  }
+
+  long events = 0;
+  for (size_t i = 0; i < EVENT_TYPES; i++) {
+    events += totals.counts[i];
+  }
+  printf("frames       %ld\n", totals.frames);
+  printf("events       %ld (%.2f per frame)\n", events, (double) events / totals.frames);
+  for (size_t i = 0; i < EVENT_TYPES; i++) {
+    printf("  %-10s %ld\n", eventNames[i], totals.counts[i]);
+  }
+  printf("dropped      %u (%ld resyncs over %ld drains)\n", events_dropped(&queue), totals.resyncs, totals.drains);
+  printf("with queue   %.1f ns/frame\n", (double) totals.withNs / totals.frames);
+  printf("without      %.1f ns/frame\n", (double) totals.withoutNs / totals.frames);
+  printf("mismatches   %ld\n", totals.mismatches);
+  if (!totals.counts[EVENT_LINES]) printf("no lines events\n");
+  return totals.mismatches || !totals.counts[EVENT_LINES] ? 1 : 0;
+}
@@ -0,0 +1,12 @@
+// Once-only wrapper
+#ifndef HEADLESS_EVENTS_H_SEEN
+#define HEADLESS_EVENTS_H_SEEN
+
+/**
+ * Play games with an event queue attached, rebuild the game from its events alone, and check the
+ * copy against the real state. Times frames with and without the queue
+ */
+int events_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // HEADLESS_EVENTS_H_SEEN
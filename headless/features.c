@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../macos/blocks.h"
+#include "../macos/game.h"
+#include "../macos/movegen.h"
+#include "cli.h"
+#include "features.h"
+
+/**
+ * FEATURES
+ * ############################################################################
+ * Plays games by placing each piece at the lowest landing from movegen_generate(), or a random
+ * one a quarter of the time, so there are both line clears and holes. After every placement the
+ * features and hash the game kept up to date are compared with game_computeFeatures() and
+ * game_hashField() on the same field. It times placements (which include the updates) and full
+ * feature recounts, which is what reading the features would cost without them.
+ *
+ * Before each placement it also checks game_getGhostY() for every move in the list: from the
+ * move's landing, which must stay put even tucked under an overhang, and from the top of the
+ * field, both against dropping a row at a time.
+ */
+
+#define REPEATS 32
+
+// Stop the compiler dropping recounts that nothing reads
+#define CLOBBER(pointer) __asm__ volatile("" : : "r"(pointer) : "memory")
+
+struct FeaturesTotals {
+  long placements;
+  long lines;
+  long mismatches;
+  long ghosts;
+  long ghostMismatches;
+  uint64_t placeNs;
+  uint64_t computeNs;
+  uint64_t ghostNs;
+  uint64_t slowGhostNs;
+} typedef FeaturesTotals;
+
+static void printFeatures(const FieldFeatures* features) {
+  printf("  heights");
+  for (int x = 0; x < WIDTH; x++) {
+    printf(" %d", features->heights[x]);
+  }
+  printf("  aggregate %d holes %d bumpiness %d wells %d transitions %d\n", features->aggregateHeight,
+    features->holes, features->bumpiness, features->wells, features->rowTransitions);
+}
+
+static void checkFeatures(const GameInstance* game, FeaturesTotals* totals) {
+  static FieldFeatures counted[REPEATS];
+
+  uint64_t start = cli_nowNs();
+  for (int i = 0; i < REPEATS; i++) {
+    game_computeFeatures(&game->field, &counted[i]);
+    CLOBBER(&counted[i]);
+  }
+  totals->computeNs += cli_nowNs() - start;
+
+  bool sameHash = game->field.hash == game_hashField(&game->field);
+  if (memcmp(&counted[0], &game->field.features, sizeof(FieldFeatures)) != 0 || !sameHash) {
+    if (!totals->mismatches) {
+      printf("first mismatch, after %ld placements\n", totals->placements);
+      printFeatures(&game->field.features);
+      printFeatures(&counted[0]);
+      if (!sameHash) printf("  hash differs\n");
+    }
+    totals->mismatches++;
+  }
+}
+
+static bool fits(const GameInstance* game, const ShapePlacement* placement, int y) {
+  if (y + placement->bottom >= HEIGHT) return false;
+  for (int row = placement->top; row <= placement->bottom; row++) {
+    if (game->field.rows[y + row] & placement->rows[row]) return false;
+  }
+  return true;
+}
+
+static int getSlowGhostY(const GameInstance* game) {
+  const GameState* state = &game->state;
+  const ShapePlacement* placement = getShapePlacement(state->blockName, state->blockRotation, state->positionX);
+  int y = state->positionY;
+  while (fits(game, placement, y + 1)) y++;
+  return y;
+}
+
+static void checkGhost(GameInstance* probe, int x, int rotation, int y, FeaturesTotals* totals) {
+  probe->state.positionX = x;
+  probe->state.blockRotation = rotation;
+  probe->state.positionY = y;
+
+  uint64_t start = cli_nowNs();
+  int ghostY = game_getGhostY(probe);
+  uint64_t middle = cli_nowNs();
+  int slowY = getSlowGhostY(probe);
+  totals->ghostNs += middle - start;
+  totals->slowGhostNs += cli_nowNs() - middle;
+  totals->ghosts++;
+
+  if (ghostY != slowY) {
+    if (!totals->ghostMismatches) {
+      printf("first ghost mismatch: piece %d rotation %d at %d,%d lands at %d, not %d\n", probe->state.blockName,
+        rotation, x, y, slowY, ghostY);
+    }
+    totals->ghostMismatches++;
+  }
+}
+
+static void checkGhosts(const GameInstance* game, const MoveList* list, FeaturesTotals* totals) {
+  static GameInstance probe;
+  probe = *game;
+  game_detach(&probe);
+  for (int i = 0; i < list->count; i++) {
+    const Move* move = &list->moves[i];
+    checkGhost(&probe, move->x, move->rotation, move->y, totals);
+
+    const ShapePlacement* placement = getShapePlacement(game->state.blockName, move->rotation, move->x);
+    if (fits(game, placement, 0)) checkGhost(&probe, move->x, move->rotation, 0, totals);
+  }
+}
+
+int features_main(int argc, char* argv[]) {
+  long games = cli_argInt(argc, argv, "--games", 1000);
+  unsigned seed = cli_argInt(argc, argv, "--seed", 1);
+  if (games < 1) {
+    fprintf(stderr, "features: --games must be positive\n");
+    return 1;
+  }
+
+  static GameInstance game;
+  game_init(&game);
+  FeaturesTotals totals = { 0 };
+  MoveList list;
+  unsigned moveSeed = seed;
+
+  for (long g = 0; g < games; g++) {
+    game_actionRestart(&game, seed + g);
+    checkFeatures(&game, &totals);
+
+    while (game.state.playState == PLAY_PLAYING) {
+      movegen_generate(&game, &list);
+      checkGhosts(&game, &list, &totals);
+      const Move* move = &list.moves[rand_r(&moveSeed) % list.count];
+      if (rand_r(&moveSeed) % 4) {
+        for (int i = 0; i < list.count; i++) {
+          if (list.moves[i].y > move->y) move = &list.moves[i];
+        }
+      }
+
+      uint64_t start = cli_nowNs();
+      game_actionPlace(&game, move->x, move->rotation, move->y);
+      totals.placeNs += cli_nowNs() - start;
+      totals.placements++;
+      totals.lines += __builtin_popcount(game.state.clearedRows);
+
+      checkFeatures(&game, &totals);
+    }
+  }
+
+  long checks = totals.placements + games;
+  printf("placements   %ld\n", totals.placements);
+  printf("lines        %ld\n", totals.lines);
+  printf("place        %.1f ns/call\n", (double) totals.placeNs / totals.placements);
+  printf("recount      %.1f ns/call\n", (double) totals.computeNs / ((double) checks * REPEATS));
+  printf("mismatches   %ld\n", totals.mismatches);
+
+  // Ghost queries are short enough that the timer's own cost matters
+  double overhead = cli_timerOverheadNs();
+  printf("ghosts       %ld\n", totals.ghosts);
+  printf("ghost        %.1f ns/call\n", (double) totals.ghostNs / totals.ghosts - overhead);
+  printf("row by row   %.1f ns/call\n", (double) totals.slowGhostNs / totals.ghosts - overhead);
+  printf("ghost misses %ld\n", totals.ghostMismatches);
+  return totals.mismatches || totals.ghostMismatches ? 1 : 0;
+}
@@ -0,0 +1,12 @@
+// Once-only wrapper
+#ifndef FEATURES_H_SEEN
+#define FEATURES_H_SEEN
+
+/**
+ * Check the field features and hash the game keeps as pieces land against a full recount, and time
+ * the features both ways
+ */
+int features_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // FEATURES_H_SEEN
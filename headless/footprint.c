@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../macos/game.h"
+#include "../macos/lockstep.h"
+#include "cli.h"
+#include "footprint.h"
+#include "play.h"
+
+/**
+ * FOOTPRINT
+ * ############################################################################
+ * First the sizes: each part of a game in bytes, in 64 byte cache lines, and how many fit in a
+ * 32 KB L1 data cache. Then the cost of those bytes. It plays games on 1 instance, then 4, 16 and
+ * so on up to --instances, one frame each in turn, so every frame finds its game where the last
+ * round left it. Once the instances outgrow a cache level, each frame pays to fetch its game from
+ * the next one down, and ns per frame steps up.
+ */
+
+#define CACHE_LINE 64
+#define L1_BYTES (32 * 1024)
+
+struct Part {
+  const char* name;
+  size_t bytes;
+} typedef Part;
+
+static void printSizes() {
+  const Part parts[] = {
+    { "field rows", sizeof(((Field*) 0)->rows) },
+    { "field colours", sizeof(((Field*) 0)->colours) },
+    { "field", sizeof(Field) },
+    { "draw field", sizeof(DrawField) },
+    { "game state", sizeof(GameState) },
+    { "snapshot", sizeof(GameSnapshot) },
+    { "game instance", sizeof(GameInstance) },
+    { "lockstep lane", sizeof(LockstepGames) / LOCKSTEP_LANES },
+  };
+
+  printf("%dx%d board\n", WIDTH, HEIGHT);
+  printf("%-16s %8s %8s %8s\n", "part", "bytes", "lines", "per L1");
+  for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+    size_t bytes = parts[i].bytes;
+    printf("%-16s %8zu %8zu %8zu\n", parts[i].name, bytes, (bytes + CACHE_LINE - 1) / CACHE_LINE, L1_BYTES / bytes);
+  }
+  printf("instances per GB %zu\n", ((size_t) 1 << 30) / sizeof(GameInstance));
+}
+
+/**
+ * Play 'frames' frames across 'count' games, one frame each in turn. Returns ns per frame
+ */
+static double timeInstances(GameInstance* games, long* frames, unsigned* inputSeeds, long count, long totalFrames,
+  const PlayOptions* options, bool draw, uint32_t* nextSeed) {
+  for (long i = 0; i < count; i++) {
+    game_init(&games[i]);
+    game_actionRestart(&games[i], (*nextSeed)++);
+    frames[i] = 0;
+    inputSeeds[i] = *nextSeed + i;
+  }
+
+  uint64_t begin = cli_nowNs();
+  long i = 0;
+  for (long frame = 0; frame < totalFrames; frame++) {
+    GameInstance* game = &games[i];
+    play_frame(game, options, frames[i]++, &inputSeeds[i]);
+    if (draw) game_updateDrawState(game);
+    if (game->state.playState != PLAY_PLAYING || frames[i] >= options->maxFrames) {
+      game_actionRestart(game, (*nextSeed)++);
+      frames[i] = 0;
+    }
+    if (++i == count) i = 0;
+  }
+  return (double) (cli_nowNs() - begin) / totalFrames;
+}
+
+int footprint_main(int argc, char* argv[]) {
+  long maxInstances = cli_argInt(argc, argv, "--instances", 65536);
+  long totalFrames = cli_argInt(argc, argv, "--frames", 2000000);
+  uint32_t seed = cli_argInt(argc, argv, "--seed", 1);
+  bool draw = cli_hasFlag(argc, argv, "--draw");
+  PlayOptions options;
+  if (!play_parseOptions(&options, argc, argv)) return 1;
+  if (maxInstances < 1 || totalFrames < 1) {
+    fprintf(stderr, "footprint: --instances and --frames must be positive\n");
+    return 1;
+  }
+
+  printSizes();
+
+  GameInstance* games = malloc(maxInstances * sizeof(GameInstance));
+  long* frames = malloc(maxInstances * sizeof(long));
+  unsigned* inputSeeds = malloc(maxInstances * sizeof(unsigned));
+  if (!games || !frames || !inputSeeds) {
+    fprintf(stderr, "footprint: can't allocate %ld instances\n", maxInstances);
+    free(games);
+    free(frames);
+    free(inputSeeds);
+    return 1;
+  }
+
+  printf("%10s %14s %10s\n", "instances", "working set", "ns/frame");
+  for (long count = 1;; count *= 4) {
+    if (count > maxInstances) count = maxInstances;
+    double ns = timeInstances(games, frames, inputSeeds, count, totalFrames, &options, draw, &seed);
+    double kb = (double) count * sizeof(GameInstance) / 1024;
+    printf("%10ld %11.1f KB %10.1f\n", count, kb, ns);
+    if (count == maxInstances) break;
+  }
+
+  free(games);
+  free(frames);
+  free(inputSeeds);
+  return 0;
+}
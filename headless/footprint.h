@@ -0,0 +1,12 @@
+// Once-only wrapper
+#ifndef FOOTPRINT_H_SEEN
+#define FOOTPRINT_H_SEEN
+
+/**
+ * Report how much memory a game takes, part by part, then time many games played side by side as
+ * their working set outgrows each cache level
+ */
+int footprint_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // FOOTPRINT_H_SEEN
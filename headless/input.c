@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../macos/input.h"
+#include "cli.h"
+#include "input.h"
+
+/**
+ * INPUT
+ * ############################################################################
+ * Makes random sequences of presses and releases of the four queued buttons, a few milliseconds
+ * to half a second apart, and feeds each through an InputQueue three ways: read just before every
+ * event, read at the end of every 60 Hz step, and read at random times. Every way has to give the
+ * same actions at the same times as a model that walks the whole sequence in one go. With --arr 0
+ * the wall slides repeated at each read are left out, since they depend on when reads happen.
+ *
+ * It also counts the presses the old macOS loop, which kept the last key of each frame, would have
+ * lost at 60 Hz.
+ */
+
+#define MAX_EVENTS 256
+#define MAX_ACTIONS 4096
+#define STEP_US (1000000 / 60)
+
+struct Sequence {
+  InputEvent events[MAX_EVENTS];
+  int count;
+  uint32_t end;
+} typedef Sequence;
+
+struct Actions {
+  InputAction actions[MAX_ACTIONS];
+  int count;
+  uint8_t slid;  // With arr 0, directions that have slid to the wall since the last direction press
+} typedef Actions;
+
+static const GameInputs buttons[] = { INPUT_LEFT, INPUT_RIGHT, INPUT_UP, INPUT_DOWN };
+
+static void makeSequence(Sequence* sequence, unsigned* seed, uint32_t start) {
+  uint8_t held = 0;
+  uint32_t time = start;
+  sequence->count = rand_r(seed) % (MAX_EVENTS / 2) + MAX_EVENTS / 2;
+  for (int i = 0; i < sequence->count; i++) {
+    int roll = rand_r(seed) % 10;
+    time += roll < 4 ? rand_r(seed) % 2000 : roll < 8 ? 20000 + rand_r(seed) % 100000 : 200000 + rand_r(seed) % 400000;
+    GameInputs input = buttons[rand_r(seed) % 4];
+    bool pressed = !(held & (1 << input));
+    held ^= 1 << input;
+    sequence->events[i] = (InputEvent) { time, input, pressed };
+  }
+  sequence->end = time + 1000000;
+}
+
+// Whether a is before b, across a wrap
+static bool isBefore(uint32_t a, uint32_t b) {
+  return (int32_t) (a - b) < 0;
+}
+
+static void add(Actions* actions, const InputAction* action, uint32_t arr) {
+  // With arr 0, slides after the first depend on when reads happen
+  if (arr == 0 && action->toWall) {
+    if (actions->slid & (1 << action->input)) return;
+    actions->slid |= 1 << action->input;
+  } else if (arr == 0 && (action->input == INPUT_LEFT || action->input == INPUT_RIGHT)) {
+    actions->slid = 0;
+  }
+  if (actions->count < MAX_ACTIONS) actions->actions[actions->count++] = *action;
+}
+
+/**
+ * The actions a sequence should give, from the rules in input.h
+ */
+static void model(const Sequence* sequence, uint32_t das, uint32_t arr, Actions* actions) {
+  uint8_t held = 0;
+  GameInputs shift = INPUT_NONE;
+  bool charged = false;
+  uint32_t shiftAt = 0;
+  actions->count = 0;
+  actions->slid = 0;
+
+  for (int i = 0; i <= sequence->count; i++) {
+    const InputEvent* event = i < sequence->count ? &sequence->events[i] : NULL;
+    uint32_t limit = event ? event->time : sequence->end + 1;
+
+    // Shifts strictly before the event: it wins ties
+    while (shift != INPUT_NONE && (arr > 0 || !charged) && isBefore(shiftAt, limit)) {
+      add(actions, &(InputAction) { shiftAt, shift, true, arr == 0 }, arr);
+      charged = true;
+      if (arr == 0) break;
+      shiftAt += arr;
+    }
+    if (!event) break;
+
+    GameInputs input = event->input;
+    GameInputs other = input == INPUT_LEFT ? INPUT_RIGHT : INPUT_LEFT;
+    bool isDirection = input == INPUT_LEFT || input == INPUT_RIGHT;
+    if (event->pressed) {
+      held |= 1 << input;
+      add(actions, &(InputAction) { event->time, input, false, false }, arr);
+      if (isDirection) {
+        shift = input;
+        charged = false;
+        shiftAt = event->time + das;
+      }
+    } else {
+      held &= ~(1 << input);
+      if (input == shift && (held & (1 << other))) {
+        shift = other;
+        charged = false;
+        shiftAt = event->time + das;
+      } else if (input == shift) {
+        shift = INPUT_NONE;
+      }
+    }
+  }
+}
+
+static void readAll(InputQueue* queue, uint32_t until, Actions* actions, uint32_t arr, long* reads) {
+  InputAction action;
+  while (input_next(queue, until, &action)) {
+    add(actions, &action, arr);
+  }
+  (*reads)++;
+}
+
+/**
+ * Feed the sequence, reading at the times readAt() gives. Mode 0 reads before each event, 1 at
+ * every step, 2 at random
+ */
+static void feed(const Sequence* sequence, uint32_t das, uint32_t arr, int mode, unsigned* seed, Actions* actions,
+  long* reads) {
+  InputQueue queue;
+  input_init(&queue, das, arr);
+  actions->count = 0;
+  actions->slid = 0;
+
+  uint32_t start = sequence->events[0].time;
+  uint32_t readTime = start;
+  int next = 0;
+  while (next < sequence->count) {
+    if (mode == 0) {
+      readAll(&queue, sequence->events[next].time - 1, actions, arr, reads);
+      const InputEvent* event = &sequence->events[next++];
+      (event->pressed ? input_press : input_release)(&queue, event->input, event->time);
+      continue;
+    }
+
+    readTime += mode == 1 ? STEP_US : 1000 + rand_r(seed) % 50000;
+    while (next < sequence->count && !isBefore(readTime, sequence->events[next].time)) {
+      const InputEvent* event = &sequence->events[next++];
+      (event->pressed ? input_press : input_release)(&queue, event->input, event->time);
+    }
+    readAll(&queue, readTime, actions, arr, reads);
+  }
+  readAll(&queue, sequence->end, actions, arr, reads);
+}
+
+static bool sameActions(const Actions* a, const Actions* b) {
+  if (a->count != b->count) return false;
+  for (int i = 0; i < a->count; i++) {
+    const InputAction* x = &a->actions[i];
+    const InputAction* y = &b->actions[i];
+    if (x->time != y->time || x->input != y->input || x->repeat != y->repeat || x->toWall != y->toWall) return false;
+  }
+  return true;
+}
+
+/**
+ * Presses after the first in the same 60 Hz frame, which a loop keeping one key per frame loses
+ */
+static long lostPerFrame(const Sequence* sequence) {
+  long lost = 0;
+  uint32_t start = sequence->events[0].time;
+  long lastFrame = -1;
+  for (int i = 0; i < sequence->count; i++) {
+    if (!sequence->events[i].pressed) continue;
+    long frame = (sequence->events[i].time - start) / STEP_US;
+    if (frame == lastFrame) lost++;
+    lastFrame = frame;
+  }
+  return lost;
+}
+
+int input_main(int argc, char* argv[]) {
+  long sequences = cli_argInt(argc, argv, "--sequences", 1000);
+  unsigned seed = cli_argInt(argc, argv, "--seed", 1);
+  long das = cli_argInt(argc, argv, "--das", INPUT_DEFAULT_DAS_US);
+  long arr = cli_argInt(argc, argv, "--arr", INPUT_DEFAULT_ARR_US);
+  if (sequences < 1 || das < 0 || arr < 0) {
+    fprintf(stderr, "input: --sequences must be positive, --das and --arr not negative\n");
+    return 1;
+  }
+
+  static const char* modeNames[] = { "every event", "every step", "random" };
+  static Sequence sequence;
+  static Actions expected;
+  static Actions actual;
+  long mismatches[3] = { 0 };
+  long reads[3] = { 0 };
+  uint64_t readNs[3] = { 0 };
+  long presses = 0;
+  long shifts = 0;
+  long lost = 0;
+  uint64_t overhead = cli_timerOverheadNs();
+
+  for (long s = 0; s < sequences; s++) {
+    unsigned sequenceSeed = seed + s;
+    // Start near the wrap now and then, which times have to survive
+    makeSequence(&sequence, &sequenceSeed, s % 4 == 0 ? UINT32_MAX - 5000000 : (uint32_t) rand_r(&sequenceSeed));
+    model(&sequence, das, arr, &expected);
+    lost += lostPerFrame(&sequence);
+    for (int i = 0; i < expected.count; i++) {
+      if (expected.actions[i].repeat) shifts++;
+      else presses++;
+    }
+
+    for (int mode = 0; mode < 3; mode++) {
+      unsigned readSeed = seed + s;
+      uint64_t start = cli_nowNs();
+      feed(&sequence, das, arr, mode, &readSeed, &actual, &reads[mode]);
+      readNs[mode] += cli_nowNs() - start - overhead;
+      if (!sameActions(&expected, &actual)) {
+        if (!mismatches[mode]) printf("%s: sequence %ld differs from the model\n", modeNames[mode], s);
+        mismatches[mode]++;
+      }
+    }
+  }
+
+  printf("das %ld us, arr %ld us\n", das, arr);
+  printf("presses       %ld (%ld lost by one key per frame)\n", presses, lost);
+  printf("auto shifts   %ld\n", shifts);
+  long failures = 0;
+  for (int mode = 0; mode < 3; mode++) {
+    printf("%-12s  %ld reads, %.1f ns/read, %ld mismatches\n", modeNames[mode], reads[mode],
+      (double) readNs[mode] / reads[mode], mismatches[mode]);
+    failures += mismatches[mode];
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,12 @@
+// Once-only wrapper
+#ifndef HEADLESS_INPUT_H_SEEN
+#define HEADLESS_INPUT_H_SEEN
+
+/**
+ * Feed random button sequences through an InputQueue, read at different rates, and check the
+ * presses and auto shifts against a model worked out from the whole sequence at once
+ */
+int input_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // HEADLESS_INPUT_H_SEEN
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../macos/game.h"
+#include "../macos/lockstep.h"
+#include "../macos/movegen.h"
+#include "cli.h"
+#include "lockstep.h"
+#include "play.h"
+
+/**
+ * LOCKSTEP
+ * ############################################################################
+ * Games run in batches of LOCKSTEP_LANES, each lane with its own piece seed and inputs (random or
+ * --script, gravity as for sim). Every batch is played twice from the same inputs: by
+ * lockstep_step() on all lanes at once, and by game.c one game at a time. Each lane's rows and
+ * GameState must match the scalar game's at the end of the batch, or after every frame with
+ * --check, which also plays the two side by side.
+ *
+ * With --place each step is a whole piece instead: every lane picks a landing from movegen, the
+ * deeper of two at random, and locks it there with game_actionPlace() or lockstep_place(). Only
+ * the placing is timed, not movegen.
+ */
+
+struct LockstepTotals {
+  long frames;  // Game frames, one per lane per step
+  long steps;   // Frames of whole batches, each timed once per engine
+  long mismatches;
+  uint64_t lockstepNs;
+  uint64_t scalarNs;
+} typedef LockstepTotals;
+
+struct Batch {
+  LockstepGames lanes;
+  GameInstance games[LOCKSTEP_LANES];
+  unsigned inputSeeds[LOCKSTEP_LANES];
+  GameInputs inputs[LOCKSTEP_LANES];
+  GameInputs gravity[LOCKSTEP_LANES];
+} typedef Batch;
+
+static bool sameLane(const Batch* batch, int lane) {
+  const GameInstance* game = &batch->games[lane];
+  for (int y = 0; y < HEIGHT; y++) {
+    if (batch->lanes.rows[y][lane] != game->field.rows[y]) return false;
+  }
+  return memcmp(&batch->lanes.states[lane], &game->state, sizeof(GameState)) == 0;
+}
+
+static long countMismatches(const Batch* batch, long first) {
+  long mismatches = 0;
+  for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+    if (sameLane(batch, lane)) continue;
+    if (!mismatches) fprintf(stderr, "lockstep: game %ld differs, piece %d\n", first + lane, batch->games[lane].state.pieces);
+    mismatches++;
+  }
+  return mismatches;
+}
+
+/**
+ * This frame's inputs for every lane, then the soft drops gravity adds, as play_frame() would
+ */
+static void chooseInputs(Batch* batch, const PlayOptions* options, long frame) {
+  bool gravity = (frame % options->gravity) == 0;
+  for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+    batch->inputs[lane] = play_nextInput(options, frame, &batch->inputSeeds[lane]);
+    batch->gravity[lane] = gravity && batch->inputs[lane] != INPUT_DOWN ? INPUT_SOFTDROP : INPUT_NONE;
+  }
+}
+
+/**
+ * Each lane's inputs are seeded like its pieces, so both runs of a batch see the same ones
+ */
+static void seedInputs(Batch* batch, long first, unsigned seed) {
+  for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+    batch->inputSeeds[lane] = seed + first + lane;
+  }
+}
+
+static void restartBatch(Batch* batch, long first, unsigned seed) {
+  uint32_t seeds[LOCKSTEP_LANES];
+  for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+    seeds[lane] = seed + first + lane;
+    game_init(&batch->games[lane]);
+    game_actionRestart(&batch->games[lane], seeds[lane]);
+  }
+  lockstep_restart(&batch->lanes, seeds);
+  seedInputs(batch, first, seed);
+}
+
+static void playLockstep(Batch* batch, LockstepTotals* totals) {
+  uint64_t start = cli_nowNs();
+  lockstep_step(&batch->lanes, batch->inputs);
+  lockstep_step(&batch->lanes, batch->gravity);
+  totals->lockstepNs += cli_nowNs() - start;
+  totals->frames += __builtin_popcount(lockstep_playing(&batch->lanes));
+  totals->steps++;
+}
+
+static void playScalar(Batch* batch, const PlayOptions* options, long frame, LockstepTotals* totals) {
+  uint64_t start = cli_nowNs();
+  for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+    GameInstance* game = &batch->games[lane];
+    if (game->state.playState == PLAY_PLAYING) play_applyFrame(game, options, frame, batch->inputs[lane]);
+  }
+  totals->scalarNs += cli_nowNs() - start;
+}
+
+/**
+ * A landing for each lane still playing, from the scalar game
+ */
+static void chooseLandings(Batch* batch, Move landings[LOCKSTEP_LANES]) {
+  static MoveList list;
+  for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+    GameInstance* game = &batch->games[lane];
+    if (game->state.playState != PLAY_PLAYING || !movegen_generate(game, &list)) continue;
+    const Move* a = &list.moves[rand_r(&batch->inputSeeds[lane]) % list.count];
+    const Move* b = &list.moves[rand_r(&batch->inputSeeds[lane]) % list.count];
+    landings[lane] = a->y >= b->y ? *a : *b;
+  }
+}
+
+static bool anyPlaying(const Batch* batch) {
+  for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+    if (batch->games[lane].state.playState == PLAY_PLAYING) return true;
+  }
+  return false;
+}
+
+static void placeScalar(Batch* batch, const Move landings[LOCKSTEP_LANES], LockstepTotals* totals) {
+  uint64_t start = cli_nowNs();
+  for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+    GameInstance* game = &batch->games[lane];
+    const Move* landing = &landings[lane];
+    if (game->state.playState == PLAY_PLAYING) game_actionPlace(game, landing->x, landing->rotation, landing->y);
+  }
+  totals->scalarNs += cli_nowNs() - start;
+}
+
+static void placeLockstep(Batch* batch, const Move landings[LOCKSTEP_LANES], LockstepTotals* totals) {
+  totals->frames += __builtin_popcount(lockstep_playing(&batch->lanes));
+  totals->steps++;
+  uint64_t start = cli_nowNs();
+  lockstep_place(&batch->lanes, landings);
+  totals->lockstepNs += cli_nowNs() - start;
+}
+
+/**
+ * Play a batch a piece at a time: game.c first, keeping the landings, then lockstep_place() on
+ * the same ones. With check, the two go side by side and are compared after every piece
+ */
+static long playPlacements(Batch* batch, long first, unsigned seed, long maxPieces, bool check, Move* landings,
+  LockstepTotals* totals) {
+  long pieces = 0;
+  for (; anyPlaying(batch) && pieces < maxPieces; pieces++) {
+    Move* step = &landings[pieces * LOCKSTEP_LANES];
+    chooseLandings(batch, step);
+    placeScalar(batch, step, totals);
+    if (!check) continue;
+    placeLockstep(batch, step, totals);
+    long mismatches = countMismatches(batch, first);
+    if (mismatches) return mismatches;
+  }
+  if (check) return 0;
+
+  uint32_t seeds[LOCKSTEP_LANES];
+  for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+    seeds[lane] = seed + first + lane;
+  }
+  lockstep_restart(&batch->lanes, seeds);
+  for (long piece = 0; piece < pieces; piece++) {
+    placeLockstep(batch, &landings[piece * LOCKSTEP_LANES], totals);
+  }
+  return countMismatches(batch, first);
+}
+
+int lockstep_main(int argc, char* argv[]) {
+  long games = cli_argInt(argc, argv, "--games", 1024);
+  unsigned seed = cli_argInt(argc, argv, "--seed", 1);
+  bool check = cli_hasFlag(argc, argv, "--check");
+  bool place = cli_hasFlag(argc, argv, "--place");
+  long maxPieces = cli_argInt(argc, argv, "--max-pieces", 1000);
+  PlayOptions options;
+  if (!play_parseOptions(&options, argc, argv) || games < 1 || maxPieces < 1) {
+    fprintf(stderr, "lockstep: --games and --max-pieces must be positive\n");
+    return 1;
+  }
+
+  static Batch batch;
+  LockstepTotals totals = { 0 };
+  long batches = (games + LOCKSTEP_LANES - 1) / LOCKSTEP_LANES;
+  Move* landings = place ? calloc(maxPieces * LOCKSTEP_LANES, sizeof(Move)) : NULL;
+  if (place && !landings) {
+    fprintf(stderr, "lockstep: can't allocate %ld pieces of landings\n", maxPieces);
+    return 1;
+  }
+
+  for (long b = 0; b < batches; b++) {
+    long first = b * LOCKSTEP_LANES;
+    restartBatch(&batch, first, seed);
+
+    if (place) {
+      totals.mismatches += playPlacements(&batch, first, seed, maxPieces, check, landings, &totals);
+      continue;
+    }
+
+    if (check) {
+      for (long frame = 0; lockstep_playing(&batch.lanes) && frame < options.maxFrames; frame++) {
+        chooseInputs(&batch, &options, frame);
+        playLockstep(&batch, &totals);
+        playScalar(&batch, &options, frame, &totals);
+        long mismatches = countMismatches(&batch, first);
+        totals.mismatches += mismatches;
+        if (mismatches) break;
+      }
+      continue;
+    }
+
+    // Lockstep first, then replay the same inputs through game.c
+    long frames = 0;
+    for (; lockstep_playing(&batch.lanes) && frames < options.maxFrames; frames++) {
+      chooseInputs(&batch, &options, frames);
+      playLockstep(&batch, &totals);
+    }
+    seedInputs(&batch, first, seed);
+    for (long frame = 0; frame < frames; frame++) {
+      chooseInputs(&batch, &options, frame);
+      playScalar(&batch, &options, frame, &totals);
+    }
+    totals.mismatches += countMismatches(&batch, first);
+  }
+
+  printf("games        %ld, %d lanes (%s)\n", batches * LOCKSTEP_LANES, LOCKSTEP_LANES, lockstep_kernelName());
+  printf("%-12s %ld (%.1f lanes playing per step)\n", place ? "pieces" : "frames", totals.frames,
+    (double) totals.frames / totals.steps);
+
+  // Both engines are timed once per step, so take the timer's own cost out of each
+  uint64_t overhead = cli_timerOverheadNs() * totals.steps;
+  double lockstepNs = totals.lockstepNs > overhead ? totals.lockstepNs - overhead : 0;
+  double scalarNs = totals.scalarNs > overhead ? totals.scalarNs - overhead : 0;
+  const char* unit = place ? "piece" : "game frame";
+  printf("lockstep     %.1f ns per %s\n", lockstepNs / totals.frames, unit);
+  printf("scalar       %.1f ns per %s\n", scalarNs / totals.frames, unit);
+  printf("speedup      %.2fx\n", scalarNs / lockstepNs);
+  printf("mismatches   %ld\n", totals.mismatches);
+  free(landings);
+  return totals.mismatches ? 1 : 0;
+}
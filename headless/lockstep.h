@@ -0,0 +1,12 @@
+// Once-only wrapper
+#ifndef HEADLESS_LOCKSTEP_H_SEEN
+#define HEADLESS_LOCKSTEP_H_SEEN
+
+/**
+ * Play games in lockstep lanes and one at a time through game.c with the same inputs, check they
+ * end up the same and compare speed
+ */
+int lockstep_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // HEADLESS_LOCKSTEP_H_SEEN
@@ -0,0 +1,122 @@
+/**
+ * ############################################################################
+ * #                         NOTRIS - HEADLESS TOOLS                          #
+ * ############################################################################
+ * Runs the macOS engine core (game.c, blocks.c) with no graphics or input library, for simulation
+ * and benchmarking on any POSIX system.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "archive.h"
+#include "batch.h"
+#include "bot.h"
+#include "evaluate.h"
+#include "events.h"
+#include "features.h"
+#include "footprint.h"
+#include "input.h"
+#include "lockstep.h"
+#include "movegen.h"
+#include "perft.h"
+#include "playback.h"
+#include "sim.h"
+#include "snapshot.h"
+#include "timestep.h"
+
+struct Command {
+  const char* name;
+  int (*run)(int argc, char* argv[]);
+  const char* usage;
+} typedef Command;
+
+static const Command commands[] = {
+  {
+    "sim", sim_main,
+    "[--games N] [--seed N] [--script KEYS] [--gravity FRAMES] [--max-frames N] [--no-draw] [--check-draw]"
+    " [--no-timing] [--record FILE] [--keyframe-interval FRAMES]"
+  },
+  {
+    "batch", batch_main,
+    "[--games N] [--threads N] [--chunk N] [--seed N] [--script KEYS] [--gravity FRAMES] [--max-frames N]"
+  },
+  {
+    "playback", playback_main,
+    "FILE [--repeat N] [--seeks N]"
+  },
+  {
+    "archive", archive_main,
+    "FILE [--out FILE] [--repeat N]"
+  },
+  {
+    "snapshot", snapshot_main,
+    "[--games N] [--seed N] [--script KEYS] [--gravity FRAMES] [--max-frames N]"
+  },
+  {
+    "movegen", movegen_main,
+    "[--games N] [--seed N] [--check]"
+  },
+  {
+    "perft", perft_main,
+    "[--field ROWS] [--pieces PIECES] [--slow] | --fixtures [--slow]"
+  },
+  {
+    "features", features_main,
+    "[--games N] [--seed N]"
+  },
+  {
+    "evaluate", evaluate_main,
+    "[--games N] [--seed N]"
+  },
+  {
+    "lockstep", lockstep_main,
+    "[--games N] [--seed N] [--check] [--place] [--max-pieces N] [--script KEYS] [--gravity FRAMES] [--max-frames N]"
+  },
+  {
+    "events", events_main,
+    "[--games N] [--seed N] [--drain FRAMES] [--script KEYS] [--gravity FRAMES] [--max-frames N]"
+  },
+  {
+    "timestep", timestep_main,
+    "[--games N] [--seed N] [--stall-every FRAMES] [--stall-ms MS] [--script KEYS] [--gravity FRAMES] [--max-frames N]"
+  },
+  {
+    "input", input_main,
+    "[--sequences N] [--seed N] [--das US] [--arr US]"
+  },
+  {
+    "footprint", footprint_main,
+    "[--instances N] [--frames N] [--seed N] [--draw] [--script KEYS] [--gravity FRAMES] [--max-frames N]"
+  },
+  {
+    "bot", bot_main,
+    "[--games N] [--seed N] [--beam N] [--lookahead N] [--table-kb N] [--max-pieces N]"
+  },
+};
+
+static const int commandCount = sizeof(commands) / sizeof(commands[0]);
+
+static void printUsage(const char* program) {
+  fprintf(stderr, "Usage:\n");
+  for (int i = 0; i < commandCount; i++) {
+    fprintf(stderr, "  %s %s %s\n", program, commands[i].name, commands[i].usage);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  for (int i = 0; i < commandCount; i++) {
+    if (strcmp(argv[1], commands[i].name) == 0) {
+      // Commands see their own name as argv[0]
+      return commands[i].run(argc - 1, argv + 1);
+    }
+  }
+
+  printUsage(argv[0]);
+  return 1;
+}
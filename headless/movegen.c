@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../macos/game.h"
+#include "../macos/movegen.h"
+#include "cli.h"
+#include "movegen.h"
+#include "oracle.h"
+
+/**
+ * MOVEGEN
+ * ############################################################################
+ * Each game places pieces at random moves from movegen_generate(), following movegen_path()
+ * through the real game_action* functions and checking the piece is where the move says just
+ * before the hard drop. With --check, every spawn is also searched the slow way (oracle.c) and the
+ * two sets of landings must match.
+ */
+
+struct MovegenTotals {
+  long spawns;
+  long moves;
+  long pathInputs;
+  long checked;
+  long mismatches;
+  uint64_t generateNs;
+  uint64_t pathNs;
+} typedef MovegenTotals;
+
+static void applyInput(GameInstance* game, GameInputs input) {
+  switch (input) {
+    case INPUT_LEFT:
+      game_actionMovement(game, MOVE_LEFT);
+      break;
+    case INPUT_RIGHT:
+      game_actionMovement(game, MOVE_RIGHT);
+      break;
+    case INPUT_UP:
+      game_actionRotate(game);
+      break;
+    case INPUT_SOFTDROP:
+      game_actionSoftDrop(game);
+      break;
+    case INPUT_DOWN:
+      game_actionHardDrop(game);
+      break;
+    default:
+      break;
+  }
+}
+
+static bool checkSpawn(const GameInstance* game, const MoveList* list) {
+  static Move landings[MOVEGEN_MAX_MOVES];
+  static Footprint expected[MOVEGEN_MAX_MOVES];
+  static Footprint found[MOVEGEN_MAX_MOVES];
+
+  int expectedCount = oracle_landings(game, landings);
+  if (expectedCount != list->count) return false;
+
+  BlockNames block = game->state.blockName;
+  for (int i = 0; i < list->count; i++) {
+    expected[i] = oracle_footprint(block, landings[i].rotation, landings[i].x, landings[i].y);
+    found[i] = oracle_footprint(block, list->moves[i].rotation, list->moves[i].x, list->moves[i].y);
+  }
+  qsort(found, list->count, sizeof(Footprint), oracle_compareFootprints);
+  return memcmp(expected, found, list->count * sizeof(Footprint)) == 0;
+}
+
+int movegen_main(int argc, char* argv[]) {
+  long games = cli_argInt(argc, argv, "--games", 1000);
+  unsigned seed = cli_argInt(argc, argv, "--seed", 1);
+  bool check = cli_hasFlag(argc, argv, "--check");
+  if (games < 1) {
+    fprintf(stderr, "movegen: --games must be positive\n");
+    return 1;
+  }
+
+  static GameInstance game;
+  static MoveList list;
+  static GameInputs path[MOVEGEN_MAX_PATH];
+  game_init(&game);
+  MovegenTotals totals = { 0 };
+
+  for (long g = 0; g < games; g++) {
+    unsigned moveSeed = seed + g;
+    game_actionRestart(&game, seed + g);
+
+    while (game.state.playState == PLAY_PLAYING) {
+      uint64_t start = cli_nowNs();
+      int count = movegen_generate(&game, &list);
+      totals.generateNs += cli_nowNs() - start;
+      totals.spawns++;
+      totals.moves += count;
+      if (!count) break;
+
+      if (check) {
+        totals.checked++;
+        if (!checkSpawn(&game, &list)) {
+          if (!totals.mismatches) fprintf(stderr, "movegen: landings differ, game %ld piece %d\n", g, game.state.pieces);
+          totals.mismatches++;
+        }
+      }
+
+      const Move* move = &list.moves[rand_r(&moveSeed) % count];
+      start = cli_nowNs();
+      int length = movegen_path(&game, move, path);
+      totals.pathNs += cli_nowNs() - start;
+      totals.pathInputs += length;
+
+      for (int i = 0; i < length - 1; i++) {
+        applyInput(&game, path[i]);
+      }
+      bool arrived = length > 0 && game.state.positionX == move->x && game.state.positionY == move->y
+        && game.state.blockRotation == move->rotation;
+      if (!arrived) {
+        if (!totals.mismatches) fprintf(stderr, "movegen: path missed, game %ld piece %d\n", g, game.state.pieces);
+        totals.mismatches++;
+      }
+      game_actionHardDrop(&game);
+    }
+  }
+
+  uint64_t overhead = cli_timerOverheadNs();
+  double generateNs = (double) totals.generateNs / totals.spawns - overhead;
+  printf("spawns       %ld\n", totals.spawns);
+  printf("moves        %.1f per spawn\n", (double) totals.moves / totals.spawns);
+  printf("generate     %.1f ns per spawn, %.0f moves/s\n", generateNs, totals.moves / (generateNs * totals.spawns / 1e9));
+  printf("path         %.1f ns, %.1f inputs per move\n", (double) totals.pathNs / totals.spawns - overhead,
+    (double) totals.pathInputs / totals.spawns);
+  if (check) printf("checked      %ld spawns\n", totals.checked);
+  printf("mismatches   %ld\n", totals.mismatches);
+  return totals.mismatches ? 1 : 0;
+}
@@ -0,0 +1,12 @@
+// Once-only wrapper
+#ifndef HEADLESS_MOVEGEN_H_SEEN
+#define HEADLESS_MOVEGEN_H_SEEN
+
+/**
+ * Time the move generator over games played with its own moves, optionally checking each spawn
+ * against a search through the game_action* functions
+ */
+int movegen_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // HEADLESS_MOVEGEN_H_SEEN
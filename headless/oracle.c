@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "oracle.h"
+
+#define STATES (4 * PLACEMENT_COLUMNS * HEIGHT)
+
+struct Landing {
+  Footprint footprint;
+  Move move;
+} typedef Landing;
+
+Footprint oracle_footprint(BlockNames block, int rotation, int x, int y) {
+  const ShapePlacement* placement = getShapePlacement(block, rotation, x);
+  Footprint footprint = { y + placement->top, 0 };
+  for (int row = placement->top; row <= placement->bottom; row++) {
+    footprint.rows = footprint.rows << 16 | placement->rows[row];
+  }
+  return footprint;
+}
+
+int oracle_compareFootprints(const void* a, const void* b) {
+  const Footprint* left = a;
+  const Footprint* right = b;
+  if (left->top != right->top) return left->top - right->top;
+  return (left->rows > right->rows) - (left->rows < right->rows);
+}
+
+static int stateIndex(int rotation, int x, int y) {
+  return (rotation * PLACEMENT_COLUMNS + x - PLACEMENT_MIN_X) * HEIGHT + y;
+}
+
+int oracle_landings(const GameInstance* game, Move* moves) {
+  static bool seen[STATES];
+  static Move queue[STATES];
+  static Landing landings[STATES];
+  static GameInstance copy;
+  memset(seen, 0, sizeof(seen));
+
+  const GameState* state = &game->state;
+  if (state->playState != PLAY_PLAYING) return 0;
+
+  int head = 0, tail = 0, count = 0;
+  queue[tail++] = (Move) { state->positionX, state->positionY, state->blockRotation };
+  seen[stateIndex(state->blockRotation, state->positionX, state->positionY)] = true;
+
+  while (head < tail) {
+    Move position = queue[head++];
+    for (int i = 0; i < 4; i++) {
+      copy = *game;
+      game_detach(&copy);
+      copy.state.blockRotation = position.rotation;
+      copy.state.positionX = position.x;
+      copy.state.positionY = position.y;
+
+      switch (i) {
+        case 0:
+          game_actionMovement(&copy, MOVE_LEFT);
+          break;
+        case 1:
+          game_actionMovement(&copy, MOVE_RIGHT);
+          break;
+        case 2:
+          game_actionRotate(&copy);
+          break;
+        default:
+          game_actionSoftDrop(&copy);
+          break;
+      }
+
+      // A soft drop that can't go down locks the piece instead
+      if (copy.state.pieces != state->pieces) {
+        landings[count].footprint = oracle_footprint(state->blockName, position.rotation, position.x, position.y);
+        landings[count].move = position;
+        count++;
+        continue;
+      }
+
+      int index = stateIndex(copy.state.blockRotation, copy.state.positionX, copy.state.positionY);
+      if (seen[index]) continue;
+      seen[index] = true;
+      queue[tail++] = (Move) { copy.state.positionX, copy.state.positionY, copy.state.blockRotation };
+    }
+  }
+
+  // Different rotations can fill the same cells. Footprint comes first in Landing, so the
+  // comparison works on it directly
+  qsort(landings, count, sizeof(Landing), oracle_compareFootprints);
+  int unique = 0;
+  for (int i = 0; i < count; i++) {
+    if (unique && oracle_compareFootprints(&landings[i], &landings[i - 1]) == 0) continue;
+    moves[unique++] = landings[i].move;
+  }
+  return unique;
+}
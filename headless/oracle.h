@@ -0,0 +1,32 @@
+// Once-only wrapper
+#ifndef ORACLE_H_SEEN
+#define ORACLE_H_SEEN
+
+#include "../macos/game.h"
+#include "../macos/movegen.h"
+
+/**
+ * The slow, obviously-right way to find landings: try every input from every reachable position
+ * through the game_action* functions, on copies of the game. Used to check movegen.c. Uses static
+ * buffers, so one thread at a time
+ */
+
+struct Footprint {
+  int top;
+  uint64_t rows;
+} typedef Footprint;
+
+/**
+ * The cells a piece fills when it lands, to compare landings regardless of rotation
+ */
+Footprint oracle_footprint(BlockNames block, int rotation, int x, int y);
+
+int oracle_compareFootprints(const void* a, const void* b);
+
+/**
+ * Every landing for the current piece, one per footprint, sorted by footprint. Returns the count
+ */
+int oracle_landings(const GameInstance* game, Move* moves);
+
+// Once-only wrapper
+#endif // ORACLE_H_SEEN
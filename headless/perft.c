@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../macos/game.h"
+#include "../macos/movegen.h"
+#include "cli.h"
+#include "oracle.h"
+#include "perft.h"
+
+/**
+ * PERFT
+ * ############################################################################
+ * From a field and a list of pieces, place the first piece at every landing movegen_generate()
+ * finds, then the second piece at every landing from each of those boards, and so on to the
+ * given depth. Perft(d) is the number of leaves, i.e. placement sequences of length d. Distinct
+ * counts the different fields those sequences leave behind (after line clears). Branches stop
+ * early if a piece can't spawn.
+ *
+ * Fields are written top to bottom with rows separated by '/', '#' filled and '.' empty, and sit
+ * on the floor: "#########./#########." is two rows with a well on the right.
+ *
+ * The known answers below were generated with this tool and checked against --slow, which uses
+ * oracle.c instead of the move generator. They only hold for the current shapeHexes rotation
+ * table and spawn positions on the standard 10x26 board; if those change, regenerate and re-check
+ * them. Other board sizes skip them.
+ */
+
+#define MAX_DEPTH 8
+#define PIECE_LETTERS "_IJLOSTZ"  // Indexed by BlockNames
+
+struct PerftFixture {
+  const char* name;
+  const char* field;
+  const char* pieces;
+  long leaves;
+  long distinct;
+} typedef PerftFixture;
+
+#define ROWS_4(row) row "/" row "/" row "/" row
+#define ROWS_20(row) ROWS_4(row) "/" ROWS_4(row) "/" ROWS_4(row) "/" ROWS_4(row) "/" ROWS_4(row)
+
+static const PerftFixture fixtures[] = {
+  { "empty",     "",                                                  "I",    17,     17 },
+  { "empty",     "",                                                  "T",    34,     34 },
+  { "empty",     "",                                                  "O",    9,      9 },
+  { "empty",     "",                                                  "TIO",  5542,   5542 },
+  { "empty",     "",                                                  "IJL",  20297,  20179 },
+  { "empty",     "",                                                  "SZT",  10517,  10517 },
+  { "empty",     "",                                                  "IJLS", 368905, 366648 },
+  { "overhang",  "........../#####...../#........./#.........",       "TLJ",  66820,  66591 },
+  { "tetris",    ROWS_4("#########."),                                "II",   289,    196 },
+  { "holes",     "##.#######/#..#######/#.########/##.#######",       "ZST",  10543,  10543 },
+  { "chimney",   ROWS_20("####..####"),                               "OI",   135,    135 },
+  { "combs",     ROWS_20("#..#..#..#") "/" "#..#..#..#/#..#..#..#",   "TOZ",  796,    796 },
+  { "well",      ROWS_20("#####.####") "/" "#####.####/#####.####/#####.####", "ITL", 1127, 1127 },
+};
+
+struct BoardSet {
+  uint64_t* keys;  // 0 is an empty slot
+  long capacity;
+  long count;
+} typedef BoardSet;
+
+struct Perft {
+  GameInstance game;
+  BlockNames pieces[MAX_DEPTH];
+  int depth;
+  bool slow;
+  long placements;
+  BoardSet boards;
+} typedef Perft;
+
+/**
+ * Board set
+ * ================================================================================================
+ * Fields are kept as their Zobrist hashes (field->hash). A collision would undercount distinct
+ * boards, but at the sizes perft reaches it isn't going to happen
+ */
+
+static void addBoard(BoardSet* set, uint64_t key) {
+  if ((set->count + 1) * 2 > set->capacity) {
+    BoardSet grown = { calloc(set->capacity * 2, sizeof(uint64_t)), set->capacity * 2, 0 };
+    if (!grown.keys) {
+      fprintf(stderr, "perft: out of memory\n");
+      exit(1);
+    }
+    for (long i = 0; i < set->capacity; i++) {
+      if (set->keys[i]) addBoard(&grown, set->keys[i]);
+    }
+    free(set->keys);
+    *set = grown;
+  }
+
+  long mask = set->capacity - 1;
+  for (long i = key & mask; ; i = (i + 1) & mask) {
+    if (set->keys[i] == key) return;
+    if (!set->keys[i]) {
+      set->keys[i] = key;
+      set->count++;
+      return;
+    }
+  }
+}
+
+static void resetBoards(BoardSet* set) {
+  free(set->keys);
+  set->capacity = 1024;
+  set->keys = calloc(set->capacity, sizeof(uint64_t));
+  set->count = 0;
+}
+
+/**
+ * Search
+ * ================================================================================================
+ */
+
+static long search(Perft* perft, int ply) {
+  GameInstance* game = &perft->game;
+  if (ply == perft->depth) {
+    addBoard(&perft->boards, game->field.hash ? game->field.hash : 1);
+    return 1;
+  }
+
+  game_spawnPiece(game, perft->pieces[ply]);
+  if (game->state.playState != PLAY_PLAYING) return 0;
+
+  MoveList list;
+  if (perft->slow) {
+    list.count = oracle_landings(game, list.moves);
+  } else {
+    movegen_generate(game, &list);
+  }
+
+  GameSnapshot snapshot;
+  game_snapshot(game, &snapshot);
+
+  long leaves = 0;
+  for (int i = 0; i < list.count; i++) {
+    if (i) game_restore(game, &snapshot);
+    const Move* move = &list.moves[i];
+    game_actionPlace(game, move->x, move->rotation, move->y);
+    perft->placements++;
+    leaves += search(perft, ply + 1);
+  }
+  return leaves;
+}
+
+static bool parsePieces(const char* text, Perft* perft) {
+  int length = strlen(text);
+  if (length < 1 || length > MAX_DEPTH) return false;
+
+  for (int i = 0; i < length; i++) {
+    const char* letter = strchr(PIECE_LETTERS, text[i]);
+    if (!letter || text[i] == PIECE_LETTERS[0]) return false;
+    perft->pieces[i] = letter - PIECE_LETTERS;
+  }
+  perft->depth = length;
+  return true;
+}
+
+/**
+ * Start a game, then lay the field in from the floor up. Returns false if the field is malformed
+ */
+static bool setField(GameInstance* game, const char* text) {
+  game_init(game);
+  game_actionRestart(game, 1);
+
+  int rows = 1;
+  for (const char* c = text; *c; c++) {
+    rows += *c == '/';
+  }
+  if (!*text) rows = 0;
+  if (rows > HEIGHT) return false;
+
+  GameInstance filled = *game;
+  game_detach(&filled);
+
+  int y = HEIGHT - rows;
+  int x = 0;
+  for (const char* c = text; *c; c++) {
+    if (*c == '/') {
+      if (x != WIDTH) return false;
+      y++;
+      x = 0;
+    } else if (*c == '#' || *c == '.') {
+      if (x >= WIDTH) return false;
+      if (*c == '#') filled.field.rows[y] |= ROW_CELL_BIT(x);
+      x++;
+    } else {
+      return false;
+    }
+  }
+  if (rows && x != WIDTH) return false;
+
+  game_computeFeatures(&filled.field, &filled.field.features);
+  filled.field.hash = game_hashField(&filled.field);
+  game->field = filled.field;
+  return true;
+}
+
+/**
+ * Perft at each depth up to the full length of the pieces. Returns the last depth's counts
+ */
+static void runPerft(Perft* perft, const char* field, int maxDepth, bool verbose, long* leaves, long* distinct) {
+  GameInstance start;
+  setField(&start, field);
+
+  for (int depth = verbose ? 1 : maxDepth; depth <= maxDepth; depth++) {
+    perft->game = start;
+    perft->depth = depth;
+    perft->placements = 0;
+    resetBoards(&perft->boards);
+
+    uint64_t begin = cli_nowNs();
+    *leaves = search(perft, 0);
+    double seconds = (cli_nowNs() - begin) / 1e9;
+    *distinct = perft->boards.count;
+
+    if (verbose) {
+      printf("%-6d %12ld %12ld %10.3f %14.0f\n", depth, *leaves, *distinct, seconds,
+        seconds > 0 ? perft->placements / seconds : 0);
+    }
+  }
+}
+
+static int runFixtures(bool slow) {
+  if (WIDTH != 10 || HEIGHT != 26) {
+    printf("perft: the fixtures are for a 10x26 board, not %dx%d; skipping\n", WIDTH, HEIGHT);
+    return 0;
+  }
+
+  int failures = 0;
+  long placements = 0;
+  double seconds = 0;
+  Perft perft = { .slow = slow };
+
+  printf("%-14s %-8s %12s %12s\n", "fixture", "pieces", "perft", "distinct");
+  for (size_t i = 0; i < sizeof(fixtures) / sizeof(fixtures[0]); i++) {
+    const PerftFixture* fixture = &fixtures[i];
+    parsePieces(fixture->pieces, &perft);
+
+    long leaves, distinct;
+    uint64_t begin = cli_nowNs();
+    runPerft(&perft, fixture->field, perft.depth, false, &leaves, &distinct);
+    seconds += (cli_nowNs() - begin) / 1e9;
+    placements += perft.placements;
+
+    bool ok = leaves == fixture->leaves && distinct == fixture->distinct;
+    failures += !ok;
+    printf("%-14s %-8s %12ld %12ld   %s\n", fixture->name, fixture->pieces, leaves, distinct, ok ? "ok" : "FAIL");
+    if (!ok) printf("%-23s %12ld %12ld   expected\n", "", fixture->leaves, fixture->distinct);
+  }
+
+  printf("nodes/s      %.0f\n", placements / seconds);
+  printf("failures     %d\n", failures);
+  free(perft.boards.keys);
+  return failures ? 1 : 0;
+}
+
+int perft_main(int argc, char* argv[]) {
+  bool slow = cli_hasFlag(argc, argv, "--slow");
+  if (cli_hasFlag(argc, argv, "--fixtures")) return runFixtures(slow);
+
+  const char* field = cli_argString(argc, argv, "--field", "");
+  const char* pieces = cli_argString(argc, argv, "--pieces", "TIOL");
+  Perft perft = { .slow = slow };
+  GameInstance check;
+  if (!parsePieces(pieces, &perft)) {
+    fprintf(stderr, "perft: --pieces takes 1 to %d of %s\n", MAX_DEPTH, PIECE_LETTERS + 1);
+    return 1;
+  }
+  if (!setField(&check, field)) {
+    fprintf(stderr, "perft: --field needs rows of %d '#' or '.', separated by '/'\n", WIDTH);
+    return 1;
+  }
+
+  long leaves, distinct;
+  printf("%-6s %12s %12s %10s %14s\n", "depth", "perft", "distinct", "seconds", "nodes/s");
+  runPerft(&perft, field, perft.depth, true, &leaves, &distinct);
+  free(perft.boards.keys);
+  return 0;
+}
@@ -0,0 +1,12 @@
+// Once-only wrapper
+#ifndef PERFT_H_SEEN
+#define PERFT_H_SEEN
+
+/**
+ * Count every placement sequence and distinct board reachable from a field with a given run of
+ * pieces, as chess engines count moves with perft. Also runs a suite of known answers
+ */
+int perft_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // PERFT_H_SEEN
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cli.h"
+#include "play.h"
+
+static GameInputs parseScriptKey(char key) {
+  switch (key) {
+    case 'l': return INPUT_LEFT;
+    case 'r': return INPUT_RIGHT;
+    case 'u': return INPUT_UP;
+    case 'd': return INPUT_DOWN;
+    default: return INPUT_NONE;
+  }
+}
+
+static GameInputs randomInput(unsigned* seed) {
+  // Weighted towards movement, with roughly one hard drop every ten frames
+  int roll = rand_r(seed) % 10;
+  if (roll < 3) return INPUT_LEFT;
+  if (roll < 6) return INPUT_RIGHT;
+  if (roll < 8) return INPUT_UP;
+  if (roll < 9) return INPUT_NONE;
+  return INPUT_DOWN;
+}
+
+bool play_parseOptions(PlayOptions* options, int argc, char* argv[]) {
+  options->script = cli_argString(argc, argv, "--script", NULL);
+  options->scriptLength = options->script ? strlen(options->script) : 0;
+  options->gravity = cli_argInt(argc, argv, "--gravity", 2);
+  options->maxFrames = cli_argInt(argc, argv, "--max-frames", 100000);
+
+  if (options->script && options->scriptLength == 0) {
+    fprintf(stderr, "--script must not be empty\n");
+    return false;
+  }
+  if (options->gravity < 1 || options->maxFrames < 1) {
+    fprintf(stderr, "--gravity and --max-frames must be positive\n");
+    return false;
+  }
+  return true;
+}
+
+GameInputs play_nextInput(const PlayOptions* options, long frame, unsigned* seed) {
+  if (options->script) {
+    return parseScriptKey(options->script[frame % options->scriptLength]);
+  }
+  return randomInput(seed);
+}
+
+void play_frame(GameInstance* game, const PlayOptions* options, long frame, unsigned* inputSeed) {
+  play_applyFrame(game, options, frame, play_nextInput(options, frame, inputSeed));
+}
+
+void play_applyFrame(GameInstance* game, const PlayOptions* options, long frame, GameInputs input) {
+  switch (input) {
+    case INPUT_LEFT:
+      game_actionMovement(game, MOVE_LEFT);
+      break;
+    case INPUT_RIGHT:
+      game_actionMovement(game, MOVE_RIGHT);
+      break;
+    case INPUT_UP:
+      game_actionRotate(game);
+      break;
+    case INPUT_DOWN:
+      game_actionHardDrop(game);
+      break;
+    default:
+      break;
+  }
+
+  bool gravity = (frame % options->gravity) == 0;
+  if (gravity && input != INPUT_DOWN && game->state.playState == PLAY_PLAYING) {
+    game_actionSoftDrop(game);
+  }
+  game_tick(game);
+}
+
+long play_game(GameInstance* game, const PlayOptions* options, uint32_t pieceSeed, unsigned* inputSeed) {
+  game_actionRestart(game, pieceSeed);
+
+  long frame = 0;
+  while (game->state.playState == PLAY_PLAYING && frame < options->maxFrames) {
+    play_frame(game, options, frame, inputSeed);
+    frame++;
+  }
+  return frame;
+}
@@ -0,0 +1,48 @@
+// Once-only wrapper
+#ifndef PLAY_H_SEEN
+#define PLAY_H_SEEN
+
+#include <stddef.h>
+
+#include "../macos/game.h"
+
+/**
+ * Input policies shared by the headless commands. Each frame takes one input, as a front-end
+ * would, then applies gravity every 'gravity' frames. Scripts are strings of inputs played in a loop:
+ *   l = left, r = right, u = rotate, d = hard drop, . = nothing
+ */
+
+struct PlayOptions {
+  const char* script;  // NULL for random inputs
+  size_t scriptLength;
+  int gravity;
+  long maxFrames;
+} typedef PlayOptions;
+
+/**
+ * Fill options from --script, --gravity and --max-frames. Prints and returns false if invalid
+ */
+bool play_parseOptions(PlayOptions* options, int argc, char* argv[]);
+
+/**
+ * Input for the given frame. Random inputs draw from *seed, so each caller can own its sequence
+ */
+GameInputs play_nextInput(const PlayOptions* options, long frame, unsigned* seed);
+
+/**
+ * Play one frame: the input for this frame, then gravity
+ */
+void play_frame(GameInstance* game, const PlayOptions* options, long frame, unsigned* inputSeed);
+
+/**
+ * The same, with the input already chosen
+ */
+void play_applyFrame(GameInstance* game, const PlayOptions* options, long frame, GameInputs input);
+
+/**
+ * Restart the game with pieceSeed and play it to game over (or maxFrames). Returns frames played
+ */
+long play_game(GameInstance* game, const PlayOptions* options, uint32_t pieceSeed, unsigned* inputSeed);
+
+// Once-only wrapper
+#endif // PLAY_H_SEEN
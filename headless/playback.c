@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../macos/codec.h"
+#include "../macos/game.h"
+#include "../macos/replay.h"
+#include "cli.h"
+#include "playback.h"
+
+/**
+ * PLAYBACK
+ * ############################################################################
+ * Streams a replay, or a compressed one from the archive command, through a fresh GameInstance as
+ * fast as the engine allows. The file is read into memory first so that disk speed doesn't count
+ * towards the result.
+ */
+
+struct PlaybackTotals {
+  long events;
+  long games;
+  long pieces;
+  long lines;
+  uint32_t frames;
+} typedef PlaybackTotals;
+
+static int compareFrames(const void* a, const void* b) {
+  uint32_t left = *(const uint32_t*) a;
+  uint32_t right = *(const uint32_t*) b;
+  return (left > right) - (left < right);
+}
+
+static bool sameGame(const GameInstance* a, const GameInstance* b) {
+  return memcmp(&a->field, &b->field, sizeof(Field)) == 0
+    && memcmp(&a->state, &b->state, sizeof(GameState)) == 0;
+}
+
+/**
+ * Seek to random frames, in order, and check each one against playing straight through to it
+ */
+static bool checkSeeks(char* bytes, long length, uint32_t frames, long seeks) {
+  FILE* seekStream = fmemopen(bytes, length, "rb");
+  FILE* linearStream = fmemopen(bytes, length, "rb");
+  ReplayReader seekReader, linearReader;
+  bool ok = seekStream && linearStream
+    && replay_startReader(&seekReader, seekStream) && replay_openIndex(&seekReader)
+    && replay_startReader(&linearReader, linearStream);
+  if (!ok) {
+    fprintf(stderr, "playback: no keyframe index\n");
+    if (seekStream) fclose(seekStream);
+    if (linearStream) fclose(linearStream);
+    return false;
+  }
+
+  uint32_t* targets = malloc(seeks * sizeof(uint32_t));
+  unsigned random = 1;
+  for (long i = 0; i < seeks; i++) {
+    targets[i] = (uint64_t) rand_r(&random) * (frames + 1) / ((uint64_t) RAND_MAX + 1);
+  }
+  qsort(targets, seeks, sizeof(uint32_t), compareFrames);
+
+  GameInstance seekGame, linearGame;
+  game_init(&seekGame);
+  game_init(&linearGame);
+  ReplayEvent next;
+  bool hasNext = replay_next(&linearReader, &next);
+
+  long mismatches = 0;
+  uint64_t seekNs = 0;
+  for (long i = 0; i < seeks; i++) {
+    while (hasNext && next.frame <= targets[i]) {
+      replay_apply(&linearGame, &next);
+      hasNext = replay_next(&linearReader, &next);
+    }
+
+    uint64_t start = cli_nowNs();
+    bool seeked = replay_seek(&seekReader, &seekGame, targets[i]);
+    seekNs += cli_nowNs() - start;
+
+    if (!seeked || !sameGame(&seekGame, &linearGame)) {
+      if (!mismatches) fprintf(stderr, "playback: seek to frame %u doesn't match\n", targets[i]);
+      mismatches++;
+    }
+  }
+
+  printf("keyframes    %u, every %u frames\n", seekReader.keyframeCount, seekReader.keyframeInterval);
+  printf("seeks        %ld, %ld mismatched\n", seeks, mismatches);
+  printf("seek         %.1f us average\n", seekNs / 1e3 / seeks);
+
+  free(targets);
+  replay_closeReader(&seekReader);
+  replay_closeReader(&linearReader);
+  fclose(seekStream);
+  fclose(linearStream);
+  return mismatches == 0;
+}
+
+/**
+ * Tally a game when it ends, i.e. when the next restart arrives or the replay finishes
+ */
+static void countGame(PlaybackTotals* totals, const GameInstance* game) {
+  totals->games++;
+  totals->pieces += game->state.pieces;
+  totals->lines += game->state.clearedLines;
+}
+
+static bool playReplay(char* bytes, long length, PlaybackTotals* totals) {
+  FILE* stream = fmemopen(bytes, length, "rb");
+  if (!stream) return false;
+
+  // Either a replay straight from the game, or one compressed for archiving
+  ReplayReader reader;
+  CodecDecoder decoder;
+  bool compressed = false;
+  if (!replay_startReader(&reader, stream)) {
+    rewind(stream);
+    if (!codec_startDecoder(&decoder, stream)) {
+      codec_finishDecoder(&decoder);
+      fclose(stream);
+      return false;
+    }
+    compressed = true;
+  }
+
+  GameInstance game;
+  game_init(&game);
+  bool started = false;
+
+  ReplayEvent event;
+  while (compressed ? codec_decode(&decoder, &event) : replay_next(&reader, &event)) {
+    if (event.input == INPUT_RESTART) {
+      if (started) countGame(totals, &game);
+      started = true;
+    }
+    replay_apply(&game, &event);
+    totals->events++;
+  }
+  if (started) countGame(totals, &game);
+
+  if (compressed) {
+    totals->frames = decoder.frame;
+    codec_finishDecoder(&decoder);
+  } else {
+    totals->frames = reader.frame;
+  }
+  fclose(stream);
+  return true;
+}
+
+int playback_main(int argc, char* argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "playback: needs a replay file\n");
+    return 1;
+  }
+  long repeat = cli_argInt(argc, argv, "--repeat", 1);
+  long seeks = cli_argInt(argc, argv, "--seeks", 0);
+  if (repeat < 1 || seeks < 0) {
+    fprintf(stderr, "playback: --repeat must be positive, --seeks can't be negative\n");
+    return 1;
+  }
+
+  char* bytes;
+  long length;
+  if (!cli_readFile(argv[1], &bytes, &length)) {
+    fprintf(stderr, "playback: can't read %s\n", argv[1]);
+    return 1;
+  }
+
+  PlaybackTotals totals;
+  uint64_t start = cli_nowNs();
+  for (long i = 0; i < repeat; i++) {
+    totals = (PlaybackTotals) { 0 };
+    if (!playReplay(bytes, length, &totals)) {
+      fprintf(stderr, "playback: %s isn't a replay\n", argv[1]);
+      free(bytes);
+      return 1;
+    }
+  }
+  double seconds = (cli_nowNs() - start) / 1e9 / repeat;
+
+  printf("bytes        %ld\n", length);
+  printf("games        %ld\n", totals.games);
+  printf("pieces       %ld\n", totals.pieces);
+  printf("lines        %ld\n", totals.lines);
+  printf("events       %ld\n", totals.events);
+  printf("frames       %u\n", totals.frames);
+  printf("bytes/piece  %.2f\n", totals.pieces ? (double) length / totals.pieces : 0);
+  printf("elapsed      %.3f s per playback\n", seconds);
+  printf("frames/s     %.0f\n", totals.frames / seconds);
+  printf("events/s     %.0f\n", totals.events / seconds);
+
+  bool ok = seeks == 0 || checkSeeks(bytes, length, totals.frames, seeks);
+  free(bytes);
+  return ok ? 0 : 1;
+}
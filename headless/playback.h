@@ -0,0 +1,11 @@
+// Once-only wrapper
+#ifndef PLAYBACK_H_SEEN
+#define PLAYBACK_H_SEEN
+
+/**
+ * Re-simulate a replay file and report playback speed
+ */
+int playback_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // PLAYBACK_H_SEEN
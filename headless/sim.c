@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../macos/blocks.h"
+#include "../macos/game.h"
+#include "../macos/replay.h"
+#include "cli.h"
+#include "play.h"
+#include "sim.h"
+
+/**
+ * SIM
+ * ############################################################################
+ * Plays games back to back with random or scripted inputs, then reports throughput for the whole
+ * run and the average cost of each engine entry point. Inputs and gravity follow the same rules as
+ * play_game() (see play.h), but each call here is timed separately.
+ *
+ * game_updateDrawState() only rewrites the rows that changed. With --check-draw, every frame's
+ * draw field is also compared with one drawn from scratch.
+ */
+
+typedef enum SimEntryPoints {
+  ENTRY_MOVEMENT,
+  ENTRY_ROTATE,
+  ENTRY_SOFTDROP,
+  ENTRY_HARDDROP,
+  ENTRY_RESTART,
+  ENTRY_DRAWSTATE,
+  ENTRY_COUNT
+} SimEntryPoints;
+
+static const char* entryNames[ENTRY_COUNT] = {
+  "game_actionMovement",
+  "game_actionRotate",
+  "game_actionSoftDrop",
+  "game_actionHardDrop",
+  "game_actionRestart",
+  "game_updateDrawState",
+};
+
+struct SimTiming {
+  uint64_t calls;
+  uint64_t ns;
+} typedef SimTiming;
+
+struct SimTotals {
+  long frames;
+  long pieces;
+  long lines;
+  long capped;
+  long draws;
+  long drawnRows;
+  long drawMismatches;
+} typedef SimTotals;
+
+struct SimOptions {
+  long games;
+  PlayOptions play;
+  bool draw;
+  bool checkDraw;
+  bool timed;
+} typedef SimOptions;
+
+static SimTiming g_timings[ENTRY_COUNT];
+
+// Calls an entry point, timing it unless timing is switched off (the timer costs ~20ns a call)
+#define TIMED(options, entry, call) do { \
+  if ((options)->timed) { \
+    uint64_t start = cli_nowNs(); \
+    call; \
+    g_timings[entry].ns += cli_nowNs() - start; \
+  } else { \
+    call; \
+  } \
+  g_timings[entry].calls++; \
+} while (0)
+
+/**
+ * The whole draw field from scratch: the field's colours, then the ghost, then the piece
+ */
+static void drawFromScratch(const GameInstance* game, DrawField* drawField) {
+  for (int y = 0; y < DRAW_HEIGHT; y++) {
+    memcpy((*drawField)[y], game->field.colours[y + HIDDEN_ROWS], sizeof((*drawField)[y]));
+  }
+
+  const GameState* state = &game->state;
+  shapeHex shape = getBlockShape(state->blockName, state->blockRotation);
+  bool playing = state->playState == PLAY_PLAYING;
+  int pieceYs[2] = { playing ? game_getGhostY(game) : state->positionY, state->positionY };
+  BlockNames values[2] = { playing ? state->blockName | DRAW_GHOST : state->blockName, state->blockName };
+
+  for (int i = 0; i < 2; i++) {
+    for (int y = 0; y < 4; y++) {
+      for (int x = 0; x < 4; x++) {
+        int fieldY = pieceYs[i] + y;
+        int fieldX = state->positionX + x;
+        if (!getShapeBit(shape, y, x) || fieldY < HIDDEN_ROWS || fieldY >= HEIGHT) continue;
+        if (fieldX < 0 || fieldX >= WIDTH) continue;
+        (*drawField)[fieldY - HIDDEN_ROWS][fieldX] = values[i];
+      }
+    }
+  }
+}
+
+static void checkDraw(const GameInstance* game, SimTotals* totals) {
+  static DrawField expected;
+  drawFromScratch(game, &expected);
+  if (memcmp(expected, game->drawField, sizeof(DrawField)) == 0) return;
+
+  if (!totals->drawMismatches) {
+    printf("first draw mismatch, at draw %ld\n", totals->draws);
+  }
+  totals->drawMismatches++;
+}
+
+static void stepFrame(GameInstance* game, const SimOptions* options, GameInputs input, bool gravity,
+  SimTotals* totals) {
+  switch (input) {
+    case INPUT_LEFT:
+      TIMED(options, ENTRY_MOVEMENT, game_actionMovement(game, MOVE_LEFT));
+      break;
+    case INPUT_RIGHT:
+      TIMED(options, ENTRY_MOVEMENT, game_actionMovement(game, MOVE_RIGHT));
+      break;
+    case INPUT_UP:
+      TIMED(options, ENTRY_ROTATE, game_actionRotate(game));
+      break;
+    case INPUT_DOWN:
+      TIMED(options, ENTRY_HARDDROP, game_actionHardDrop(game));
+      break;
+    default:
+      break;
+  }
+
+  if (gravity && input != INPUT_DOWN && game->state.playState == PLAY_PLAYING) {
+    TIMED(options, ENTRY_SOFTDROP, game_actionSoftDrop(game));
+  }
+
+  if (options->draw) {
+    TIMED(options, ENTRY_DRAWSTATE, game_updateDrawState(game));
+    totals->draws++;
+    totals->drawnRows += __builtin_popcount(game->drawDirtyRows);
+    if (options->checkDraw) checkDraw(game, totals);
+  }
+}
+
+static void printReport(const SimOptions* options, const SimTotals* totals, uint64_t elapsedNs) {
+  double seconds = elapsedNs / 1e9;
+  printf("games        %ld (%ld hit the frame cap)\n", options->games, totals->capped);
+  printf("pieces       %ld\n", totals->pieces);
+  printf("lines        %ld\n", totals->lines);
+  printf("frames       %ld\n", totals->frames);
+  printf("elapsed      %.3f s\n", seconds);
+  printf("games/s      %.0f\n", options->games / seconds);
+  printf("pieces/s     %.0f\n", totals->pieces / seconds);
+  printf("frames/s     %.0f\n", totals->frames / seconds);
+  if (totals->draws) {
+    printf("drawn rows   %.2f of %d per frame\n", (double) totals->drawnRows / totals->draws, DRAW_HEIGHT);
+  }
+  if (options->checkDraw) printf("mismatches   %ld\n", totals->drawMismatches);
+
+  if (!options->timed) return;
+
+  uint64_t overhead = cli_timerOverheadNs();
+  printf("\n%-22s %12s %10s   (timer overhead %llu ns removed)\n", "entry point", "calls", "ns/call",
+    (unsigned long long) overhead);
+  for (int i = 0; i < ENTRY_COUNT; i++) {
+    SimTiming timing = g_timings[i];
+    double perCall = 0;
+    if (timing.calls) {
+      perCall = (double) timing.ns / timing.calls - overhead;
+      if (perCall < 0) perCall = 0;
+    }
+    printf("%-22s %12llu %10.1f\n", entryNames[i], (unsigned long long) timing.calls, perCall);
+  }
+}
+
+int sim_main(int argc, char* argv[]) {
+  SimOptions options = {
+    .games = cli_argInt(argc, argv, "--games", 10000),
+    .draw = !cli_hasFlag(argc, argv, "--no-draw"),
+    .checkDraw = cli_hasFlag(argc, argv, "--check-draw"),
+    .timed = !cli_hasFlag(argc, argv, "--no-timing"),
+  };
+  if (!play_parseOptions(&options.play, argc, argv) || options.games < 1) {
+    fprintf(stderr, "sim: --games must be positive\n");
+    return 1;
+  }
+
+  unsigned seed = cli_argInt(argc, argv, "--seed", 1);
+  memset(g_timings, 0, sizeof(g_timings));
+
+  GameInstance game;
+  game_init(&game);
+
+  // Optionally record every game into one replay
+  const char* recordPath = cli_argString(argc, argv, "--record", NULL);
+  FILE* replayFile = NULL;
+  ReplayWriter replay;
+  long keyframeInterval = cli_argInt(argc, argv, "--keyframe-interval", REPLAY_KEYFRAME_INTERVAL);
+  if (recordPath) {
+    if (keyframeInterval < 1) {
+      fprintf(stderr, "sim: --keyframe-interval must be positive\n");
+      return 1;
+    }
+    replayFile = fopen(recordPath, "wb");
+    if (!replayFile) {
+      fprintf(stderr, "sim: can't write %s\n", recordPath);
+      return 1;
+    }
+    replay_startWriter(&replay, replayFile, keyframeInterval);
+    game_setRecorder(&game, &replay);
+  }
+
+  SimTotals totals = { 0 };
+
+  uint64_t start = cli_nowNs();
+  for (long g = 0; g < options.games; g++) {
+    // Same seeds per game number as batch, so the two play identical games
+    unsigned inputSeed = seed + g;
+    TIMED(&options, ENTRY_RESTART, game_actionRestart(&game, seed + g));
+
+    long frame = 0;
+    while (game.state.playState == PLAY_PLAYING) {
+      if (frame == options.play.maxFrames) {
+        totals.capped++;
+        break;
+      }
+      GameInputs input = play_nextInput(&options.play, frame, &inputSeed);
+      stepFrame(&game, &options, input, (frame % options.play.gravity) == 0, &totals);
+      game_tick(&game);
+      frame++;
+    }
+
+    totals.frames += frame;
+    totals.pieces += game.state.pieces;
+    totals.lines += game.state.clearedLines;
+  }
+  uint64_t elapsed = cli_nowNs() - start;
+
+  if (replayFile) {
+    replay_finishWriter(&replay, &game);
+    printf("replay       %s, %ld bytes\n", recordPath, ftell(replayFile));
+    fclose(replayFile);
+  }
+
+  printReport(&options, &totals, elapsed);
+  return totals.drawMismatches ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+// Once-only wrapper
+#ifndef SIM_H_SEEN
+#define SIM_H_SEEN
+
+/**
+ * Run games with random or scripted inputs and report throughput
+ */
+int sim_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // SIM_H_SEEN
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../macos/game.h"
+#include "cli.h"
+#include "play.h"
+#include "snapshot.h"
+
+/**
+ * SNAPSHOT
+ * ############################################################################
+ * Plays games as sim does. Every frame it takes REPEATS snapshots, restores REPEATS times
+ * (alternating between this frame's snapshot and the last one's, as rollback would), then copies a
+ * snapshot and the whole GameInstance REPEATS times each for comparison. A search holding snapshots
+ * clones one with a 64 byte copy. Each batch is timed as one, so the timer's own
+ * cost is spread thin.
+ */
+
+#define REPEATS 32
+
+// Stop the compiler dropping copies that nothing reads
+#define CLOBBER(pointer) __asm__ volatile("" : : "r"(pointer) : "memory")
+
+struct SnapshotTotals {
+  long frames;
+  long mismatches;
+  uint64_t snapshotNs;
+  uint64_t restoreNs;
+  uint64_t copyNs;
+  uint64_t copySnapshotNs;
+} typedef SnapshotTotals;
+
+static bool sameGame(const GameInstance* a, const GameInstance* b) {
+  if (memcmp(&a->state, &b->state, sizeof(GameState)) != 0) return false;
+
+  for (int y = 0; y < HEIGHT; y++) {
+    if (a->field.rows[y] != b->field.rows[y]) return false;
+    for (int x = 0; x < WIDTH; x++) {
+      if (!(a->field.rows[y] & ROW_CELL_BIT(x)) && b->field.colours[y][x] != BLOCK_NONE) return false;
+    }
+  }
+  return true;
+}
+
+static void measureFrame(const GameInstance* game, GameInstance* clone, GameSnapshot* previous,
+  SnapshotTotals* totals) {
+  static GameSnapshot snapshots[REPEATS];
+  static GameInstance copies[REPEATS];
+  static GameSnapshot snapshotCopies[REPEATS];
+
+  uint64_t start = cli_nowNs();
+  for (int i = 0; i < REPEATS; i++) {
+    game_snapshot(game, &snapshots[i]);
+    CLOBBER(&snapshots[i]);
+  }
+  totals->snapshotNs += cli_nowNs() - start;
+
+  start = cli_nowNs();
+  for (int i = 0; i < REPEATS; i++) {
+    game_restore(clone, (i & 1) ? previous : &snapshots[0]);
+    CLOBBER(clone);
+  }
+  totals->restoreNs += cli_nowNs() - start;
+
+  start = cli_nowNs();
+  for (int i = 0; i < REPEATS; i++) {
+    copies[i] = *game;
+    CLOBBER(&copies[i]);
+  }
+  totals->copyNs += cli_nowNs() - start;
+
+  start = cli_nowNs();
+  for (int i = 0; i < REPEATS; i++) {
+    snapshotCopies[i] = snapshots[i];
+    CLOBBER(&snapshotCopies[i]);
+  }
+  totals->copySnapshotNs += cli_nowNs() - start;
+
+  // The last restore was the previous frame's, so put this frame's back and check it
+  game_restore(clone, &snapshots[0]);
+  if (!sameGame(game, clone)) totals->mismatches++;
+
+  *previous = snapshots[0];
+  totals->frames++;
+}
+
+int snapshot_main(int argc, char* argv[]) {
+  long games = cli_argInt(argc, argv, "--games", 1000);
+  unsigned seed = cli_argInt(argc, argv, "--seed", 1);
+  PlayOptions options;
+  if (!play_parseOptions(&options, argc, argv) || games < 1) {
+    fprintf(stderr, "snapshot: --games must be positive\n");
+    return 1;
+  }
+
+  static GameInstance game, clone;
+  game_init(&game);
+  game_init(&clone);
+  SnapshotTotals totals = { 0 };
+
+  for (long g = 0; g < games; g++) {
+    unsigned inputSeed = seed + g;
+    game_actionRestart(&game, seed + g);
+    GameSnapshot previous;
+    game_snapshot(&game, &previous);
+
+    for (long frame = 0; game.state.playState == PLAY_PLAYING && frame < options.maxFrames; frame++) {
+      play_frame(&game, &options, frame, &inputSeed);
+      measureFrame(&game, &clone, &previous, &totals);
+    }
+  }
+
+  double calls = (double) totals.frames * REPEATS;
+  printf("frames       %ld\n", totals.frames);
+  printf("%-12s %10s %10s\n", "", "bytes", "ns/call");
+  printf("%-12s %10zu %10.1f\n", "snapshot", sizeof(GameSnapshot), totals.snapshotNs / calls);
+  printf("%-12s %10zu %10.1f\n", "restore", sizeof(GameSnapshot), totals.restoreNs / calls);
+  printf("%-12s %10zu %10.1f\n", "copy snap", sizeof(GameSnapshot), totals.copySnapshotNs / calls);
+  printf("%-12s %10zu %10.1f\n", "copy game", sizeof(GameInstance), totals.copyNs / calls);
+  printf("mismatches   %ld\n", totals.mismatches);
+  return totals.mismatches ? 1 : 0;
+}
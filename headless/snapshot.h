@@ -0,0 +1,12 @@
+// Once-only wrapper
+#ifndef SNAPSHOT_H_SEEN
+#define SNAPSHOT_H_SEEN
+
+/**
+ * Time game_snapshot() and game_restore() against copying a whole GameInstance, and check every
+ * restore matches the game it was taken from
+ */
+int snapshot_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // SNAPSHOT_H_SEEN
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../macos/game.h"
+#include "../macos/timestep.h"
+#include "cli.h"
+#include "play.h"
+#include "timestep.h"
+
+/**
+ * TIMESTEP
+ * ############################################################################
+ * Plays each game once by stepping it directly, as sim does, then again through a Timestep at each
+ * simulated display rate, with a nanosecond clock. Frame times jitter by up to a quarter of a
+ * frame, and every --stall-every frames one takes --stall-ms instead, long enough to need several
+ * steps or, past MAX_STEPS, to drop some. Inputs belong to steps, not frames, so every rate has to
+ * finish each game with the same state on the same step. After every frame the steps run plus the
+ * steps dropped must also equal the steps the elapsed time is worth.
+ */
+
+#define STEPS_PER_SECOND 60
+#define MAX_STEPS 8
+#define CLOCK_HZ 1000000000ull
+
+static const int displayRates[] = { 24, 30, 60, 75, 120, 144, 240 };
+
+#define DISPLAY_RATES (sizeof(displayRates) / sizeof(displayRates[0]))
+
+struct RateTotals {
+  long frames;
+  long steps;
+  long busiest;        // Most steps in one frame
+  long idleFrames;     // Frames with no step due
+  uint64_t dropped;
+  long mismatches;
+  long clockErrors;
+} typedef RateTotals;
+
+/**
+ * Play the game through the scheduler. Returns the steps played
+ */
+static long playTimed(GameInstance* game, const PlayOptions* options, uint32_t pieceSeed, unsigned inputSeed,
+  int displayRate, long stallEvery, long stallMs, unsigned* jitterSeed, RateTotals* totals) {
+  Timestep timestep;
+  uint64_t now = 0;
+  timestep_init(&timestep, CLOCK_HZ, STEPS_PER_SECOND, MAX_STEPS, now);
+  game_actionRestart(game, pieceSeed);
+
+  uint64_t period = CLOCK_HZ / displayRate;
+  long step = 0;
+  bool clockOk = true;
+  for (long frame = 1; game->state.playState == PLAY_PLAYING && step < options->maxFrames; frame++) {
+    uint64_t duration = period - period / 8 + (uint64_t) rand_r(jitterSeed) % (period / 4);
+    if (stallEvery > 0 && frame % stallEvery == 0) duration = (uint64_t) stallMs * (CLOCK_HZ / 1000);
+    now += duration;
+
+    int steps = timestep_advance(&timestep, now);
+    for (int i = 0; i < steps && game->state.playState == PLAY_PLAYING && step < options->maxFrames; i++) {
+      play_frame(game, options, step++, &inputSeed);
+    }
+
+    if (timestep.steps + timestep.dropped != now * STEPS_PER_SECOND / CLOCK_HZ) clockOk = false;
+    totals->frames++;
+    totals->steps += steps;
+    if (steps > totals->busiest) totals->busiest = steps;
+    if (steps == 0) totals->idleFrames++;
+  }
+
+  totals->dropped += timestep.dropped;
+  if (!clockOk) totals->clockErrors++;
+  return step;
+}
+
+int timestep_main(int argc, char* argv[]) {
+  long games = cli_argInt(argc, argv, "--games", 100);
+  unsigned seed = cli_argInt(argc, argv, "--seed", 1);
+  long stallEvery = cli_argInt(argc, argv, "--stall-every", 500);
+  long stallMs = cli_argInt(argc, argv, "--stall-ms", 250);
+  PlayOptions options;
+  if (!play_parseOptions(&options, argc, argv) || games < 1 || stallEvery < 0 || stallMs < 1) {
+    fprintf(stderr, "timestep: --games and --stall-ms must be positive\n");
+    return 1;
+  }
+
+  static GameInstance reference;
+  static GameInstance timed;
+  game_init(&reference);
+  game_init(&timed);
+  RateTotals totals[DISPLAY_RATES] = { 0 };
+  unsigned jitterSeed = seed;
+
+  for (long g = 0; g < games; g++) {
+    unsigned inputSeed = seed + g;
+    long frames = play_game(&reference, &options, seed + g, &inputSeed);
+
+    for (size_t r = 0; r < DISPLAY_RATES; r++) {
+      long steps = playTimed(&timed, &options, seed + g, seed + g, displayRates[r], stallEvery, stallMs,
+        &jitterSeed, &totals[r]);
+      if (steps != frames || memcmp(&timed.state, &reference.state, sizeof(GameState)) != 0) {
+        if (!totals[r].mismatches) printf("%d Hz: game %ld differs from stepping directly\n", displayRates[r], g);
+        totals[r].mismatches++;
+      }
+    }
+  }
+
+  long failures = 0;
+  printf("display   frames   steps/frame   busiest   idle frames   dropped   mismatches   clock errors\n");
+  for (size_t r = 0; r < DISPLAY_RATES; r++) {
+    const RateTotals* t = &totals[r];
+    printf("%4d Hz %9ld %13.2f %9ld %12.1f%% %9llu %12ld %14ld\n", displayRates[r], t->frames,
+      (double) t->steps / t->frames, t->busiest, 100.0 * t->idleFrames / t->frames,
+      (unsigned long long) t->dropped, t->mismatches, t->clockErrors);
+    failures += t->mismatches + t->clockErrors;
+  }
+  return failures ? 1 : 0;
+}
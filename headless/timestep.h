@@ -0,0 +1,12 @@
+// Once-only wrapper
+#ifndef HEADLESS_TIMESTEP_H_SEEN
+#define HEADLESS_TIMESTEP_H_SEEN
+
+/**
+ * Drive the fixed timestep scheduler with simulated display rates, jitter and stalls, and check
+ * every rate plays the same games as stepping directly
+ */
+int timestep_main(int argc, char* argv[]);
+
+// Once-only wrapper
+#endif // HEADLESS_TIMESTEP_H_SEEN
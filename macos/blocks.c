@@ -29,18 +29,108 @@
  *        etc.
  * 
  * Or to get x/y = 0xCC00 & (0x8000 >> ((y * 4) + x))
+ *
+ * Because field rows are read from 0x8000 the same way, a shape row lines up with a field row by
+ * moving it to the top nibble and shifting right by the wall width plus the x position.
+ * The placement table below does this ahead of time for every x.
  * ================================================================================================
  */
 
-static shapeHex shapeHexes[8][4] = {
-  { 0 },                              // EMPTY   
-  { 0x0F00, 0x4444, 0x0F00, 0x4444 }, // I
-  { 0xE200, 0x44C0, 0x8E00, 0xC880 }, // J
-  { 0xE800, 0xC440, 0x2E00, 0x88C0 }, // L
-  { 0xCC00, 0xCC00, 0xCC00, 0xCC00 }, // O
-  { 0x6C00, 0x8C40, 0x6C00, 0x8C40 }, // S
-  { 0x0E40, 0x4C40, 0x4E00, 0x4640 }, // T
-  { 0x4C80, 0xC600, 0x4C80, 0xC600 }, // Z
+#define SHAPE_HEXES(BLOCK) \
+  BLOCK(0, 0, 0, 0)                     /* EMPTY */ \
+  BLOCK(0x0F00, 0x4444, 0x0F00, 0x4444) /* I */ \
+  BLOCK(0xE200, 0x44C0, 0x8E00, 0xC880) /* J */ \
+  BLOCK(0xE800, 0xC440, 0x2E00, 0x88C0) /* L */ \
+  BLOCK(0xCC00, 0xCC00, 0xCC00, 0xCC00) /* O */ \
+  BLOCK(0x6C00, 0x8C40, 0x6C00, 0x8C40) /* S */ \
+  BLOCK(0x0E40, 0x4C40, 0x4E00, 0x4640) /* T */ \
+  BLOCK(0x4C80, 0xC600, 0x4C80, 0xC600) /* Z */
+
+#define AS_SHAPE_HEXES(r0, r1, r2, r3) { r0, r1, r2, r3 },
+
+static shapeHex shapeHexes[8][4] = { SHAPE_HEXES(AS_SHAPE_HEXES) };
+
+/**
+ * Placement table
+ * ================================================================================================
+ * Every block, rotation and x position, expanded by the preprocessor from the same SHAPE_HEXES
+ * list as above, so the two can't drift apart. Collision checks become table lookups plus one AND
+ * per occupied row.
+ *
+ * Empty shapes get an inverted bounding box (top 4, bottom -1) so row loops don't run.
+ */
+
+// Shape hexes are 16 bits; wider field rows start from their own top bit
+#define SHAPE_TO_ROW(bits) ((uint32_t) (bits) << (ROW_BITS - 16))
+#define SHAPE_ROW(s, y, x) (SHAPE_TO_ROW(((s) << ((y) * 4)) & 0xF000) >> (WALL_BITS + (x)))
+#define SHAPE_COLUMNS(s) (((s) | ((s) << 4) | ((s) << 8) | ((s) << 12)) & 0xF000)
+
+#define SHAPE_TOP(s) \
+  ((s) & 0xF000 ? 0 : (s) & 0x0F00 ? 1 : (s) & 0x00F0 ? 2 : (s) & 0x000F ? 3 : 4)
+#define SHAPE_BOTTOM(s) \
+  ((s) & 0x000F ? 3 : (s) & 0x00F0 ? 2 : (s) & 0x0F00 ? 1 : (s) & 0xF000 ? 0 : -1)
+#define SHAPE_LEFT(s) \
+  ((s) & 0x8888 ? 0 : (s) & 0x4444 ? 1 : (s) & 0x2222 ? 2 : (s) & 0x1111 ? 3 : 4)
+#define SHAPE_RIGHT(s) \
+  ((s) & 0x1111 ? 3 : (s) & 0x2222 ? 2 : (s) & 0x4444 ? 1 : (s) & 0x8888 ? 0 : -1)
+
+#define SHAPE_SKIRT(s, column) ( \
+  (s) & (0x0008 >> (column)) ? 3 : (s) & (0x0080 >> (column)) ? 2 : \
+  (s) & (0x0800 >> (column)) ? 1 : (s) & (0x8000 >> (column)) ? 0 : -1 \
+)
+
+#define SHAPE_WALLS(s, x) ( \
+  ((SHAPE_TO_ROW(SHAPE_COLUMNS(s)) >> (WALL_BITS + (x))) & ROW_LEFT_WALL ? PLACEMENT_LEFTWALL : 0) | \
+  ((SHAPE_TO_ROW(SHAPE_COLUMNS(s)) >> (WALL_BITS + (x))) & ROW_RIGHT_WALL ? PLACEMENT_RIGHTWALL : 0) \
+)
+
+#define PLACEMENT(s, x) { \
+  { SHAPE_ROW(s, 0, x), SHAPE_ROW(s, 1, x), SHAPE_ROW(s, 2, x), SHAPE_ROW(s, 3, x) }, \
+  SHAPE_TOP(s), SHAPE_BOTTOM(s), SHAPE_LEFT(s), SHAPE_RIGHT(s), \
+  { SHAPE_SKIRT(s, 0), SHAPE_SKIRT(s, 1), SHAPE_SKIRT(s, 2), SHAPE_SKIRT(s, 3) }, \
+  SHAPE_WALLS(s, x) \
+}
+
+/**
+ * One per x from -WALL_BITS to WIDTH - 1. The preprocessor can't loop, so each width's list is the
+ * one narrower plus a column, and PLACEMENTS picks the list for WIDTH by pasting it into the name
+ */
+#define PLACEMENTS_WIDTH_4(s) \
+  PLACEMENT(s, -3), PLACEMENT(s, -2), PLACEMENT(s, -1), PLACEMENT(s, 0), PLACEMENT(s, 1), \
+  PLACEMENT(s, 2), PLACEMENT(s, 3)
+#define PLACEMENTS_WIDTH_5(s) PLACEMENTS_WIDTH_4(s), PLACEMENT(s, 4)
+#define PLACEMENTS_WIDTH_6(s) PLACEMENTS_WIDTH_5(s), PLACEMENT(s, 5)
+#define PLACEMENTS_WIDTH_7(s) PLACEMENTS_WIDTH_6(s), PLACEMENT(s, 6)
+#define PLACEMENTS_WIDTH_8(s) PLACEMENTS_WIDTH_7(s), PLACEMENT(s, 7)
+#define PLACEMENTS_WIDTH_9(s) PLACEMENTS_WIDTH_8(s), PLACEMENT(s, 8)
+#define PLACEMENTS_WIDTH_10(s) PLACEMENTS_WIDTH_9(s), PLACEMENT(s, 9)
+#define PLACEMENTS_WIDTH_11(s) PLACEMENTS_WIDTH_10(s), PLACEMENT(s, 10)
+#define PLACEMENTS_WIDTH_12(s) PLACEMENTS_WIDTH_11(s), PLACEMENT(s, 11)
+#define PLACEMENTS_WIDTH_13(s) PLACEMENTS_WIDTH_12(s), PLACEMENT(s, 12)
+#define PLACEMENTS_WIDTH_14(s) PLACEMENTS_WIDTH_13(s), PLACEMENT(s, 13)
+#define PLACEMENTS_WIDTH_15(s) PLACEMENTS_WIDTH_14(s), PLACEMENT(s, 14)
+#define PLACEMENTS_WIDTH_16(s) PLACEMENTS_WIDTH_15(s), PLACEMENT(s, 15)
+#define PLACEMENTS_WIDTH_17(s) PLACEMENTS_WIDTH_16(s), PLACEMENT(s, 16)
+#define PLACEMENTS_WIDTH_18(s) PLACEMENTS_WIDTH_17(s), PLACEMENT(s, 17)
+#define PLACEMENTS_WIDTH_19(s) PLACEMENTS_WIDTH_18(s), PLACEMENT(s, 18)
+#define PLACEMENTS_WIDTH_20(s) PLACEMENTS_WIDTH_19(s), PLACEMENT(s, 19)
+#define PLACEMENTS_WIDTH_21(s) PLACEMENTS_WIDTH_20(s), PLACEMENT(s, 20)
+#define PLACEMENTS_WIDTH_22(s) PLACEMENTS_WIDTH_21(s), PLACEMENT(s, 21)
+#define PLACEMENTS_WIDTH_23(s) PLACEMENTS_WIDTH_22(s), PLACEMENT(s, 22)
+#define PLACEMENTS_WIDTH_24(s) PLACEMENTS_WIDTH_23(s), PLACEMENT(s, 23)
+#define PLACEMENTS_WIDTH_25(s) PLACEMENTS_WIDTH_24(s), PLACEMENT(s, 24)
+#define PLACEMENTS_WIDTH_26(s) PLACEMENTS_WIDTH_25(s), PLACEMENT(s, 25)
+
+#define PLACEMENTS_FOR(s, width) PLACEMENTS_WIDTH_ ## width(s)
+#define PLACEMENTS_EXPAND(s, width) PLACEMENTS_FOR(s, width)
+#define PLACEMENTS(s) { PLACEMENTS_EXPAND(s, BOARD_WIDTH) }
+
+#define AS_PLACEMENTS(r0, r1, r2, r3) { \
+  PLACEMENTS(r0), PLACEMENTS(r1), PLACEMENTS(r2), PLACEMENTS(r3) \
+},
+
+static const ShapePlacement shapePlacements[8][4][PLACEMENT_COLUMNS] = {
+  SHAPE_HEXES(AS_PLACEMENTS)
 };
 
 int getShapeBit(shapeHex s, int y, int x) {
@@ -52,6 +142,31 @@ rotationIndex getNextRotation(int r) {
   return (r + 1) % 4;
 }
 
+void getSpawnPosition(BlockNames key, int* x, int* y) {
+  // Centred, leaning left on odd widths: x = 4 (3 for I) on the standard board
+  *x = (WIDTH - 4) / 2 + 1;
+  *y = 0;
+
+  switch (key) {
+    case BLOCK_I:
+      *x = (WIDTH - 4) / 2;
+      *y = 1;
+      break;
+    case BLOCK_T:
+      *y = 1;
+      break;
+    case BLOCK_J:
+    case BLOCK_L:
+    case BLOCK_O:
+    case BLOCK_S:
+    case BLOCK_Z:
+      *y = 2;
+      break;
+    default:
+      assert(key != BLOCK_NONE);
+  }
+}
+
 shapeHex getBlockShape(BlockNames key, rotationIndex r) {
   assert(key >= 0 && key < 8);
   assert(r >= 0 && r < 4);
@@ -59,12 +174,95 @@ shapeHex getBlockShape(BlockNames key, rotationIndex r) {
   return shapeHexes[key][r];
 }
 
+const ShapePlacement* getShapePlacement(BlockNames key, rotationIndex r, int x) {
+  assert(key >= 0 && key < 8);
+  assert(r >= 0 && r < 4);
+  assert(x >= PLACEMENT_MIN_X && x < WIDTH);
+
+  return &shapePlacements[key][r][x - PLACEMENT_MIN_X];
+}
+
 /**
  * Randomisation
  * ================================================================================================
+ * Each game draws pieces from its own xorshift32 generator (just shifts and XORs), seeded
+ * explicitly so that a seed always replays the same pieces.
+ *
+ * Pieces come out of a 7-bag: all seven once, in random order, then a fresh bag. The bag is a
+ * bitmask of the pieces not drawn yet. Drawn pieces wait in a ring buffer so callers can look ahead.
  */
 
-BlockNames randomBlock() {
-  // Not truly random (has skew) but probably fine for a game
-  return (rand() % 7) + 1;
+#define BAG_FULL 0x7F
+
+static uint32_t nextRandom(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/**
+ * Random number in [0, n) without modulo bias (Lemire's multiply-shift, retrying on the short bucket)
+ */
+static uint32_t randomBelow(uint32_t* state, uint32_t n) {
+  uint64_t product = (uint64_t) nextRandom(state) * n;
+  uint32_t low = (uint32_t) product;
+  if (low < n) {
+    uint32_t threshold = -n % n;
+    while (low < threshold) {
+      product = (uint64_t) nextRandom(state) * n;
+      low = (uint32_t) product;
+    }
+  }
+  return product >> 32;
+}
+
+static BlockNames drawFromBag(PieceQueue* queue) {
+  if (queue->bag == 0) {
+    queue->bag = BAG_FULL;
+  }
+
+  int remaining = 0;
+  for (int bit = 0; bit < 7; bit++) {
+    remaining += (queue->bag >> bit) & 1;
+  }
+
+  uint32_t pick = randomBelow(&queue->random, remaining);
+  for (int bit = 0; bit < 7; bit++) {
+    if (!(queue->bag & (1 << bit))) continue;
+    if (pick-- == 0) {
+      queue->bag &= ~(1 << bit);
+      return bit + 1;
+    }
+  }
+
+  assert(false);
+  return BLOCK_NONE;
+}
+
+void seedPieces(PieceQueue* queue, uint32_t seed) {
+  // Spread nearby seeds apart, and keep xorshift away from its stuck state of zero
+  seed *= 0x9E3779B9;
+  seed ^= seed >> 16;
+  queue->random = seed ? seed : 0x6D2B79F5;
+
+  queue->bag = 0;
+  queue->head = 0;
+  for (int i = 0; i < PREVIEW_LENGTH; i++) {
+    queue->preview[i] = drawFromBag(queue);
+  }
+}
+
+BlockNames nextPiece(PieceQueue* queue) {
+  BlockNames block = queue->preview[queue->head];
+  queue->preview[queue->head] = drawFromBag(queue);
+  queue->head = (queue->head + 1) % PREVIEW_LENGTH;
+  return block;
+}
+
+BlockNames peekPiece(const PieceQueue* queue, int n) {
+  assert(n >= 0 && n < PREVIEW_LENGTH);
+  return queue->preview[(queue->head + n) % PREVIEW_LENGTH];
 }
@@ -1,12 +1,63 @@
+// Once-only wrapper
+#ifndef BLOCKS_H_SEEN
+#define BLOCKS_H_SEEN
+
 #include "defs.h"
 
 typedef int shapeHex;
 typedef int rotationIndex;
 
+#define PLACEMENT_MIN_X (-WALL_BITS)
+#define PLACEMENT_COLUMNS (WIDTH + WALL_BITS)
+
+typedef enum PlacementWalls {
+  PLACEMENT_LEFTWALL = 1,
+  PLACEMENT_RIGHTWALL = 2
+} PlacementWalls;
+
+/**
+ * A shape at a given x: its rows shifted ready to AND against field rows, the bounding box of its
+ * cells within the 4x4 grid, and which walls (if any) it overlaps at that x. The skirt is the
+ * lowest cell in each column of the grid (-1 for none), for finding drop distances from column
+ * heights
+ */
+struct ShapePlacement {
+  FieldRow rows[4];
+  int8_t top;
+  int8_t bottom;
+  int8_t left;
+  int8_t right;
+  int8_t skirt[4];
+  uint8_t walls;
+} typedef ShapePlacement;
+
 int getShapeBit(shapeHex s, int y, int x);
 
 rotationIndex getNextRotation(int r);
 
 shapeHex getBlockShape(BlockNames key, rotationIndex r);
 
-BlockNames randomBlock();
+const ShapePlacement* getShapePlacement(BlockNames key, rotationIndex r, int x);
+
+/**
+ * Where a piece appears, in rotation 0
+ */
+void getSpawnPosition(BlockNames key, int* x, int* y);
+
+/**
+ * Reset the queue to the start of the sequence for this seed
+ */
+void seedPieces(PieceQueue* queue, uint32_t seed);
+
+/**
+ * Take the next piece from the queue (and draw another into the preview)
+ */
+BlockNames nextPiece(PieceQueue* queue);
+
+/**
+ * Look at an upcoming piece without taking it; 0 is the piece nextPiece() will return
+ */
+BlockNames peekPiece(const PieceQueue* queue, int n);
+
+// Once-only wrapper
+#endif // BLOCKS_H_SEEN
@@ -0,0 +1,220 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bot.h"
+#include "game.h"
+
+/**
+ * bot.c
+ * ================================================================================================
+ * Each layer of the search allocates the next beam's nodes, then the candidate list above them.
+ * Once the best candidates are placed into the new nodes, the arena rewinds past the candidates,
+ * so a decision needs (layers * beamWidth) nodes plus one layer's candidates, sized up front.
+ * ================================================================================================
+ */
+
+struct BotNode {
+  GameSnapshot snapshot;
+  int32_t reward;  // Lines scored on the way here
+  Move rootMove;   // The current piece's move that leads here
+} typedef BotNode;
+
+struct BotCandidate {
+  int32_t score;
+  uint16_t parent;
+  uint32_t order;  // Position in the candidate list, to break ties the same way every time
+  Move move;
+} typedef BotCandidate;
+
+static void* arenaAlloc(BotArena* arena, size_t size) {
+  size = (size + 15) & ~(size_t) 15;
+  assert(arena->used + size <= arena->capacity);
+  void* pointer = arena->bytes + arena->used;
+  arena->used += size;
+  return pointer;
+}
+
+static int compareCandidates(const void* a, const void* b) {
+  const BotCandidate* left = a;
+  const BotCandidate* right = b;
+  if (left->score != right->score) return left->score > right->score ? -1 : 1;
+  return (left->order > right->order) - (left->order < right->order);
+}
+
+static int32_t scoreBoard(const BotWeights* weights, const EvalBatch* batch, int i) {
+  return weights->aggregateHeight * batch->aggregateHeight[i]
+    + weights->holes * batch->holes[i]
+    + weights->bumpiness * batch->bumpiness[i]
+    + weights->wells * batch->wells[i]
+    + weights->rowTransitions * batch->rowTransitions[i];
+}
+
+/**
+ * Score every landing from every node in the beam. Returns the number of candidates
+ */
+static int expandBeam(Bot* bot, const BotNode* beam, int beamCount, BotCandidate* candidates) {
+  const BotWeights* weights = &bot->options.weights;
+  int count = 0;
+  for (int parent = 0; parent < beamCount; parent++) {
+    game_restore(&bot->scratch, &beam[parent].snapshot);
+    if (bot->scratch.state.playState != PLAY_PLAYING) continue;
+
+    movegen_generate(&bot->scratch, &bot->moves);
+    eval_placements(&bot->scratch, &bot->moves, &bot->batch);
+    for (int i = 0; i < bot->moves.count; i++) {
+      BotCandidate* candidate = &candidates[count];
+      candidate->score = beam[parent].reward + weights->lines[bot->batch.linesCleared[i]]
+        + scoreBoard(weights, &bot->batch, i);
+      candidate->parent = parent;
+      candidate->order = count++;
+      candidate->move = bot->moves.moves[i];
+    }
+    bot->nodes += bot->moves.count;
+  }
+  return count;
+}
+
+/**
+ * Place the best candidates into next, skipping any that end the game. Returns how many
+ */
+static int fillBeam(Bot* bot, const BotNode* beam, BotCandidate* candidates, int count, BotNode* next, int depth) {
+  qsort(candidates, count, sizeof(BotCandidate), compareCandidates);
+
+  int filled = 0;
+  for (int i = 0; i < count && filled < bot->options.beamWidth; i++) {
+    const BotCandidate* candidate = &candidates[i];
+    const BotNode* parent = &beam[candidate->parent];
+    game_restore(&bot->scratch, &parent->snapshot);
+    game_actionPlace(&bot->scratch, candidate->move.x, candidate->move.rotation, candidate->move.y);
+    if (bot->scratch.state.playState != PLAY_PLAYING) continue;
+
+    // Candidates are best first, so a board already placed this decision got there a better way
+    if (bot->table.buckets) {
+      uint64_t key = bot->scratch.field.hash ^ (uint64_t) bot->scratch.state.pieces * 0x9E3779B97F4A7C15ull;
+      const TTEntry* entry = tt_probe(&bot->table, key);
+      if (entry && tt_isCurrent(&bot->table, entry)) {
+        bot->duplicates++;
+        continue;
+      }
+      tt_store(&bot->table, key, depth, candidate->score, candidate->move);
+    }
+
+    BotNode* node = &next[filled++];
+    game_snapshot(&bot->scratch, &node->snapshot);
+    node->reward = parent->reward + bot->options.weights.lines[__builtin_popcount(bot->scratch.state.clearedRows)];
+    node->rootMove = depth == 0 ? candidate->move : parent->rootMove;
+  }
+  return filled;
+}
+
+/**
+ * Public functions
+ * ============================================================================
+ */
+
+void bot_defaultOptions(BotOptions* options) {
+  *options = (BotOptions) {
+    .beamWidth = 32,
+    .lookahead = BOT_MAX_LOOKAHEAD,
+    .tableBytes = 1 << 20,
+    .weights = {
+      .aggregateHeight = -51,
+      .holes = -360,
+      .bumpiness = -18,
+      .wells = -20,
+      .rowTransitions = -30,
+      .lines = { 0, -100, -50, 50, 800 },
+    },
+  };
+}
+
+bool bot_init(Bot* bot, const BotOptions* options) {
+  memset(bot, 0, sizeof(Bot));
+  if (options->beamWidth < 1 || options->beamWidth > UINT16_MAX) return false;
+  if (options->lookahead < 0 || options->lookahead > BOT_MAX_LOOKAHEAD) return false;
+
+  bot->options = *options;
+  size_t layers = options->lookahead + 2;  // The root, then one per piece placed
+  size_t nodeBytes = (options->beamWidth * sizeof(BotNode) + 15) & ~(size_t) 15;
+  size_t candidateBytes = (options->beamWidth * MOVEGEN_MAX_MOVES * sizeof(BotCandidate) + 15) & ~(size_t) 15;
+  bot->arena.capacity = layers * nodeBytes + candidateBytes;
+  bot->arena.bytes = malloc(bot->arena.capacity);
+  game_init(&bot->scratch);
+  if (!bot->arena.bytes) return false;
+  return !options->tableBytes || tt_init(&bot->table, options->tableBytes);
+}
+
+void bot_free(Bot* bot) {
+  free(bot->arena.bytes);
+  bot->arena.bytes = NULL;
+  if (bot->table.buckets) tt_free(&bot->table);
+}
+
+bool bot_decide(Bot* bot, const GameInstance* game, Move* move) {
+  if (game->state.playState != PLAY_PLAYING) return false;
+  bot->arena.used = 0;
+  bot->scratch = *game;
+  game_detach(&bot->scratch);
+  bot->decisions++;
+  if (bot->table.buckets) tt_newSearch(&bot->table);
+
+  BotNode* beam = arenaAlloc(&bot->arena, bot->options.beamWidth * sizeof(BotNode));
+  game_snapshot(game, &beam[0].snapshot);
+  beam[0].reward = 0;
+  int beamCount = 1;
+
+  for (int depth = 0; depth <= bot->options.lookahead; depth++) {
+    BotNode* next = arenaAlloc(&bot->arena, bot->options.beamWidth * sizeof(BotNode));
+    size_t mark = bot->arena.used;
+    BotCandidate* candidates = arenaAlloc(&bot->arena, beamCount * MOVEGEN_MAX_MOVES * sizeof(BotCandidate));
+
+    int count = expandBeam(bot, beam, beamCount, candidates);
+    int filled = fillBeam(bot, beam, candidates, count, next, depth);
+
+    // Every line ends the game: take the best-looking loss now, or the best board from the layer before
+    if (!filled) {
+      bool lastMove = depth == 0 && count;
+      if (lastMove) *move = candidates[0].move;
+      bot->arena.used = mark;
+      if (depth == 0) return lastMove;
+      break;
+    }
+    bot->arena.used = mark;
+    beam = next;
+    beamCount = filled;
+  }
+
+  *move = beam[0].rootMove;
+  return true;
+}
+
+bool bot_play(Bot* bot, GameInstance* game) {
+  Move move;
+  if (!bot_decide(bot, game, &move)) return false;
+
+  int length = movegen_path(game, &move, bot->path);
+  if (length < 1) return false;
+  for (int i = 0; i < length; i++) {
+    switch (bot->path[i]) {
+      case INPUT_LEFT:
+        game_actionMovement(game, MOVE_LEFT);
+        break;
+      case INPUT_RIGHT:
+        game_actionMovement(game, MOVE_RIGHT);
+        break;
+      case INPUT_UP:
+        game_actionRotate(game);
+        break;
+      case INPUT_SOFTDROP:
+        game_actionSoftDrop(game);
+        break;
+      case INPUT_DOWN:
+        game_actionHardDrop(game);
+        break;
+      default:
+        break;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,93 @@
+// Once-only wrapper
+#ifndef BOT_H_SEEN
+#define BOT_H_SEEN
+
+#include <stddef.h>
+
+#include "defs.h"
+#include "evaluate.h"
+#include "movegen.h"
+#include "transposition.h"
+
+/**
+ * Beam search player. For the current piece and then each preview piece in turn, every board in
+ * the beam is expanded by every landing (movegen_generate()), the results scored together
+ * (eval_placements()) and the best beamWidth kept. The move is the first placement on the path to
+ * the best board at the end. Lines score as they clear; the board at each step scores by its
+ * features.
+ *
+ * Different placements often reach the same board. With a transposition table, each board (by
+ * field hash and pieces placed) is kept once per decision, from the best scoring path, and the
+ * others are pruned before they're expanded.
+ *
+ * All nodes for one decision come from a bump arena allocated by bot_init() and reset at the start
+ * of the next, so searching never calls malloc.
+ */
+
+#define BOT_MAX_LOOKAHEAD PREVIEW_LENGTH
+
+/**
+ * Score weights, applied to FieldFeatures totals (negative for bad) and to each clear by lines
+ */
+struct BotWeights {
+  int aggregateHeight;
+  int holes;
+  int bumpiness;
+  int wells;
+  int rowTransitions;
+  int lines[5];  // Indexed by lines cleared at once, [0] unused
+} typedef BotWeights;
+
+struct BotOptions {
+  int beamWidth;
+  int lookahead;      // Preview pieces to search past the current one, up to BOT_MAX_LOOKAHEAD
+  size_t tableBytes;  // Transposition table size, 0 for none
+  BotWeights weights;
+} typedef BotOptions;
+
+struct BotArena {
+  uint8_t* bytes;
+  size_t capacity;
+  size_t used;
+} typedef BotArena;
+
+struct Bot {
+  BotOptions options;
+  BotArena arena;
+  long nodes;       // Placements scored, over every decision
+  long duplicates;  // Boards pruned as already in the beam
+  long decisions;
+  TranspositionTable table;
+  GameInstance scratch;
+  MoveList moves;
+  EvalBatch batch;
+  GameInputs path[MOVEGEN_MAX_PATH];
+} typedef Bot;
+
+/**
+ * Defaults: a beam of 32 through the whole preview with a 1 MB table, and weights that clear lines reliably
+ */
+void bot_defaultOptions(BotOptions* options);
+
+/**
+ * Size and allocate the arena for these options. Returns false if they're out of range or
+ * allocation fails. Bot is large, so keep it static or on the heap
+ */
+bool bot_init(Bot* bot, const BotOptions* options);
+
+void bot_free(Bot* bot);
+
+/**
+ * Search for the current piece's move. Returns false if there is none (the game is over)
+ */
+bool bot_decide(Bot* bot, const GameInstance* game, Move* move);
+
+/**
+ * Decide, then play the move through game_actionMovement(), game_actionRotate(),
+ * game_actionSoftDrop() and game_actionHardDrop(), as a player's inputs would. Returns false if
+ * there was no move
+ */
+bool bot_play(Bot* bot, GameInstance* game);
+
+// Once-only wrapper
+#endif // BOT_H_SEEN
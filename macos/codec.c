@@ -0,0 +1,393 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "codec.h"
+
+/**
+ * codec.c
+ * ================================================================================================
+ * Replays are mostly short runs of the same few inputs: soft drops every couple of frames, a burst
+ * of moves and rotates after each spawn, then a hard drop. So each event becomes one symbol:
+ *
+ * symbol = input | (min(frameDelta, 15) << 3)
+ *
+ * coded with a static rANS model per block, conditioned on the previous event's input. A hard drop
+ * or restart (a spawn) predicts moves and rotates, a soft drop predicts more soft drops, and so on.
+ * Frame deltas of 15 or more, and the seeds after restarts, go in an 'extra' stream of varints
+ * alongside.
+ *
+ * Header: "NTRC", a version byte
+ * Block:  varint event count (0 ends the file)
+ *         the model: for each context, varint number of symbols used, then byte symbol and varint
+ *         frequency for each. Frequencies add up to 1 << CODEC_SCALE_BITS
+ *         varint extra length, extra bytes
+ *         varint rANS length, rANS bytes (final state first, little-endian)
+ *
+ * The coder is the byte-wise rANS from Fabian Giesen's ryg_rans. It encodes backwards, which is
+ * why events are buffered a block at a time.
+ * ================================================================================================
+ */
+
+#define CODEC_MAGIC "NTRC"
+#define CODEC_VERSION 1
+#define INPUT_BITS 3
+#define INPUT_MASK ((1 << INPUT_BITS) - 1)
+#define DELTA_ESCAPE 15
+#define SCALE (1 << CODEC_SCALE_BITS)
+#define RANS_LOW (1u << 23)
+#define VARINT_MAX_BYTES 10
+
+/**
+ * Byte helpers
+ * ================================================================================================
+ */
+
+static uint8_t* putVarint(uint8_t* out, uint64_t value) {
+  while (value >= 0x80) {
+    *out++ = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  *out++ = value;
+  return out;
+}
+
+static bool getVarint(const uint8_t** in, const uint8_t* end, uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64 && *in < end; shift += 7) {
+    uint8_t byte = *(*in)++;
+    result |= (uint64_t) (byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void writeBytes(CodecEncoder* encoder, const uint8_t* bytes, size_t length) {
+  fwrite(bytes, 1, length, encoder->file);
+  encoder->bytes += length;
+}
+
+static void writeVarint(CodecEncoder* encoder, uint64_t value) {
+  uint8_t bytes[VARINT_MAX_BYTES];
+  writeBytes(encoder, bytes, putVarint(bytes, value) - bytes);
+}
+
+static bool readVarint(FILE* file, uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = getc_unlocked(file);
+    if (byte == EOF) return false;
+
+    result |= (uint64_t) (byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * The model
+ * ================================================================================================
+ */
+
+static uint8_t toSymbol(GameInputs input, uint32_t delta) {
+  return input | (delta < DELTA_ESCAPE ? delta : DELTA_ESCAPE) << INPUT_BITS;
+}
+
+/**
+ * Scale counts to frequencies adding up to SCALE. Every symbol seen keeps at least 1
+ */
+static void normalise(const uint32_t* counts, uint16_t* frequency) {
+  uint64_t total = 0;
+  for (int s = 0; s < CODEC_SYMBOLS; s++) {
+    total += counts[s];
+  }
+  memset(frequency, 0, CODEC_SYMBOLS * sizeof(uint16_t));
+  if (!total) return;
+
+  int sum = 0;
+  for (int s = 0; s < CODEC_SYMBOLS; s++) {
+    if (!counts[s]) continue;
+    uint64_t scaled = counts[s] * SCALE / total;
+    frequency[s] = scaled ? scaled : 1;
+    sum += frequency[s];
+  }
+
+  // Rounding leaves the sum a little off, so the most common symbols take up the slack
+  while (sum != SCALE) {
+    int largest = 0;
+    for (int s = 1; s < CODEC_SYMBOLS; s++) {
+      if (frequency[s] > frequency[largest]) largest = s;
+    }
+    if (sum < SCALE) {
+      frequency[largest] += SCALE - sum;
+      sum = SCALE;
+    } else {
+      int take = sum - SCALE < frequency[largest] - 1 ? sum - SCALE : frequency[largest] - 1;
+      assert(take > 0);
+      frequency[largest] -= take;
+      sum -= take;
+    }
+  }
+}
+
+static void buildStarts(CodecModel* model, bool decoding) {
+  for (int c = 0; c < CODEC_CONTEXTS; c++) {
+    int start = 0;
+    for (int s = 0; s < CODEC_SYMBOLS; s++) {
+      model->start[c][s] = start;
+      if (decoding) {
+        memset(&model->symbol[c][start], s, model->frequency[c][s]);
+      }
+      start += model->frequency[c][s];
+    }
+  }
+}
+
+/**
+ * Encoding
+ * ================================================================================================
+ */
+
+static void encodeBlock(CodecEncoder* encoder) {
+  int count = encoder->eventCount;
+  if (!count) return;
+
+  // The events before this block, to work out each event's context and delta
+  uint32_t frame = encoder->lastFrame;
+  GameInputs input = encoder->lastInput;
+
+  uint32_t counts[CODEC_CONTEXTS][CODEC_SYMBOLS] = { { 0 } };
+  uint8_t* extra = malloc(count * 2 * VARINT_MAX_BYTES);
+  uint8_t* extraEnd = extra;
+  assert(extra != NULL);
+
+  for (int i = 0; i < count; i++) {
+    const ReplayEvent* event = &encoder->events[i];
+    uint32_t delta = event->frame - frame;
+    counts[input][toSymbol(event->input, delta)]++;
+
+    if (delta >= DELTA_ESCAPE) {
+      extraEnd = putVarint(extraEnd, delta - DELTA_ESCAPE);
+    }
+    if (event->input == INPUT_RESTART) {
+      extraEnd = putVarint(extraEnd, event->seed);
+    }
+    frame = event->frame;
+    input = event->input;
+  }
+
+  CodecModel model;
+  for (int c = 0; c < CODEC_CONTEXTS; c++) {
+    normalise(counts[c], model.frequency[c]);
+  }
+  buildStarts(&model, false);
+
+  // rANS runs backwards, from the last event to the first
+  size_t capacity = count * 2 + 4;
+  uint8_t* rans = malloc(capacity);
+  uint8_t* ransEnd = rans + capacity;
+  uint8_t* out = ransEnd;
+  assert(rans != NULL);
+
+  uint32_t state = RANS_LOW;
+  for (int i = count - 1; i >= 0; i--) {
+    const ReplayEvent* event = &encoder->events[i];
+    const ReplayEvent* previous = i ? &encoder->events[i - 1] : NULL;
+    GameInputs context = previous ? previous->input : encoder->lastInput;
+    uint32_t delta = event->frame - (previous ? previous->frame : encoder->lastFrame);
+
+    uint8_t symbol = toSymbol(event->input, delta);
+    uint32_t frequency = model.frequency[context][symbol];
+    uint32_t stateMax = ((RANS_LOW >> CODEC_SCALE_BITS) << 8) * frequency;
+    while (state >= stateMax) {
+      *--out = state & 0xFF;
+      state >>= 8;
+    }
+    state = ((state / frequency) << CODEC_SCALE_BITS) + (state % frequency) + model.start[context][symbol];
+  }
+  out -= 4;
+  for (int i = 0; i < 4; i++) {
+    out[i] = state >> (i * 8);
+  }
+  assert(out >= rans);
+
+  writeVarint(encoder, count);
+  for (int c = 0; c < CODEC_CONTEXTS; c++) {
+    int used = 0;
+    for (int s = 0; s < CODEC_SYMBOLS; s++) {
+      used += model.frequency[c][s] != 0;
+    }
+    writeVarint(encoder, used);
+    for (int s = 0; s < CODEC_SYMBOLS; s++) {
+      if (!model.frequency[c][s]) continue;
+      uint8_t symbol = s;
+      writeBytes(encoder, &symbol, 1);
+      writeVarint(encoder, model.frequency[c][s]);
+    }
+  }
+  writeVarint(encoder, extraEnd - extra);
+  writeBytes(encoder, extra, extraEnd - extra);
+  writeVarint(encoder, ransEnd - out);
+  writeBytes(encoder, out, ransEnd - out);
+
+  encoder->lastFrame = frame;
+  encoder->lastInput = input;
+  encoder->eventCount = 0;
+  free(extra);
+  free(rans);
+}
+
+bool codec_startEncoder(CodecEncoder* encoder, FILE* file) {
+  encoder->file = file;
+  encoder->events = malloc(CODEC_BLOCK_EVENTS * sizeof(ReplayEvent));
+  encoder->eventCount = 0;
+  encoder->lastFrame = 0;
+  encoder->lastInput = INPUT_NONE;
+  encoder->bytes = 0;
+  if (!encoder->events) return false;
+
+  writeBytes(encoder, (const uint8_t*) CODEC_MAGIC, 4);
+  uint8_t version = CODEC_VERSION;
+  writeBytes(encoder, &version, 1);
+  return true;
+}
+
+void codec_encode(CodecEncoder* encoder, const ReplayEvent* event) {
+  assert(event->frame >= (encoder->eventCount ? encoder->events[encoder->eventCount - 1].frame : encoder->lastFrame));
+  encoder->events[encoder->eventCount++] = *event;
+  if (encoder->eventCount == CODEC_BLOCK_EVENTS) {
+    encodeBlock(encoder);
+  }
+}
+
+void codec_finishEncoder(CodecEncoder* encoder, uint32_t frame) {
+  ReplayEvent quit = { frame, INPUT_QUIT, 0 };
+  codec_encode(encoder, &quit);
+  encodeBlock(encoder);
+  writeVarint(encoder, 0);
+  fflush(encoder->file);
+
+  free(encoder->events);
+  encoder->events = NULL;
+}
+
+/**
+ * Decoding
+ * ================================================================================================
+ */
+
+static bool readBlock(CodecDecoder* decoder) {
+  FILE* file = decoder->file;
+  uint64_t count;
+  if (!readVarint(file, &count) || count == 0 || count > CODEC_BLOCK_EVENTS) return false;
+
+  CodecModel* model = decoder->model;
+  memset(model, 0, sizeof(CodecModel));
+  for (int c = 0; c < CODEC_CONTEXTS; c++) {
+    uint64_t used;
+    if (!readVarint(file, &used) || used > CODEC_SYMBOLS) return false;
+
+    // buildStarts trusts these to fill the slots exactly, so a bad table mustn't get past here.
+    // A symbol already seen has a nonzero frequency
+    uint32_t sum = 0;
+    for (uint64_t i = 0; i < used; i++) {
+      int symbol = getc_unlocked(file);
+      uint64_t frequency;
+      if (symbol == EOF || symbol >= CODEC_SYMBOLS || !readVarint(file, &frequency)) return false;
+      if (frequency == 0 || frequency > SCALE || model->frequency[c][symbol]) return false;
+      sum += frequency;
+      if (sum > SCALE) return false;
+      model->frequency[c][symbol] = frequency;
+    }
+    if (used && sum != SCALE) return false;
+  }
+  buildStarts(model, true);
+
+  uint64_t extraLength, ransLength;
+  if (!readVarint(file, &extraLength) || extraLength > (uint64_t) count * 2 * VARINT_MAX_BYTES) return false;
+  if ((uint64_t) decoder->blockCapacity < extraLength + count * 2 + 4) {
+    uint8_t* block = realloc(decoder->block, extraLength + count * 2 + 4);
+    if (!block) return false;
+    decoder->block = block;
+    decoder->blockCapacity = extraLength + count * 2 + 4;
+  }
+  if (fread(decoder->block, 1, extraLength, file) != extraLength) return false;
+  if (!readVarint(file, &ransLength) || ransLength < 4 || ransLength > count * 2 + 4) return false;
+  if (fread(decoder->block + extraLength, 1, ransLength, file) != ransLength) return false;
+
+  decoder->extra = decoder->block;
+  decoder->extraEnd = decoder->block + extraLength;
+  decoder->rans = decoder->extraEnd + 4;
+  decoder->ransEnd = decoder->extraEnd + ransLength;
+  decoder->state = 0;
+  for (int i = 0; i < 4; i++) {
+    decoder->state |= (uint32_t) decoder->extraEnd[i] << (i * 8);
+  }
+  decoder->eventsLeft = count;
+  return true;
+}
+
+bool codec_startDecoder(CodecDecoder* decoder, FILE* file) {
+  char magic[4];
+  memset(decoder, 0, sizeof(CodecDecoder));
+  decoder->file = file;
+  decoder->lastInput = INPUT_NONE;
+
+  if (fread(magic, 1, sizeof(magic), file) != sizeof(magic)) return false;
+  if (memcmp(magic, CODEC_MAGIC, sizeof(magic)) != 0) return false;
+  if (getc(file) != CODEC_VERSION) return false;
+
+  decoder->model = malloc(sizeof(CodecModel));
+  return decoder->model != NULL;
+}
+
+bool codec_decode(CodecDecoder* decoder, ReplayEvent* event) {
+  if (decoder->finished) return false;
+  if (!decoder->eventsLeft && !readBlock(decoder)) return false;
+
+  GameInputs context = decoder->lastInput;
+  uint32_t slot = decoder->state & (SCALE - 1);
+  uint8_t symbol = decoder->model->symbol[context][slot];
+  if (!decoder->model->frequency[context][symbol]) return false;  // A context the block left empty
+  uint32_t state = decoder->model->frequency[context][symbol] * (decoder->state >> CODEC_SCALE_BITS)
+    + slot - decoder->model->start[context][symbol];
+  while (state < RANS_LOW && decoder->rans < decoder->ransEnd) {
+    state = (state << 8) | *decoder->rans++;
+  }
+  decoder->state = state;
+  decoder->eventsLeft--;
+
+  uint64_t delta = symbol >> INPUT_BITS;
+  if (delta == DELTA_ESCAPE) {
+    uint64_t more;
+    if (!getVarint(&decoder->extra, decoder->extraEnd, &more)) return false;
+    delta += more;
+  }
+  decoder->frame += delta;
+
+  event->frame = decoder->frame;
+  event->input = symbol & INPUT_MASK;
+  event->seed = 0;
+  if (event->input == INPUT_RESTART) {
+    uint64_t seed;
+    if (!getVarint(&decoder->extra, decoder->extraEnd, &seed)) return false;
+    event->seed = seed;
+  }
+
+  decoder->lastInput = event->input;
+  decoder->finished = event->input == INPUT_QUIT;
+  return !decoder->finished;
+}
+
+void codec_finishDecoder(CodecDecoder* decoder) {
+  free(decoder->model);
+  free(decoder->block);
+  decoder->model = NULL;
+  decoder->block = NULL;
+}
@@ -0,0 +1,82 @@
+// Once-only wrapper
+#ifndef CODEC_H_SEEN
+#define CODEC_H_SEEN
+
+#include <stdio.h>
+
+#include "replay.h"
+
+/**
+ * Compressed replays for archiving. The same events as replay.h, entropy coded with rANS in blocks,
+ * and without keyframes. See codec.c for the model and format
+ */
+
+#define CODEC_BLOCK_EVENTS 65536
+#define CODEC_SYMBOLS 128  // 3 bit input, 4 bit frame delta (15 = longer, see codec.c)
+#define CODEC_CONTEXTS 8   // Previous input
+#define CODEC_SCALE_BITS 12
+
+struct CodecEncoder {
+  FILE* file;
+  ReplayEvent* events;  // The block so far
+  int eventCount;
+  uint32_t lastFrame;
+  GameInputs lastInput;
+  uint64_t bytes;       // Written so far
+} typedef CodecEncoder;
+
+struct CodecModel {
+  uint16_t frequency[CODEC_CONTEXTS][CODEC_SYMBOLS];
+  uint16_t start[CODEC_CONTEXTS][CODEC_SYMBOLS];
+  uint8_t symbol[CODEC_CONTEXTS][1 << CODEC_SCALE_BITS];  // Slot to symbol, decoding only
+} typedef CodecModel;
+
+struct CodecDecoder {
+  FILE* file;
+  CodecModel* model;
+  uint8_t* block;      // The current block's extra and rANS bytes
+  int blockCapacity;
+  const uint8_t* extra;
+  const uint8_t* extraEnd;
+  const uint8_t* rans;
+  const uint8_t* ransEnd;
+  uint32_t state;
+  int eventsLeft;      // In the current block
+  uint32_t frame;
+  GameInputs lastInput;
+  bool finished;
+} typedef CodecDecoder;
+
+/**
+ * Write the header and allocate a block buffer
+ */
+bool codec_startEncoder(CodecEncoder* encoder, FILE* file);
+
+/**
+ * Add an event. Written out a block at a time
+ */
+void codec_encode(CodecEncoder* encoder, const ReplayEvent* event);
+
+/**
+ * Add the end marker at this frame, write the last block, and free the buffer. Doesn't close the
+ * file
+ */
+void codec_finishEncoder(CodecEncoder* encoder, uint32_t frame);
+
+/**
+ * Check the header and allocate the model. Returns false if this isn't a compressed replay
+ */
+bool codec_startDecoder(CodecDecoder* decoder, FILE* file);
+
+/**
+ * Decode the next event. Returns false at the end, or if the stream is cut short or corrupt
+ */
+bool codec_decode(CodecDecoder* decoder, ReplayEvent* event);
+
+/**
+ * Free the model and block. Doesn't close the file
+ */
+void codec_finishDecoder(CodecDecoder* decoder);
+
+// Once-only wrapper
+#endif // CODEC_H_SEEN
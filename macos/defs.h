@@ -3,10 +3,30 @@
 #define DEFS_H_SEEN
 
 #include <stdbool.h>
+#include <stdint.h>
 
-#define WIDTH 10
-#define HEIGHT 26
-#define HIDDEN_ROWS 2
+/**
+ * Board geometry, fixed at compile time so every loop over rows and columns has constant bounds and
+ * the kernels are built for exactly one size. Build other variants with -DBOARD_WIDTH=N (4 to 26,
+ * as a plain number: blocks.c pastes it into macro names), -DBOARD_HEIGHT=N (up to 31) and
+ * -DBOARD_HIDDEN_ROWS=N. One binary supports one size: a 4, 10 and 16 wide comparison is three
+ * builds run one after another, not three sizes in one process, and replays only load in a build of
+ * the same size. Rule variants aren't covered. psx/defs.h keeps its own fixed 10x26, as the PSX
+ * screen layout and its copy of the engine are built for that size only.
+ */
+#ifndef BOARD_WIDTH
+#define BOARD_WIDTH 10
+#endif
+#ifndef BOARD_HEIGHT
+#define BOARD_HEIGHT 26
+#endif
+#ifndef BOARD_HIDDEN_ROWS
+#define BOARD_HIDDEN_ROWS 2
+#endif
+
+#define WIDTH BOARD_WIDTH
+#define HEIGHT BOARD_HEIGHT
+#define HIDDEN_ROWS BOARD_HIDDEN_ROWS
 #define DRAW_HEIGHT (HEIGHT - HIDDEN_ROWS)
 #define BLOCK_SIZE 24
 
@@ -15,6 +35,41 @@
 
 #define GRID_BIT_OFFSET 0x8000
 
+/**
+ * Field rows are bitboards: one bit per cell, read left-to-right from the top bit like the shape
+ * hexes. Three solid 'wall' columns on the left, and at least three on the right filling out the
+ * row, mean a shape hanging off the field overlaps a wall bit, so bounds and overlap checks are the
+ * same AND. Rows are 16 bits for boards up to 10 wide and 32 bits past that.
+ *
+ * |www|cccccccccc|www|  (w = wall, c = cell)
+ */
+#define WALL_BITS 3
+
+#if WIDTH + 2 * WALL_BITS <= 16
+typedef uint16_t FieldRow;
+#define ROW_BITS 16
+#else
+typedef uint32_t FieldRow;
+#define ROW_BITS 32
+#endif
+
+#define RIGHT_WALL_BITS (ROW_BITS - WALL_BITS - WIDTH)
+#define ROW_FULL ((FieldRow) ~0u)
+#define ROW_LEFT_WALL ((FieldRow) (ROW_FULL << (ROW_BITS - WALL_BITS)))
+#define ROW_RIGHT_WALL ((FieldRow) (ROW_FULL >> (WALL_BITS + WIDTH)))
+#define ROW_EMPTY ((FieldRow) (ROW_LEFT_WALL | ROW_RIGHT_WALL))
+#define ROW_CELL_BIT(x) ((FieldRow) ((FieldRow) 1 << (ROW_BITS - 1 - WALL_BITS - (x))))
+#define ROW_CELLS_MASK ((FieldRow) ~ROW_EMPTY)
+#define ROW_TRANSITION_PAIRS (((1u << (WIDTH + 1)) - 1) << (RIGHT_WALL_BITS - 1))  // (row ^ row >> 1), wall to wall
+
+#if WIDTH < 4 || RIGHT_WALL_BITS < WALL_BITS
+#error "Boards must be 4 to 26 columns wide"
+#endif
+
+#if HEIGHT > 31 || HIDDEN_ROWS < 0 || HIDDEN_ROWS >= HEIGHT
+#error "Boards must be up to 31 rows high, with fewer hidden rows than that"
+#endif
+
 typedef enum BlockNames {
   BLOCK_NONE,
   BLOCK_I,
@@ -39,6 +94,7 @@ typedef enum {
   INPUT_DOWN,
   INPUT_QUIT,
   INPUT_RESTART,
+  INPUT_SOFTDROP,  // Gravity, rather than a key. Recorded in replays
 } GameInputs;
 
 typedef enum GameMovements {
@@ -54,19 +110,119 @@ typedef enum GameCollisions {
   COLLIDE_CELL
 } GameCollisions;
 
-typedef BlockNames Field[HEIGHT][WIDTH];
-typedef BlockNames DrawField[HEIGHT - HIDDEN_ROWS][WIDTH];
+/**
+ * Board shape for bots to evaluate, kept up to date as pieces land and lines clear so reading it
+ * is free. Heights count up from the floor, 0 for an empty column. A hole is an empty cell with a
+ * filled one somewhere above it; a well is how far a column sits below the lower of its
+ * neighbours (the walls count as full height); row transitions count filled/empty changes across
+ * each row that isn't empty, walls included. See game_computeFeatures()
+ */
+struct FieldFeatures {
+  uint8_t heights[WIDTH];
+  uint16_t aggregateHeight;  // Sum of heights
+  uint16_t holes;
+  uint16_t bumpiness;        // Sum of height differences between neighbouring columns
+  uint16_t wells;            // Sum of well depths
+  uint16_t rowTransitions;
+} typedef FieldFeatures;
+
+/**
+ * What fills a cell: a BlockNames value, plus DRAW_GHOST in the draw field. A byte rather than the
+ * enum's four, so a 10x26 board's colours are 260 bytes instead of 1040
+ */
+typedef uint8_t CellColour;
+
+struct Field {
+  FieldRow rows[HEIGHT];              // Occupancy, used for all collision checks
+  CellColour colours[HEIGHT][WIDTH];  // Block per cell, only needed for drawing
+  FieldFeatures features;             // Derived from rows
+  uint64_t hash;                      // Zobrist hash of rows, see game_hashField()
+} typedef Field;
+
+/**
+ * The block to draw in each visible cell, or BLOCK_NONE. Cells where the current piece would land
+ * hold its block with DRAW_GHOST set
+ */
+#define DRAW_GHOST 0x8
 
+typedef CellColour DrawField[HEIGHT - HIDDEN_ROWS][WIDTH];
+
+/**
+ * Upcoming pieces, and the random state used to draw more (see blocks.c)
+ */
+#define PREVIEW_LENGTH 6
+
+struct PieceQueue {
+  uint32_t random;                  // xorshift32 state, never zero
+  uint8_t bag;                      // Pieces left in the 7-bag, bit (1 << (block - 1))
+  uint8_t head;                     // Index of the next piece in preview
+  uint8_t preview[PREVIEW_LENGTH];  // Ring buffer of upcoming BlockNames
+} typedef PieceQueue;
+
+/**
+ * Fixed-width fields, widest first so nothing pads between them: 40 bytes, where plain ints and
+ * enums took 52. The spare bytes are explicit and always zero, so whole states compare with memcmp
+ */
 struct GameState {
-  BlockNames blockName;
-  int blockRotation;
-  int clearedLines;
-  int points;
-  int positionX;
-  int positionY;
-  PlayStates playState;
+  uint32_t seed;          // Seed this game's pieces were drawn from
+  uint32_t clearedRows;   // Rows cleared by the last piece to land, as bits (1 << y)
+  int32_t clearedLines;
+  int32_t points;
+  int32_t pieces;         // Pieces landed this game
+  PieceQueue queue;
+  uint8_t blockName;      // BlockNames
+  uint8_t blockRotation;
+  int8_t positionX;
+  int8_t positionY;
+  uint8_t playState;      // PlayStates
+  uint8_t spare[3];
 } typedef GameState;
 
+/**
+ * Everything that affects play, bit-packed for search and rollback to copy around: 64 bytes at the
+ * default 10x26, more or less with the board (game.c checks the default). Occupancy is WIDTH bits
+ * a row (no walls), top row first; cell colours aren't kept. See game_snapshot()
+ */
+#define SNAPSHOT_CELL_BYTES ((HEIGHT * WIDTH + 7) / 8)
+
+struct GameSnapshot {
+  uint32_t random;        // PieceQueue random
+  uint32_t queue;         // PieceQueue preview (3 bits each), then bag, then head
+  uint32_t seed;
+  uint32_t clearedRows;
+  uint32_t clearedLines;
+  uint32_t points;
+  uint32_t pieces;
+  uint8_t cells[SNAPSHOT_CELL_BYTES];
+  uint8_t piece;          // blockName, blockRotation << 3, playState << 5
+  int8_t positionX;
+  int8_t positionY;
+} typedef GameSnapshot;
+
+typedef struct ReplayWriter ReplayWriter;
+typedef struct EventQueue EventQueue;
+typedef struct InputQueue InputQueue;
+
+/**
+ * Everything for one running game. The layout is public so callers can allocate as many as they
+ * like (statics, arrays, heap), then pass a pointer to each game_* call
+ */
+#define ALL_FIELD_ROWS ((uint32_t) ((1ull << HEIGHT) - 1))
+
+struct GameInstance {
+  Field field;
+  DrawField drawField;
+  GameState state;
+  uint32_t frame;          // Advanced by game_tick(), timestamps recorded actions
+  ReplayWriter* recorder;  // Records every action when set, see replay.h
+  EventQueue* events;      // Gets what happens when set, see events.h
+  InputQueue* inputs;      // Buttons for game_applyInputs(), see input.h
+  uint32_t dirtyRows;      // Field rows changed since the last game_updateDrawState(), as bits (1 << y)
+  uint32_t drawnPiece;     // The piece and ghost it last drew, packed, and the field rows they cover
+  uint32_t drawnRows;
+  uint32_t drawDirtyRows;  // Draw rows it last rewrote, as bits (1 << y) for drawField[y]
+} typedef GameInstance;
+
 typedef enum BorderFlags {
   BORDER_TOP = 1,
   BORDER_LEFT = 2,
@@ -0,0 +1,178 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "evaluate.h"
+#include "game.h"
+
+/**
+ * evaluate.c
+ * ================================================================================================
+ * Each block of candidates starts as a copy of the field in every lane with that lane's piece ORed
+ * in. The pieces are scattered into place here, one candidate at a time, along with which rows
+ * could fill up; everything after that runs on whole vectors in evaluate_lanes.h.
+ * ================================================================================================
+ */
+
+#if HEIGHT > 31
+#error "Heights are counted in five bit planes"
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X86 1
+#else
+#define X86 0
+#endif
+
+// One register of rows: 16 and 8 candidates with 16 bit rows, 8 and 4 with 32 bit rows
+#define AVX2_LANES (256 / ROW_BITS)
+#define VECTOR_LANES (128 / ROW_BITS)
+
+#define LANES AVX2_LANES
+#define SUFFIX avx2
+#if X86
+#define TARGET __attribute__((target("avx2")))
+#else
+#define TARGET
+#endif
+#include "evaluate_lanes.h"
+
+#define LANES VECTOR_LANES
+#define SUFFIX vector
+#if X86
+#define TARGET __attribute__((target("sse4.2")))
+#else
+#define TARGET
+#endif
+#include "evaluate_lanes.h"
+
+/**
+ * Fill pieces (HEIGHT rows of lanes) for candidates first onwards. Lanes past the end of the list
+ * get no piece. Returns the rows that fill up in at least one lane
+ */
+static uint32_t scatterPieces(const GameInstance* game, const MoveList* moves, int first, int lanes, FieldRow* pieces) {
+  memset(pieces, 0, HEIGHT * lanes * sizeof(FieldRow));
+
+  uint32_t clearable = 0;
+  int count = moves->count - first < lanes ? moves->count - first : lanes;
+  for (int lane = 0; lane < count; lane++) {
+    const Move* move = &moves->moves[first + lane];
+    const ShapePlacement* placement = getShapePlacement(game->state.blockName, move->rotation, move->x);
+    for (int row = placement->top; row <= placement->bottom; row++) {
+      int y = move->y + row;
+      pieces[y * lanes + lane] = placement->rows[row];
+      if ((game->field.rows[y] | placement->rows[row]) == ROW_FULL) clearable |= 1u << y;
+    }
+  }
+  return clearable;
+}
+
+/**
+ * The fallback: place each candidate on a copy of the game and read what game.c keeps. The copy is
+ * local, with no recorder, events or inputs attached, so threads can evaluate at once
+ */
+static void evaluateScalar(const GameInstance* game, const MoveList* moves, EvalBatch* batch) {
+  GameInstance scratch;
+  game_init(&scratch);
+  for (int i = 0; i < moves->count; i++) {
+    const Move* move = &moves->moves[i];
+    scratch.field = game->field;
+    scratch.state = game->state;
+    game_actionPlace(&scratch, move->x, move->rotation, move->y);
+
+    const FieldFeatures* features = &scratch.field.features;
+    for (int y = 0; y < HEIGHT; y++) {
+      batch->rows[y][i] = scratch.field.rows[y];
+    }
+    for (int x = 0; x < WIDTH; x++) {
+      batch->heights[x][i] = features->heights[x];
+    }
+    batch->aggregateHeight[i] = features->aggregateHeight;
+    batch->holes[i] = features->holes;
+    batch->bumpiness[i] = features->bumpiness;
+    batch->wells[i] = features->wells;
+    batch->rowTransitions[i] = features->rowTransitions;
+    batch->linesCleared[i] = __builtin_popcount(scratch.state.clearedRows);
+  }
+}
+
+/**
+ * Public functions
+ * ============================================================================
+ */
+
+bool eval_hasKernel(EvalKernel kernel) {
+  switch (kernel) {
+    case EVAL_SCALAR:
+      return true;
+#if X86
+    case EVAL_VECTOR:
+      return __builtin_cpu_supports("sse4.2");
+    case EVAL_AVX2:
+      return __builtin_cpu_supports("avx2");
+#else
+    case EVAL_VECTOR:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+EvalKernel eval_bestKernel() {
+  // Threads that race here all work out the same answer, so relaxed is enough
+  static atomic_int cached = EVAL_KERNELS;
+  EvalKernel best = atomic_load_explicit(&cached, memory_order_relaxed);
+  if (best == EVAL_KERNELS) {
+    best = EVAL_SCALAR;
+    for (EvalKernel kernel = EVAL_SCALAR; kernel < EVAL_KERNELS; kernel++) {
+      if (eval_hasKernel(kernel)) best = kernel;
+    }
+    atomic_store_explicit(&cached, best, memory_order_relaxed);
+  }
+  return best;
+}
+
+const char* eval_kernelName(EvalKernel kernel) {
+  static const char* names[EVAL_KERNELS] = { "scalar", X86 ? "sse4.2" : "vector", "avx2" };
+  return kernel < EVAL_KERNELS ? names[kernel] : "none";
+}
+
+void eval_placements(const GameInstance* game, const MoveList* moves, EvalBatch* batch) {
+  eval_placementsWith(eval_bestKernel(), game, moves, batch);
+}
+
+void eval_placementsWith(EvalKernel kernel, const GameInstance* game, const MoveList* moves, EvalBatch* batch) {
+  assert(eval_hasKernel(kernel));
+  assert(moves->count <= EVAL_MAX_CANDIDATES);
+  batch->count = moves->count;
+
+  FieldRow pieces[HEIGHT * AVX2_LANES];
+  switch (kernel) {
+    case EVAL_AVX2:
+      for (int first = 0; first < moves->count; first += AVX2_LANES) {
+        uint32_t clearable = scatterPieces(game, moves, first, AVX2_LANES, pieces);
+        evaluateLanes_avx2(game->field.rows, pieces, clearable, batch, first);
+      }
+      break;
+    case EVAL_VECTOR:
+      for (int first = 0; first < moves->count; first += VECTOR_LANES) {
+        uint32_t clearable = scatterPieces(game, moves, first, VECTOR_LANES, pieces);
+        evaluateLanes_vector(game->field.rows, pieces, clearable, batch, first);
+      }
+      break;
+    default:
+      evaluateScalar(game, moves, batch);
+  }
+}
+
+void eval_getFeatures(const EvalBatch* batch, int candidate, FieldFeatures* features) {
+  for (int x = 0; x < WIDTH; x++) {
+    features->heights[x] = batch->heights[x][candidate];
+  }
+  features->aggregateHeight = batch->aggregateHeight[candidate];
+  features->holes = batch->holes[candidate];
+  features->bumpiness = batch->bumpiness[candidate];
+  features->wells = batch->wells[candidate];
+  features->rowTransitions = batch->rowTransitions[candidate];
+}
@@ -0,0 +1,69 @@
+// Once-only wrapper
+#ifndef EVALUATE_H_SEEN
+#define EVALUATE_H_SEEN
+
+#include "defs.h"
+#include "movegen.h"
+
+/**
+ * Lands the current piece at every move in a list at once and reports each resulting board (after
+ * line clears) with its features, as FieldFeatures would hold after game_actionPlace(). The work
+ * runs across SIMD lanes, one candidate per lane: 16 at a time with AVX2, 8 with SSE4.2 (or the
+ * target's own 128 bit vectors off x86), or one at a time through game.c as a fallback. Boards
+ * wide enough for 32 bit rows get half as many lanes.
+ *
+ * Results are laid out by feature, then candidate (structure of arrays) so a bot can score every
+ * candidate with vector arithmetic too: batch->holes[i] is candidate i's holes, batch->rows[y][i]
+ * its row y.
+ */
+
+// Room for a full move list, rounded up to whole AVX2 vectors
+#define EVAL_MAX_CANDIDATES ((MOVEGEN_MAX_MOVES + 15) & ~15)
+
+typedef enum EvalKernel {
+  EVAL_SCALAR,
+  EVAL_VECTOR,  // 128 bits of lanes: SSE4.2 on x86, the target's own vectors elsewhere
+  EVAL_AVX2,    // 256 bits of lanes
+  EVAL_KERNELS
+} EvalKernel;
+
+struct EvalBatch {
+  int count;
+  FieldRow rows[HEIGHT][EVAL_MAX_CANDIDATES];
+  uint16_t heights[WIDTH][EVAL_MAX_CANDIDATES];
+  uint16_t aggregateHeight[EVAL_MAX_CANDIDATES];
+  uint16_t holes[EVAL_MAX_CANDIDATES];
+  uint16_t bumpiness[EVAL_MAX_CANDIDATES];
+  uint16_t wells[EVAL_MAX_CANDIDATES];
+  uint16_t rowTransitions[EVAL_MAX_CANDIDATES];
+  uint16_t linesCleared[EVAL_MAX_CANDIDATES];
+} typedef EvalBatch;
+
+/**
+ * The fastest kernel this CPU runs
+ */
+EvalKernel eval_bestKernel();
+
+bool eval_hasKernel(EvalKernel kernel);
+
+const char* eval_kernelName(EvalKernel kernel);
+
+/**
+ * Evaluate every move for the game's current piece with the best kernel. The batch is large, so
+ * keep one around rather than putting it on the stack. Threads can evaluate at once, each with its
+ * own batch
+ */
+void eval_placements(const GameInstance* game, const MoveList* moves, EvalBatch* batch);
+
+/**
+ * Same, with the given kernel (which must be available), for comparing them
+ */
+void eval_placementsWith(EvalKernel kernel, const GameInstance* game, const MoveList* moves, EvalBatch* batch);
+
+/**
+ * Gather one candidate's features back into a FieldFeatures
+ */
+void eval_getFeatures(const EvalBatch* batch, int candidate, FieldFeatures* features);
+
+// Once-only wrapper
+#endif // EVALUATE_H_SEEN
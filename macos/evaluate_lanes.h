@@ -0,0 +1,153 @@
+/**
+ * evaluate_lanes.h
+ * ================================================================================================
+ * The vector kernel for evaluate.c, written once with GCC/Clang vector extensions and included once
+ * per instruction set. No include guard, on purpose. Before including, define:
+ *
+ *   LANES   candidates per vector (FieldRow sized lanes)
+ *   SUFFIX  appended to every name, e.g. avx2
+ *   TARGET  function attributes to build for, e.g. __attribute__((target("avx2"))), or nothing
+ *
+ * Each lane holds one candidate's copy of the same row. A line clear moves rows down in some lanes
+ * and not others, so it's a masked blend of every row above it. Heights are counted bit-sliced:
+ * OR the rows together from the top, and add that "seen" mask into five bit planes each row, so
+ * plane k holds bit k of every column's height at once.
+ * ================================================================================================
+ */
+
+#define LANE_NAME_(name, suffix) name##_##suffix
+#define LANE_NAME_EXPAND(name, suffix) LANE_NAME_(name, suffix)
+#define LANE_NAME(name) LANE_NAME_EXPAND(name, SUFFIX)
+
+#define Lanes LANE_NAME(Lanes)
+#define SignedLanes LANE_NAME(SignedLanes)
+
+#define FeatureLanes LANE_NAME(FeatureLanes)
+
+typedef FieldRow Lanes __attribute__((vector_size(sizeof(FieldRow) * LANES)));
+#if ROW_BITS == 16
+typedef int16_t SignedLanes __attribute__((vector_size(sizeof(FieldRow) * LANES)));
+#else
+typedef int32_t SignedLanes __attribute__((vector_size(sizeof(FieldRow) * LANES)));
+#endif
+typedef uint16_t FeatureLanes __attribute__((vector_size(2 * LANES)));
+
+TARGET static inline Lanes LANE_NAME(popcount)(Lanes v) {
+  v = v - ((v >> 1) & (FieldRow) 0x55555555);
+  v = (v & (FieldRow) 0x33333333) + ((v >> 2) & (FieldRow) 0x33333333);
+  v = (v + (v >> 4)) & (FieldRow) 0x0F0F0F0F;
+  v = v + (v >> 8);
+#if ROW_BITS == 32
+  v = v + (v >> 16);
+#endif
+  return v & 0x3F;
+}
+
+TARGET static inline Lanes LANE_NAME(load)(const FieldRow* from) {
+  Lanes v;
+  memcpy(&v, from, sizeof(v));
+  return v;
+}
+
+TARGET static inline void LANE_NAME(store)(FieldRow* to, Lanes v) {
+  memcpy(to, &v, sizeof(v));
+}
+
+// Features are 16 bits whatever the row size
+TARGET static inline void LANE_NAME(storeFeature)(uint16_t* to, Lanes v) {
+#if ROW_BITS == 16
+  FeatureLanes narrow = v;
+#else
+  FeatureLanes narrow = __builtin_convertvector(v, FeatureLanes);
+#endif
+  memcpy(to, &narrow, sizeof(narrow));
+}
+
+/**
+ * pieces holds each lane's piece rows, HEIGHT rows of LANES. clearable has bit (1 << y) set if row y
+ * fills up in any lane. Results go to the batch from candidate 'first'
+ */
+TARGET static void LANE_NAME(evaluateLanes)(const FieldRow* base, const FieldRow* pieces, uint32_t clearable,
+  EvalBatch* batch, int first) {
+  Lanes rows[HEIGHT];
+  for (int y = 0; y < HEIGHT; y++) {
+    rows[y] = LANE_NAME(load)(&pieces[y * LANES]) | base[y];
+  }
+
+  // Clear top down, so the rows still to check below haven't moved
+  Lanes lines = { 0 };
+  for (; clearable; clearable &= clearable - 1) {
+    int y = __builtin_ctz(clearable);
+    Lanes full = (Lanes) (rows[y] == ROW_FULL);
+    lines -= full;
+    for (int r = y; r > 0; r--) {
+      rows[r] = (rows[r] & ~full) | (rows[r - 1] & full);
+    }
+    rows[0] = (rows[0] & ~full) | (ROW_EMPTY & full);
+  }
+
+  Lanes seen = { 0 };
+  Lanes holes = { 0 };
+  Lanes transitions = { 0 };
+  Lanes planes[5] = { { 0 } };
+  for (int y = 0; y < HEIGHT; y++) {
+    Lanes row = rows[y];
+    LANE_NAME(store)(&batch->rows[y][first], row);
+
+    seen |= row & ROW_CELLS_MASK;
+    holes += LANE_NAME(popcount)(seen & ~row);
+    Lanes nonEmpty = (Lanes) (row != ROW_EMPTY);
+    transitions += LANE_NAME(popcount)((row ^ (row >> 1)) & ROW_TRANSITION_PAIRS) & nonEmpty;
+
+    Lanes carry = seen;
+    for (int k = 0; k < 5; k++) {
+      Lanes overflow = planes[k] & carry;
+      planes[k] ^= carry;
+      carry = overflow;
+    }
+  }
+
+  Lanes heights[WIDTH];
+  Lanes aggregate = { 0 };
+  for (int x = 0; x < WIDTH; x++) {
+    int shift = ROW_BITS - 1 - WALL_BITS - x;
+    Lanes height = { 0 };
+    for (int k = 0; k < 5; k++) {
+      height |= ((planes[k] >> shift) & 1) << k;
+    }
+    heights[x] = height;
+    aggregate += height;
+    LANE_NAME(storeFeature)(batch->heights[x] + first, height);
+  }
+
+  Lanes bumpiness = { 0 };
+  Lanes wells = { 0 };
+  Lanes wall = { 0 };
+  wall += HEIGHT;
+  for (int x = 0; x < WIDTH; x++) {
+    if (x < WIDTH - 1) {
+      SignedLanes step = (SignedLanes) (heights[x] - heights[x + 1]);
+      SignedLanes sign = step >> (ROW_BITS - 1);
+      bumpiness += (Lanes) ((step ^ sign) - sign);
+    }
+    Lanes left = x > 0 ? heights[x - 1] : wall;
+    Lanes right = x < WIDTH - 1 ? heights[x + 1] : wall;
+    Lanes leftLower = (Lanes) (left < right);
+    Lanes lower = (left & leftLower) | (right & ~leftLower);
+    wells += (lower - heights[x]) & (Lanes) (lower > heights[x]);
+  }
+
+  LANE_NAME(storeFeature)(batch->aggregateHeight + first, aggregate);
+  LANE_NAME(storeFeature)(batch->holes + first, holes);
+  LANE_NAME(storeFeature)(batch->bumpiness + first, bumpiness);
+  LANE_NAME(storeFeature)(batch->wells + first, wells);
+  LANE_NAME(storeFeature)(batch->rowTransitions + first, transitions);
+  LANE_NAME(storeFeature)(batch->linesCleared + first, lines);
+}
+
+#undef Lanes
+#undef SignedLanes
+#undef FeatureLanes
+#undef LANES
+#undef SUFFIX
+#undef TARGET
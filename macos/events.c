@@ -0,0 +1,52 @@
+#include <string.h>
+
+#include "events.h"
+
+/**
+ * events.c
+ * ================================================================================================
+ * Single producer, single consumer ring. Head and tail count up forever and wrap at 2^32; their
+ * difference is how many events are waiting, and the low bits are the slot. The producer fills a
+ * slot before publishing the new tail with a release store, and the consumer reads the tail with
+ * an acquire load before reading the slot, so it never sees a half written event. The same goes
+ * the other way for head, so the producer never overwrites a slot still being read.
+ * ================================================================================================
+ */
+
+#define SLOT(index) ((index) & (EVENTS_CAPACITY - 1))
+
+_Static_assert((EVENTS_CAPACITY & (EVENTS_CAPACITY - 1)) == 0, "EVENTS_CAPACITY must be a power of two");
+
+void events_init(EventQueue* queue) {
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+  atomic_init(&queue->dropped, 0);
+  memset(queue->events, 0, sizeof(queue->events));
+}
+
+bool events_push(EventQueue* queue, const GameEvent* event) {
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+  if (tail - head == EVENTS_CAPACITY) {
+    atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+    return false;
+  }
+
+  queue->events[SLOT(tail)] = *event;
+  atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+bool events_pop(EventQueue* queue, GameEvent* event) {
+  uint32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+  if (head == tail) return false;
+
+  *event = queue->events[SLOT(head)];
+  atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  return true;
+}
+
+uint32_t events_dropped(const EventQueue* queue) {
+  return atomic_load_explicit(&queue->dropped, memory_order_relaxed);
+}
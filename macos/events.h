@@ -0,0 +1,67 @@
+// Once-only wrapper
+#ifndef EVENTS_H_SEEN
+#define EVENTS_H_SEEN
+
+#include <stdatomic.h>
+
+#include "defs.h"
+
+/**
+ * What the engine did, as it happens, for renderers, recorders and stats to react to rather than
+ * comparing state every frame. Attach a queue with game_setEvents(); the game pushes, one consumer
+ * pops. Head and tail are atomics, so the consumer can be on another thread.
+ *
+ * The queue is a fixed ring and never allocates. When it's full, new events are dropped and
+ * counted rather than overwriting ones the consumer hasn't read yet, so a consumer that sees
+ * events_dropped() go up knows to resync from game->state. So does one that calls game_restore()
+ * or seeks a replay, which swap the whole state without publishing anything.
+ */
+
+#define EVENTS_CAPACITY 64  // Power of two
+
+typedef enum GameEventTypes {
+  EVENT_RESTART,   // data is the seed
+  EVENT_SPAWN,     // A new piece at its spawn position
+  EVENT_MOVE,      // The piece moved: left, right, a soft drop, or a hard drop before it locks
+  EVENT_ROTATE,
+  EVENT_LOCK,      // The piece locked where it is, before any lines clear
+  EVENT_LINES,     // data is the rows cleared, as bits (1 << y)
+  EVENT_GAMEOVER
+} GameEventTypes;
+
+/**
+ * The piece fields are the current piece after the event (for EVENT_LOCK, the piece that locked)
+ */
+struct GameEvent {
+  uint32_t frame;  // game->frame when it happened
+  uint32_t data;
+  uint8_t type;    // GameEventTypes
+  uint8_t blockName;
+  uint8_t blockRotation;
+  int8_t positionX;
+  int8_t positionY;
+} typedef GameEvent;
+
+struct EventQueue {
+  _Atomic uint32_t head;     // Next to pop, only the consumer writes it
+  _Atomic uint32_t tail;     // Next to push, only the game writes it
+  _Atomic uint32_t dropped;
+  GameEvent events[EVENTS_CAPACITY];
+};
+
+void events_init(EventQueue* queue);
+
+/**
+ * Returns false (and counts the event as dropped) if the queue is full
+ */
+bool events_push(EventQueue* queue, const GameEvent* event);
+
+/**
+ * Take the oldest event. Returns false if there are none
+ */
+bool events_pop(EventQueue* queue, GameEvent* event);
+
+uint32_t events_dropped(const EventQueue* queue);
+
+// Once-only wrapper
+#endif // EVENTS_H_SEEN
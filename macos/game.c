@@ -1,330 +1,763 @@
 #include "game.h"
 #include "blocks.h"
 #include "defs.h"
+#include "events.h"
+#include "input.h"
+#include "replay.h"
 
 #include <assert.h>
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
-static Field g_field = { 0 };
-static DrawField g_drawField = { 0 };
-static GameState g_gameState = { 0 };
+static void record(GameInstance* game, GameInputs input) {
+  if (game->recorder) {
+    replay_record(game->recorder, game, input);
+  }
+}
+
+static void publish(GameInstance* game, GameEventTypes type, uint32_t data) {
+  if (!game->events) return;
+
+  const GameState* state = &game->state;
+  GameEvent event = {
+    .frame = game->frame,
+    .data = data,
+    .type = type,
+    .blockName = state->blockName,
+    .blockRotation = state->blockRotation,
+    .positionX = state->positionX,
+    .positionY = state->positionY,
+  };
+  events_push(game->events, &event);
+}
+
+static const ShapePlacement* getPlacement(const GameInstance* game, rotationIndex rotation, int x) {
+  return getShapePlacement(game->state.blockName, rotation, x);
+}
 
-static shapeHex getCurrentShape() {
-  return getBlockShape(g_gameState.blockName, g_gameState.blockRotation);
+static const ShapePlacement* getCurrentPlacement(const GameInstance* game) {
+  return getPlacement(game, game->state.blockRotation, game->state.positionX);
 }
 
 /**
- * Get collisions for proposed (drop/spawn) shape, x, y values
+ * Get collisions for proposed (drop/spawn) placement and y value
  */
-static GameCollisions getDropCollision(shapeHex shape, int x, int y) {
-  for (int row = 3; row >= 0; row--) {
-    for (int col = 0; col <= 3; col++) {
-      int bit = getShapeBit(shape, row, col);
-      if (bit) {
-        int projectedY = y + row;
-        int projectedX = x + col;
-
-        // Check out of bounds
-        if (projectedY >= HEIGHT) return COLLIDE_BOTTOMWALL;
-          
-        // Check overlap
-        if (g_field[projectedY][projectedX]) return COLLIDE_CELL;
-      }
-    }
+static GameCollisions getDropCollision(const GameInstance* game, const ShapePlacement* placement, int y) {
+  // Check out of bounds
+  if (y + placement->bottom >= HEIGHT) return COLLIDE_BOTTOMWALL;
+
+  // Check overlap. A piece is at most 4 rows, so this unrolls to a straight run of ANDs
+#pragma GCC unroll 4
+  for (int row = placement->bottom; row >= placement->top; row--) {
+    if (game->field.rows[y + row] & placement->rows[row]) return COLLIDE_CELL;
   }
   return COLLIDE_NONE;
 }
 
 /**
- * Get collisions for proposed (rotation) shape, x, y values
+ * Get collisions for proposed (rotation) placement and y value
  */
-static GameCollisions getCollisions(shapeHex shape, int x, int y) {
-  for (int row = 0; row <= 3; row++) {
-    for (int col = 0; col <= 3; col++) {
-      int bit = getShapeBit(shape, row, col);
-      if (bit) {
-        int projectedY = y + row;
-        int projectedX = x + col;
-
-        // Check out of bounds
-        if (projectedX < 0) return COLLIDE_LEFTWALL;
-        if (projectedX >= WIDTH) return COLLIDE_RIGHTWALL;
-        if (projectedY >= HEIGHT) return COLLIDE_BOTTOMWALL;
-
-        // Check overlap
-        if (g_field[projectedY][projectedX]) return COLLIDE_CELL;
-      }
-    }
+static GameCollisions getCollisions(const GameInstance* game, const ShapePlacement* placement, int y) {
+  // Check out of bounds
+  if (placement->walls & PLACEMENT_LEFTWALL) return COLLIDE_LEFTWALL;
+  if (placement->walls & PLACEMENT_RIGHTWALL) return COLLIDE_RIGHTWALL;
+
+  return getDropCollision(game, placement, y);
+}
+
+/**
+ * Whether the current piece can shift one column
+ */
+static bool canMove(const GameInstance* game, GameMovements movement) {
+  int nextX = game->state.positionX + movement;
+
+  // Check out of bounds
+  // (don't constrain on left, as the left edge of a block's 4x4 grid could be empty)
+  if (nextX >= WIDTH) return false;
+  if (nextX < -WALL_BITS) return false;
+
+  // Check collisions
+  GameCollisions moveCollision = getCollisions(
+    game,
+    getPlacement(game, game->state.blockRotation, nextX),
+    game->state.positionY
+  );
+  return moveCollision == COLLIDE_NONE;
+}
+
+/**
+ * Features
+ * ============================================================================
+ * Pieces only change the columns and rows they land on, so insertBlock adjusts the totals for
+ * those (and the neighbouring columns, for bumpiness and wells) rather than rescanning the field
+ */
+
+#define ROW_CELLS(row) (((row) >> RIGHT_WALL_BITS) & ((1u << WIDTH) - 1))
+
+static int getRowTransitions(FieldRow row) {
+  if (row == ROW_EMPTY) return 0;
+  return __builtin_popcount((row ^ (row >> 1)) & ROW_TRANSITION_PAIRS);
+}
+
+static int getWellDepth(const FieldFeatures* features, int x) {
+  int left = x > 0 ? features->heights[x - 1] : HEIGHT;
+  int right = x < WIDTH - 1 ? features->heights[x + 1] : HEIGHT;
+  int depth = (left < right ? left : right) - features->heights[x];
+  return depth > 0 ? depth : 0;
+}
+
+/**
+ * Add (sign 1) or take away (sign -1) the bumpiness and wells of columns first to last and the
+ * pairs between them. Take away before heights change and add back after
+ */
+static void mutateFeatures_surface(FieldFeatures* features, int first, int last, int sign) {
+  int bumpiness = 0;
+  int wells = 0;
+  for (int x = first; x <= last; x++) {
+    if (x < last) bumpiness += abs(features->heights[x] - features->heights[x + 1]);
+    wells += getWellDepth(features, x);
   }
-  return COLLIDE_NONE;
+  features->bumpiness += sign * bumpiness;
+  features->wells += sign * wells;
+}
+
+/**
+ * Height of column x, looking down from row y
+ */
+static int getColumnHeight(const Field* field, int x, int y) {
+  for (; y < HEIGHT; y++) {
+    if (field->rows[y] & ROW_CELL_BIT(x)) return HEIGHT - y;
+  }
+  return 0;
+}
+
+/**
+ * After lines clear, drop each column's height by the number cleared. A column whose top cell was
+ * cleared looks further down for its new top, and the empty cells it skips were holes
+ */
+static void mutateFeatures_clearLines(Field* field, uint32_t cleared) {
+  FieldFeatures* features = &field->features;
+  int count = __builtin_popcount(cleared);
+  mutateFeatures_surface(features, 0, WIDTH - 1, -1);
+
+  for (int x = 0; x < WIDTH; x++) {
+    int height = features->heights[x] - count;
+    int nextHeight = getColumnHeight(field, x, HEIGHT - height);
+    features->holes -= height - nextHeight;
+    features->aggregateHeight -= features->heights[x] - nextHeight;
+    features->heights[x] = nextHeight;
+  }
+
+  mutateFeatures_surface(features, 0, WIDTH - 1, 1);
+}
+
+/**
+ * Hashing
+ * ============================================================================
+ * There are too many row contents to keep a table of keys, so each key is a mix of its row index
+ * and contents (splitmix64's finalizer), which is as good as random here and costs a few multiplies
+ */
+
+static uint64_t getRowKey(int y, FieldRow row) {
+  if (row == ROW_EMPTY) return 0;
+  uint64_t key = ((uint64_t) y << ROW_BITS | row) + 0x9E3779B97F4A7C15ull;
+  key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+  key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+  return key ^ (key >> 31);
+}
+
+/**
+ * Every change to a row's occupancy goes through here, to keep the hash current
+ */
+static void mutateField_setRow(GameInstance* game, int y, FieldRow row) {
+  game->field.hash ^= getRowKey(y, game->field.rows[y]) ^ getRowKey(y, row);
+  game->field.rows[y] = row;
+  game->dirtyRows |= 1u << y;
 }
 
 /**
  * Clear the field grid
  */
-static void mutateField_clear() {
+static void mutateField_clear(GameInstance* game) {
   for (int y = 0; y < HEIGHT; y++) {
+    game->field.rows[y] = ROW_EMPTY;
     for (int x = 0; x < WIDTH; x++) {
-      g_field[y][x] = 0;
+      game->field.colours[y][x] = BLOCK_NONE;
     }
   }
+  game->field.features = (FieldFeatures) { 0 };
+  game->field.hash = 0;
+  game->dirtyRows = ALL_FIELD_ROWS;
 }
 
-static void mutateField_insertBlock(BlockNames blockType, shapeHex shape, int x, int y) {
-  for (int col = 0; col < 4; col++) {
-    for (int row = 0; row < 4; row++) {
-      int bit = getShapeBit(shape, col, row);
-      if (bit) {
-        int projectedX = x + row;
-        int projectedY = y + col;
-        g_field[projectedY][projectedX] = blockType;
+static void mutateField_insertBlock(GameInstance* game, BlockNames blockType, const ShapePlacement* placement, int x, int y) {
+  FieldFeatures* features = &game->field.features;
+  int first = x + placement->left;
+  int last = x + placement->right;
+  mutateFeatures_surface(features, first > 0 ? first - 1 : 0, last < WIDTH - 1 ? last + 1 : WIDTH - 1, -1);
+
+  for (int row = placement->top; row <= placement->bottom; row++) {
+    FieldRow mask = placement->rows[row];
+    int projectedY = y + row;
+    features->rowTransitions -= getRowTransitions(game->field.rows[projectedY]);
+    mutateField_setRow(game, projectedY, game->field.rows[projectedY] | mask);
+    features->rowTransitions += getRowTransitions(game->field.rows[projectedY]);
+
+    for (int col = placement->left; col <= placement->right; col++) {
+      int projectedX = x + col;
+      if (mask & ROW_CELL_BIT(projectedX)) {
+        game->field.colours[projectedY][projectedX] = blockType;
+
+        // Filling a cell fills a hole unless it raises the column, which opens any gap below
+        int height = HEIGHT - projectedY;
+        int rise = height - features->heights[projectedX];
+        if (rise > 0) {
+          features->heights[projectedX] = height;
+          features->aggregateHeight += rise;
+          features->holes += rise;
+        }
+        features->holes--;
       }
     }
   }
+
+  mutateFeatures_surface(features, first > 0 ? first - 1 : 0, last < WIDTH - 1 ? last + 1 : WIDTH - 1, 1);
+}
+
+/**
+ * Put a block at its spawn position
+ */
+static GameCollisions mutateState_spawnBlock(GameInstance* game, BlockNames block) {
+  assert(block != BLOCK_NONE);
+  game->state.blockName = block;
+  game->state.blockRotation = 0;
+  int x, y;
+  getSpawnPosition(block, &x, &y);
+  game->state.positionX = x;
+  game->state.positionY = y;
+  publish(game, EVENT_SPAWN, 0);
+
+  return getDropCollision(game, getCurrentPlacement(game), game->state.positionY);
 }
 
 /**
  * Update state for a new block spawn
  */
-static GameCollisions mutateState_spawn() {
-  g_gameState.blockName = randomBlock();
-  g_gameState.blockRotation = 0;
-  g_gameState.positionX = 4;
-  g_gameState.positionY = 0;
-
-  switch (g_gameState.blockName) {
-    case BLOCK_I:
-      g_gameState.positionX = 3;
-      g_gameState.positionY = 1;
-      break;
-    case BLOCK_T:
-      g_gameState.positionY = 1;
-      break;
-    case BLOCK_J:
-    case BLOCK_L:
-    case BLOCK_O:
-    case BLOCK_S:
-    case BLOCK_Z:
-      g_gameState.positionY = 2;
-      break;
-    default:
-      assert(g_gameState.blockName != 0);
-  }
-
-  shapeHex shape = getCurrentShape();
-  return getDropCollision(shape, g_gameState.positionX, g_gameState.positionY);
+static GameCollisions mutateState_spawn(GameInstance* game) {
+  return mutateState_spawnBlock(game, nextPiece(&game->state.queue));
 }
 
 /**
  * New game
  */
-static void mutateState_resetGame() {
-  g_gameState.clearedLines = 0;
-  g_gameState.points = 0;
-  g_gameState.playState = PLAY_PLAYING;
-  mutateState_spawn();
+static void mutateState_resetGame(GameInstance* game, uint32_t seed) {
+  game->state.seed = seed;
+  seedPieces(&game->state.queue, seed);
+  game->state.clearedLines = 0;
+  game->state.clearedRows = 0;
+  game->state.points = 0;
+  game->state.pieces = 0;
+  game->state.playState = PLAY_PLAYING;
+  mutateState_spawn(game);
 }
 
-static void mutateState_gameOver() {
-  g_gameState.playState = PLAY_GAMEOVER;
+static void mutateState_gameOver(GameInstance* game) {
+  game->state.playState = PLAY_GAMEOVER;
+  publish(game, EVENT_GAMEOVER, 0);
 }
 
-static void mutateState_setRotation(int rotation) {
-  g_gameState.blockRotation = rotation;
+static void mutateState_setRotation(GameInstance* game, int rotation) {
+  game->state.blockRotation = rotation;
 }
 
-static void mutateState_setX(int nextX) {
-  g_gameState.positionX = nextX;
+static void mutateState_setX(GameInstance* game, int nextX) {
+  game->state.positionX = nextX;
 }
 
-static void mutateState_setY(int nextY) {
-  g_gameState.positionY = nextY;
+static void mutateState_setY(GameInstance* game, int nextY) {
+  game->state.positionY = nextY;
 }
 
-static GameCollisions downOne() {
-  int nextX = g_gameState.positionX;
-  int nextY = g_gameState.positionY + 1;
-  shapeHex shape = getCurrentShape();
+static GameCollisions downOne(GameInstance* game) {
+  int nextY = game->state.positionY + 1;
 
-  GameCollisions collision = getDropCollision(shape, nextX, nextY);
+  GameCollisions collision = getDropCollision(game, getCurrentPlacement(game), nextY);
   if (collision == COLLIDE_NONE) {
-    mutateState_setY(nextY);
+    mutateState_setY(game, nextY);
+    publish(game, EVENT_MOVE, 0);
   }
 
   return collision;
 }
 
-static void downMany() {
-  GameCollisions collision = COLLIDE_NONE;
-  while (collision == COLLIDE_NONE) {
-    collision = downOne();
+/**
+ * Rows a placement at (x, y) can fall before it lands. Where every column of the piece is above
+ * the top of that column of the field, the nearest gap between the piece's skirt and a column top
+ * is the answer. A piece tucked under an overhang isn't, so it falls a row at a time instead
+ */
+static int getDropDistance(const GameInstance* game, const ShapePlacement* placement, int x, int y) {
+  int distance = HEIGHT;
+  for (int column = 0; column < 4; column++) {
+    int skirt = placement->skirt[column];
+    if (skirt < 0) continue;
+
+    int gap = HEIGHT - game->field.features.heights[x + column] - (y + skirt) - 1;
+    if (gap < 0) {
+      int fallen = 0;
+      while (getDropCollision(game, placement, y + fallen + 1) == COLLIDE_NONE) fallen++;
+      return fallen;
+    }
+    if (gap < distance) distance = gap;
   }
+  return distance;
 }
 
-static bool isLineComplete(int y) {
-  BlockNames* line = g_field[y];
+static void downMany(GameInstance* game) {
+  int distance = getDropDistance(game, getCurrentPlacement(game), game->state.positionX, game->state.positionY);
+  if (distance == 0) return;
+
+  mutateState_setY(game, game->state.positionY + distance);
+  publish(game, EVENT_MOVE, 0);
+}
+
+static bool isLineComplete(const GameInstance* game, int y) {
+  return game->field.rows[y] == ROW_FULL;
+}
+
+static void mutateField_copyLine(GameInstance* game, int from, int to) {
+  mutateField_setRow(game, to, game->field.rows[from]);
   for (int x = 0; x < WIDTH; x++) {
-    if (!line[x]) return false;
+    game->field.colours[to][x] = game->field.colours[from][x];
   }
-  return true;
 }
 
-static void mutateField_clearLine(int row) {
-  // Copy from lines above, except top line
-  for (int y = row; y > 0; y--) {
-    BlockNames* line = g_field[y];
-    BlockNames* lineAbove = g_field[y - 1];
-    for (int x = 0; x < WIDTH; x++) {
-      line[x] = lineAbove[x];
-    }
-  }
-  // Refresh top line
+static void mutateField_emptyLine(GameInstance* game, int y) {
+  mutateField_setRow(game, y, ROW_EMPTY);
   for (int x = 0; x < WIDTH; x++) {
-    g_field[0][x] = BLOCK_NONE;
+    game->field.colours[y][x] = BLOCK_NONE;
   }
 }
 
-static int mutateField_clearLines() {
-  int cleared = 0;
-  for (int y = 0; y < HEIGHT; y++) {
-    bool shouldClear = isLineComplete(y);
-    if (shouldClear) {
-      cleared++;
-      mutateField_clearLine(y);
+/**
+ * Clear any full lines between top and bottom (the rows the last piece landed on), then shift the
+ * rows above down in one pass. Returns a mask of the cleared rows, bit (1 << y) for row y
+ */
+static uint32_t mutateField_clearLines(GameInstance* game, int top, int bottom) {
+  uint32_t cleared = 0;
+  int lowest = 0;
+  for (int y = top; y <= bottom; y++) {
+    if (isLineComplete(game, y)) {
+      cleared |= 1u << y;
+      lowest = y;
+    }
+  }
+  if (!cleared) return 0;
+
+  // Rows below the lowest cleared line don't move; everything above it closes the gaps
+  int to = lowest;
+  for (int from = lowest; from >= 0; from--) {
+    if (cleared & (1u << from)) continue;
+    if (from != to) {
+      mutateField_copyLine(game, from, to);
     }
+    to--;
+  }
+  for (; to >= 0; to--) {
+    mutateField_emptyLine(game, to);
   }
+
+  // Full rows have no transitions, so only heights, holes and the surface change
+  mutateFeatures_clearLines(&game->field, cleared);
   return cleared;
 }
 
-static void action_commitPiece() {
+static int countRows(uint32_t rows) {
+  int count = 0;
+  for (; rows; rows &= rows - 1) {
+    count++;
+  }
+  return count;
+}
+
+static void action_commitPiece(GameInstance* game) {
+  const ShapePlacement* placement = getCurrentPlacement(game);
+  int y = game->state.positionY;
+
   // Insert landed piece
   mutateField_insertBlock(
-    g_gameState.blockName,
-    getCurrentShape(),
-    g_gameState.positionX,
-    g_gameState.positionY
+    game,
+    game->state.blockName,
+    placement,
+    game->state.positionX,
+    y
   );
+  game->state.pieces++;
+  publish(game, EVENT_LOCK, 0);
 
-  // Clear lines
-  int cleared = mutateField_clearLines();
+  // Clear lines (only the rows the piece landed on can have filled up)
+  uint32_t clearedRows = mutateField_clearLines(game, y + placement->top, y + placement->bottom);
+  game->state.clearedRows = clearedRows;
 
   // Update score
-  if (cleared) {
-    g_gameState.clearedLines += cleared;
+  if (clearedRows) {
+    game->state.clearedLines += countRows(clearedRows);
+    publish(game, EVENT_LINES, clearedRows);
   }
 
   // Respawn, check game over
-  GameCollisions spawnCollision = mutateState_spawn();
+  GameCollisions spawnCollision = mutateState_spawn(game);
   if (spawnCollision) {
-    mutateState_gameOver();
+    mutateState_gameOver(game);
   }
 }
 
 /**
- * Public values (docs in header)
+ * Snapshots
  * ============================================================================
  */
 
+#define QUEUE_BAG_SHIFT (3 * PREVIEW_LENGTH)
+#define QUEUE_HEAD_SHIFT (QUEUE_BAG_SHIFT + 7)
+
+#if WIDTH == 10 && HEIGHT == 26
+_Static_assert(sizeof(GameSnapshot) == 64, "GameSnapshot should be one cache line on the default board");
+#endif
+_Static_assert(QUEUE_HEAD_SHIFT + 3 <= 32, "PieceQueue doesn't pack into 32 bits");
+_Static_assert(sizeof(GameState) == 40, "GameState shouldn't pad, so memcmp sees only its fields");
+
+static uint32_t packQueue(const PieceQueue* queue) {
+  uint32_t packed = 0;
+  for (int i = 0; i < PREVIEW_LENGTH; i++) {
+    packed |= (uint32_t) queue->preview[i] << (3 * i);
+  }
+  return packed | (uint32_t) queue->bag << QUEUE_BAG_SHIFT | (uint32_t) queue->head << QUEUE_HEAD_SHIFT;
+}
+
+static void unpackQueue(PieceQueue* queue, uint32_t random, uint32_t packed) {
+  queue->random = random;
+  for (int i = 0; i < PREVIEW_LENGTH; i++) {
+    queue->preview[i] = (packed >> (3 * i)) & 7;
+  }
+  queue->bag = (packed >> QUEUE_BAG_SHIFT) & 0x7F;
+  queue->head = (packed >> QUEUE_HEAD_SHIFT) & 7;
+}
+
 /**
- * Public accessor for drawField as a const 
+ * Set a row's occupancy, clearing the colour of any cell that's now empty
  */
-const DrawField* game_p_drawField = &g_drawField;
+static void mutateField_restoreRow(GameInstance* game, int y, FieldRow row) {
+  if (game->field.rows[y] == row) return;
 
-const GameState* game_p_gameState = &g_gameState;
+  mutateField_setRow(game, y, row);
+  for (int x = 0; x < WIDTH; x++) {
+    if (!(row & ROW_CELL_BIT(x))) {
+      game->field.colours[y][x] = BLOCK_NONE;
+    }
+  }
+}
 
 /**
- * Public functions
+ * Draw state
  * ============================================================================
+ * game_updateDrawState() only rewrites the draw rows that can have changed: field rows marked by
+ * mutateField_setRow() since it last ran, and if the piece or its ghost moved, the rows they
+ * covered then and cover now. gfx_draw() reads game->drawDirtyRows to skip the rest
  */
 
-void game_actionRestart() {
-  mutateField_clear();
-  mutateState_resetGame();
+/**
+ * Everything that decides where the piece and ghost are drawn, in one word to compare
+ */
+static uint32_t packDrawnPiece(const GameState* state, int ghostY) {
+  return state->blockName | state->blockRotation << 3 | (state->positionX - PLACEMENT_MIN_X) << 5
+    | state->positionY << 10 | ghostY << 15 | (state->playState == PLAY_PLAYING) << 20;
 }
 
-uint64_t game_getSpeed() {
-  int setsCleared = g_gameState.clearedLines / 4;
-  int level = fmax(fmin(1, setsCleared), 10);
-  return 500 - (level * 15);
+static uint32_t getPlacementRows(const ShapePlacement* placement, int y) {
+  if (placement->bottom < placement->top) return 0;
+  return ((1u << (placement->bottom - placement->top + 1)) - 1) << (y + placement->top);
 }
 
 /**
- * Copies field + piece items into a field grid
+ * Copy the current piece's cells into the draw field as this value, with the piece at row y
  */
-void game_updateDrawState() {
-  for (int y = 0; y < DRAW_HEIGHT; y++) {
-    for (int x = 0; x < WIDTH; x++) {
-      g_drawField[y][x] = g_field[y + HIDDEN_ROWS][x];
+static void drawPiece(GameInstance* game, const ShapePlacement* placement, int pieceY, BlockNames value) {
+  for (int y = placement->top; y <= placement->bottom; y++) {
+    int fieldY = pieceY + y;
+    if (fieldY < HIDDEN_ROWS) continue;
+
+    for (int x = placement->left; x <= placement->right; x++) {
+      if (!(placement->rows[y] & ROW_CELL_BIT(game->state.positionX + x))) continue;
+      game->drawField[fieldY - HIDDEN_ROWS][game->state.positionX + x] = value;
     }
   }
+}
 
-  shapeHex shape = getCurrentShape();
-  BlockNames block = g_gameState.blockName;
+/**
+ * Public functions
+ * ============================================================================
+ */
 
-  for (int y = 0; y <= 3; y++) {
-    for (int x = 0; x <= 3; x++) {
-      int bit = getShapeBit(shape, y, x);
-      // Skip if empty bit
-      if (bit == 0) continue;
+void game_init(GameInstance* game) {
+  memset(game, 0, sizeof(GameInstance));
+  game->dirtyRows = ALL_FIELD_ROWS;
+}
 
-      // Get projections, bound to field limits
-      int fieldY = g_gameState.positionY + y;
-      int fieldX = g_gameState.positionX + x;
+void game_tick(GameInstance* game) {
+  game->frame++;
+}
 
-      if (fieldY < HIDDEN_ROWS) continue;
-      if (fieldY >= HEIGHT) continue;
-      if (fieldX < 0) continue;
-      if (fieldX >= WIDTH) continue;
+void game_setRecorder(GameInstance* game, ReplayWriter* recorder) {
+  game->recorder = recorder;
+}
 
-      g_drawField[fieldY - HIDDEN_ROWS][fieldX] = block;
+void game_setEvents(GameInstance* game, EventQueue* events) {
+  game->events = events;
+}
+
+void game_setInputs(GameInstance* game, InputQueue* inputs) {
+  game->inputs = inputs;
+}
+
+void game_detach(GameInstance* game) {
+  game->recorder = NULL;
+  game->events = NULL;
+  game->inputs = NULL;
+}
+
+bool game_applyInputs(GameInstance* game, uint32_t until) {
+  bool hardDropped = false;
+  InputAction action;
+  while (game->inputs && input_next(game->inputs, until, &action)) {
+    // Buttons still need reading after game over, so held ones are right on restart
+    if (game->state.playState != PLAY_PLAYING) continue;
+
+    if (action.input == INPUT_LEFT || action.input == INPUT_RIGHT) {
+      GameMovements movement = action.input == INPUT_LEFT ? MOVE_LEFT : MOVE_RIGHT;
+      // Presses always count, as they did from a key; auto shifts only when they'd move, so a
+      // piece held against the wall doesn't fill replays with moves that go nowhere
+      if (!action.repeat) {
+        game_actionMovement(game, movement);
+      }
+      while (action.repeat && canMove(game, movement)) {
+        game_actionMovement(game, movement);
+        if (!action.toWall) break;
+      }
+    } else if (action.input == INPUT_UP) {
+      game_actionRotate(game);
+    } else if (action.input == INPUT_DOWN) {
+      game_actionHardDrop(game);
+      hardDropped = true;
     }
   }
+  return hardDropped;
 }
 
-void game_actionHardDrop() {
-  downMany();
-  action_commitPiece();
+void game_snapshot(const GameInstance* game, GameSnapshot* snapshot) {
+  const GameState* state = &game->state;
+  snapshot->random = state->queue.random;
+  snapshot->queue = packQueue(&state->queue);
+  snapshot->seed = state->seed;
+  snapshot->clearedRows = state->clearedRows;
+  snapshot->clearedLines = state->clearedLines;
+  snapshot->points = state->points;
+  snapshot->pieces = state->pieces;
+  snapshot->piece = state->blockName | state->blockRotation << 3 | state->playState << 5;
+  snapshot->positionX = state->positionX;
+  snapshot->positionY = state->positionY;
+
+  // Rows go into a bit accumulator, which is written out 32 bits at a time
+  uint64_t bits = 0;
+  int bitCount = 0;
+  uint8_t* out = snapshot->cells;
+  for (int y = 0; y < HEIGHT; y++) {
+    bits |= (uint64_t) ROW_CELLS(game->field.rows[y]) << bitCount;
+    bitCount += WIDTH;
+    if (bitCount >= 32) {
+      uint32_t word = bits;
+      memcpy(out, &word, sizeof(word));
+      out += sizeof(word);
+      bits >>= 32;
+      bitCount -= 32;
+    }
+  }
+  for (; bitCount > 0; bitCount -= 8) {
+    *out++ = bits;
+    bits >>= 8;
+  }
 }
 
-void game_actionSoftDrop() {
-  GameCollisions collision = downOne();
-  if (collision != COLLIDE_NONE) {
-    action_commitPiece();
+void game_restore(GameInstance* game, const GameSnapshot* snapshot) {
+  GameState* state = &game->state;
+  unpackQueue(&state->queue, snapshot->random, snapshot->queue);
+  state->seed = snapshot->seed;
+  state->clearedRows = snapshot->clearedRows;
+  state->clearedLines = snapshot->clearedLines;
+  state->points = snapshot->points;
+  state->pieces = snapshot->pieces;
+  state->blockName = snapshot->piece & 7;
+  state->blockRotation = (snapshot->piece >> 3) & 3;
+  state->playState = snapshot->piece >> 5;
+  state->positionX = snapshot->positionX;
+  state->positionY = snapshot->positionY;
+
+  uint64_t bits = 0;
+  int bitCount = 0;
+  const uint8_t* in = snapshot->cells;
+  const uint8_t* end = in + SNAPSHOT_CELL_BYTES;
+  for (int y = 0; y < HEIGHT; y++) {
+    if (bitCount < WIDTH) {
+      if (end - in >= 4) {
+        uint32_t word;
+        memcpy(&word, in, sizeof(word));
+        bits |= (uint64_t) word << bitCount;
+        in += sizeof(word);
+        bitCount += 32;
+      } else {
+        for (; in < end; bitCount += 8) {
+          bits |= (uint64_t) *in++ << bitCount;
+        }
+      }
+    }
+    mutateField_restoreRow(game, y, ROW_EMPTY | (bits & ((1u << WIDTH) - 1)) << RIGHT_WALL_BITS);
+    bits >>= WIDTH;
+    bitCount -= WIDTH;
   }
+  game_computeFeatures(&game->field, &game->field.features);
 }
 
-void game_actionMovement(GameMovements movement) {
-  int nextX = g_gameState.positionX + movement;
+void game_computeFeatures(const Field* field, FieldFeatures* features) {
+  *features = (FieldFeatures) { 0 };
+  int filled = 0;
+  for (int y = 0; y < HEIGHT; y++) {
+    FieldRow row = field->rows[y];
+    features->rowTransitions += getRowTransitions(row);
+    for (uint32_t cells = ROW_CELLS(row); cells; cells &= cells - 1) {
+      int x = WIDTH - 1 - __builtin_ctz(cells);
+      if (!features->heights[x]) {
+        features->heights[x] = HEIGHT - y;
+        features->aggregateHeight += HEIGHT - y;
+      }
+      filled++;
+    }
+  }
+  features->holes = features->aggregateHeight - filled;
+  mutateFeatures_surface(features, 0, WIDTH - 1, 1);
+}
 
-  // Check out of bounds
-  // (don't constrain on left, as the left edge of a block's 4x4 grid could be empty)
-  if (nextX >= WIDTH) return;
+uint64_t game_hashField(const Field* field) {
+  uint64_t hash = 0;
+  for (int y = 0; y < HEIGHT; y++) {
+    hash ^= getRowKey(y, field->rows[y]);
+  }
+  return hash;
+}
 
-  // Check collisions
-  GameCollisions moveCollision = getCollisions(
-    getCurrentShape(),
-    nextX,
-    g_gameState.positionY
-  );
-  if (moveCollision != COLLIDE_NONE) return;
+void game_actionRestart(GameInstance* game, uint32_t seed) {
+  if (game->recorder) {
+    replay_recordRestart(game->recorder, game, seed);
+  }
+
+  publish(game, EVENT_RESTART, seed);
+  mutateField_clear(game);
+  mutateState_resetGame(game, seed);
+}
+
+uint64_t game_getSpeed(const GameInstance* game) {
+  int setsCleared = game->state.clearedLines / 4;
+  int level = fmax(fmin(1, setsCleared), 10);
+  return 500 - (level * 15);
+}
+
+void game_updateDrawState(GameInstance* game) {
+  const GameState* state = &game->state;
+  const ShapePlacement* placement = getCurrentPlacement(game);
+  bool playing = state->playState == PLAY_PLAYING;
+  int ghostY = playing ? game_getGhostY(game) : state->positionY;
+
+  uint32_t rows = game->dirtyRows;
+  uint32_t piece = packDrawnPiece(state, ghostY);
+  if (piece != game->drawnPiece) {
+    uint32_t pieceRows = getPlacementRows(placement, state->positionY) | getPlacementRows(placement, ghostY);
+    rows |= game->drawnRows | pieceRows;
+    game->drawnPiece = piece;
+    game->drawnRows = pieceRows;
+  }
+  rows >>= HIDDEN_ROWS;
+
+  for (uint32_t bits = rows; bits; bits &= bits - 1) {
+    int y = __builtin_ctz(bits);
+    memcpy(game->drawField[y], game->field.colours[y + HIDDEN_ROWS], sizeof(game->drawField[y]));
+  }
+  // The piece and ghost rows are always rewritten along with whatever is under them
+  if (rows & (game->drawnRows >> HIDDEN_ROWS)) {
+    if (playing) drawPiece(game, placement, ghostY, state->blockName | DRAW_GHOST);
+    drawPiece(game, placement, state->positionY, state->blockName);
+  }
+
+  game->drawDirtyRows = rows;
+  game->dirtyRows = 0;
+}
+
+void game_spawnPiece(GameInstance* game, BlockNames block) {
+  game->state.playState = PLAY_PLAYING;
+  if (mutateState_spawnBlock(game, block) != COLLIDE_NONE) {
+    mutateState_gameOver(game);
+  }
+}
+
+void game_actionPlace(GameInstance* game, int x, int rotation, int y) {
+  assert(getCollisions(game, getPlacement(game, rotation, x), y) == COLLIDE_NONE);
+  assert(getDropCollision(game, getPlacement(game, rotation, x), y + 1) != COLLIDE_NONE);
+
+  mutateState_setX(game, x);
+  mutateState_setRotation(game, rotation);
+  mutateState_setY(game, y);
+  action_commitPiece(game);
+}
+
+int game_getGhostY(const GameInstance* game) {
+  const GameState* state = &game->state;
+  return state->positionY + getDropDistance(game, getCurrentPlacement(game), state->positionX, state->positionY);
+}
+
+void game_actionHardDrop(GameInstance* game) {
+  record(game, INPUT_DOWN);
+  downMany(game);
+  action_commitPiece(game);
+}
+
+void game_actionSoftDrop(GameInstance* game) {
+  record(game, INPUT_SOFTDROP);
+  GameCollisions collision = downOne(game);
+  if (collision != COLLIDE_NONE) {
+    action_commitPiece(game);
+  }
+}
+
+void game_actionMovement(GameInstance* game, GameMovements movement) {
+  record(game, movement == MOVE_LEFT ? INPUT_LEFT : INPUT_RIGHT);
+  if (!canMove(game, movement)) return;
 
   // Otherwise, commit change
-  mutateState_setX(nextX);
+  mutateState_setX(game, game->state.positionX + movement);
+  publish(game, EVENT_MOVE, 0);
 }
 
-void game_actionRotate() {
-  int nextRotation = getNextRotation(g_gameState.blockRotation);
+void game_actionRotate(GameInstance* game) {
+  record(game, INPUT_UP);
+  int nextRotation = getNextRotation(game->state.blockRotation);
 
   // Check collisions
   GameCollisions rotationCollision = getCollisions(
-    getBlockShape(g_gameState.blockName, nextRotation),
-    g_gameState.positionX,
-    g_gameState.positionY
+    game,
+    getPlacement(game, nextRotation, game->state.positionX),
+    game->state.positionY
   );
   if (rotationCollision != COLLIDE_NONE) return;
 
   // Otherwise, commit change
-  mutateState_setRotation(nextRotation);
+  mutateState_setRotation(game, nextRotation);
+  publish(game, EVENT_ROTATE, 0);
 }
@@ -1,29 +1,114 @@
+// Once-only wrapper
+#ifndef GAME_H_SEEN
+#define GAME_H_SEEN
+
 #include "defs.h"
 #include <stdint.h>
 
 /**
- * Pointer to read-only draw state 
+ * All functions act on the GameInstance passed in, so any number of games can run side by side.
+ * Call game_init() then game_actionRestart() on a new instance before anything else. Draw state is
+ * in game->drawField and game state in game->state; treat both as read-only.
+ */
+
+void game_init(GameInstance* game);
+
+/**
+ * Advance the frame clock, call once per frame. Only used to timestamp replays
  */
-const DrawField* game_p_drawField;
+void game_tick(GameInstance* game);
 
-const GameState* game_p_gameState;
+/**
+ * Pack the game into a snapshot, or put a snapshot back. Neither allocates. Colours are only for
+ * drawing, so restoring clears the colour of each cell that's empty in the snapshot but leaves the
+ * rest as they are. The draw field, frame and recorder are left alone
+ */
+void game_snapshot(const GameInstance* game, GameSnapshot* snapshot);
+
+void game_restore(GameInstance* game, const GameSnapshot* snapshot);
 
-uint64_t game_getSpeed();
+/**
+ * Work out field->features from scratch. The game keeps them current itself; this is for code that
+ * writes field rows directly, and for checking
+ */
+void game_computeFeatures(const Field* field, FieldFeatures* features);
 
 /**
- * Updates draw-state, call before render
+ * Zobrist hash of the field's rows, from scratch. Each (row index, row contents) pair has its own
+ * random 64 bit key and the hash XORs together the keys of every row that isn't empty, so the game
+ * keeps field->hash current by XORing out a row's old key and in its new one whenever it changes.
+ * Equal fields always hash equal; different ones collide with odds of about 2^-64
  */
-void game_updateDrawState();
+uint64_t game_hashField(const Field* field);
 
-void game_actionHardDrop();
+/**
+ * Record every action from now on (NULL to stop), see replay.h
+ */
+void game_setRecorder(GameInstance* game, ReplayWriter* recorder);
 
-void game_actionMovement(GameMovements movement);
+/**
+ * Push what happens from now on into this queue (NULL to stop), see events.h
+ */
+void game_setEvents(GameInstance* game, EventQueue* events);
 
-void game_actionRestart();
+/**
+ * Take buttons from this queue (NULL to stop), see input.h
+ */
+void game_setInputs(GameInstance* game, InputQueue* inputs);
 
-void game_actionRotate();
+/**
+ * Clear the recorder, events and inputs, so a copy of a game (for a search, say) can play moves
+ * without recording them or telling the original's listeners
+ */
+void game_detach(GameInstance* game);
+
+/**
+ * Play every press and auto shift in the queue due by 'until', in order, as moves, rotations and
+ * hard drops. Returns true if the piece was hard dropped, so the caller can restart its gravity
+ */
+bool game_applyInputs(GameInstance* game, uint32_t until);
+
+uint64_t game_getSpeed(const GameInstance* game);
+
+/**
+ * Updates draw-state, call before render. Only rows that can have changed are rewritten; their
+ * bits are in game->drawDirtyRows afterwards, (1 << y) for game->drawField[y]. gfx_draw() keeps
+ * the field from the last frame and redraws only those rows, so call this once per gfx_draw()
+ */
+void game_updateDrawState(GameInstance* game);
+
+/**
+ * For search and tools, which pick their own pieces and landings. Neither is recorded in replays.
+ *
+ * game_spawnPiece() swaps the current piece for this one at its spawn position, and sets game over
+ * if it doesn't fit. game_actionPlace() locks the current piece at a landing from movegen.h, as a
+ * hard drop there would, then spawns the next
+ */
+void game_spawnPiece(GameInstance* game, BlockNames block);
+
+void game_actionPlace(GameInstance* game, int x, int rotation, int y);
+
+/**
+ * The y the current piece would land at with a hard drop, without moving it. Renderers draw the
+ * ghost piece there; it costs a few table lookups, the same as the hard drop itself
+ */
+int game_getGhostY(const GameInstance* game);
+
+void game_actionHardDrop(GameInstance* game);
+
+void game_actionMovement(GameInstance* game, GameMovements movement);
+
+/**
+ * Start a new game. The same seed always gives the same sequence of pieces
+ */
+void game_actionRestart(GameInstance* game, uint32_t seed);
+
+void game_actionRotate(GameInstance* game);
 
 /**
  * Gravity-based drop by one row 
  */
-void game_actionSoftDrop();
+void game_actionSoftDrop(GameInstance* game);
+
+// Once-only wrapper
+#endif // GAME_H_SEEN
@@ -43,6 +43,12 @@ static const int CONTROLS_Y = SCORE_Y2 + 66;
 static SDL_Window* p_window = NULL;
 static SDL_Renderer* p_renderer = NULL;
 static TTF_Font* p_font = NULL;
+static bool g_vsync = false;
+
+// The field as last drawn, window-sized so cells sit where they do on screen. NULL if the renderer
+// can't draw to textures, in which case every row is drawn every frame
+static SDL_Texture* p_fieldTexture = NULL;
+static bool g_fieldDrawn = false;
 
 /*
  * Initialisation
@@ -69,12 +75,26 @@ static bool initSDL() {
     return false;
   }
 
-  p_renderer = SDL_CreateRenderer(p_window, -1, SDL_RENDERER_ACCELERATED);
+  // Present waits for the display, which paces the main loop. Drivers may not honour it
+  p_renderer = SDL_CreateRenderer(p_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
   if (p_renderer == NULL) {
     printf("SDL_CreateRenderer failed, error: %s\n", SDL_GetError());
     return false;
   }
 
+  SDL_RendererInfo info;
+  g_vsync = SDL_GetRendererInfo(p_renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC);
+
+  if (SDL_RenderTargetSupported(p_renderer)) {
+    p_fieldTexture = SDL_CreateTexture(
+      p_renderer,
+      SDL_PIXELFORMAT_RGBA8888,
+      SDL_TEXTUREACCESS_TARGET,
+      WINDOW_WIDTH,
+      WINDOW_HEIGHT
+    );
+  }
+
   return true;
 }
 
@@ -183,6 +203,17 @@ static void drawPlayPiece(ColourPalette *p_palette, int posX, int posY) {
   );
 }
 
+/**
+ * Where the current piece will land: an outline in its colour
+ */
+static void drawGhostPiece(ColourPalette *p_palette, int posX, int posY) {
+  const int borderWidth = 2;
+  const int x = SIZE_PADDING + (posX * BLOCK_SIZE);
+  const int y = SIZE_PADDING + (posY * BLOCK_SIZE);
+
+  drawBorder(&(p_palette->main), x, y, x + BLOCK_SIZE, y + BLOCK_SIZE, borderWidth, BORDER_ALL);
+}
+
 static void drawPlayBox() {
   drawBorder(
     &colours_offWhite,
@@ -195,6 +226,62 @@ static void drawPlayBox() {
   );
 }
 
+/**
+ * Redraw the field rows whose bits are set, (1 << y) for drawField[y], over black
+ */
+static void drawFieldRows(const DrawField* p_drawField, uint32_t rows) {
+  SDL_Color bkg = colours_black;
+
+  for (; rows; rows &= rows - 1) {
+    int y = __builtin_ctz(rows);
+    SDL_Rect row = {
+      .x = SIZE_PADDING,
+      .y = SIZE_PADDING + (y * BLOCK_SIZE),
+      .w = FIELD_WIDTH,
+      .h = BLOCK_SIZE
+    };
+    SDL_SetRenderDrawColor(p_renderer, bkg.r, bkg.g, bkg.b, bkg.a);
+    SDL_RenderFillRect(p_renderer, &row);
+
+    for (int x = 0; x < WIDTH; x++) {
+      int blockKey = (*p_drawField)[y][x];
+      if (blockKey & DRAW_GHOST) {
+        drawGhostPiece(colours_blockPalette(blockKey & ~DRAW_GHOST), x, y);
+      } else if (blockKey) {
+        ColourPalette *p_palette = colours_blockPalette(blockKey);
+        drawPlayPiece(p_palette, x, y);
+      }
+    }
+  }
+}
+
+/**
+ * Bring the field texture up to date, redrawing only the rows that changed since last frame, then
+ * copy it to the back buffer. Without a texture, draw every row straight to the back buffer
+ */
+static void drawField(const DrawField* p_drawField, uint32_t dirtyRows) {
+  const uint32_t allRows = (uint32_t) ((1ull << DRAW_HEIGHT) - 1);
+
+  if (!p_fieldTexture) {
+    drawFieldRows(p_drawField, allRows);
+    return;
+  }
+
+  SDL_SetRenderTarget(p_renderer, p_fieldTexture);
+  if (!g_fieldDrawn) {
+    SDL_Color bkg = colours_black;
+    SDL_SetRenderDrawColor(p_renderer, bkg.r, bkg.g, bkg.b, bkg.a);
+    SDL_RenderClear(p_renderer);
+    dirtyRows = allRows;
+    g_fieldDrawn = true;
+  }
+  drawFieldRows(p_drawField, dirtyRows);
+  SDL_SetRenderTarget(p_renderer, NULL);
+
+  SDL_Rect field = { SIZE_PADDING, SIZE_PADDING, FIELD_WIDTH, DRAW_HEIGHT * BLOCK_SIZE };
+  SDL_RenderCopy(p_renderer, p_fieldTexture, &field, &field);
+}
+
 static void drawText(const char* text, int x, int y, int size, SDL_Color colour) {
   int fontSizeSet = TTF_SetFontSize(p_font, size);
   assert(fontSizeSet == 0);
@@ -235,7 +322,15 @@ bool gfx_init() {
   return initSDL() && initFont();
 }
 
+bool gfx_hasVsync() {
+  return g_vsync;
+}
+
 void gfx_cleanup() {
+  if (p_fieldTexture) SDL_DestroyTexture(p_fieldTexture);
+  p_fieldTexture = NULL;
+  g_fieldDrawn = false;
+
   SDL_DestroyRenderer(p_renderer);
   p_renderer = NULL;
 
@@ -248,7 +343,7 @@ void gfx_cleanup() {
   SDL_Quit();
 }
 
-void gfx_draw(const DrawField* p_drawField, const GameState* p_gameState) {
+void gfx_draw(const DrawField* p_drawField, uint32_t dirtyRows, const GameState* p_gameState) {
   // Clear the backbuffer
   SDL_RenderClear(p_renderer);
 
@@ -260,16 +355,7 @@ void gfx_draw(const DrawField* p_drawField, const GameState* p_gameState) {
   // Play box and play pieces
 
   drawPlayBox();
-
-  for (int y = 0; y < DRAW_HEIGHT; y++) {
-    for (int x = 0; x < WIDTH; x++) {
-      int blockKey = (*p_drawField)[y][x];
-      if (blockKey) {
-        ColourPalette *p_palette = colours_blockPalette(blockKey);
-        drawPlayPiece(p_palette, x, y);
-      }
-    }
-  }
+  drawField(p_drawField, dirtyRows);
 
   /**
    * UI layout:
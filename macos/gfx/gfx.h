@@ -4,4 +4,13 @@
 bool gfx_init();
 void gfx_cleanup();
 
-void gfx_draw(const DrawField* drawField, const GameState* p_gameState);
+/**
+ * Whether gfx_draw() waits for the display's refresh. If not, the caller has to pace itself
+ */
+bool gfx_hasVsync();
+
+/**
+ * Draw a frame. dirtyRows are the draw rows changed since the last call, as game_updateDrawState()
+ * leaves them in drawDirtyRows; the field keeps the rest from the frame before
+ */
+void gfx_draw(const DrawField* drawField, uint32_t dirtyRows, const GameState* p_gameState);
@@ -0,0 +1,134 @@
+#include <stddef.h>
+
+#include "input.h"
+
+/**
+ * input.c
+ * ================================================================================================
+ * A ring of presses and releases, like events.c but for one thread: the front-end pushes and the
+ * game pops, both from the main loop. Times are microseconds in a uint32_t, which wraps every 71
+ * minutes, so they're only ever compared by difference.
+ *
+ * Auto shift is worked out as the queue is read rather than when buttons are pushed, so shifts
+ * land at the exact times the delay and repeat rate give, between or after the events around them,
+ * however coarse the steps that read them are.
+ * ================================================================================================
+ */
+
+#define SLOT(index) ((index) & (INPUT_CAPACITY - 1))
+#define BIT(input) (1 << (input))
+#define QUEUED (BIT(INPUT_LEFT) | BIT(INPUT_RIGHT) | BIT(INPUT_UP) | BIT(INPUT_DOWN))
+
+_Static_assert((INPUT_CAPACITY & (INPUT_CAPACITY - 1)) == 0, "INPUT_CAPACITY must be a power of two");
+
+// Whether 'time' is at or before 'until', across a wrap
+static bool isDue(uint32_t time, uint32_t until) {
+  return (int32_t) (until - time) >= 0;
+}
+
+static GameInputs otherDirection(GameInputs input) {
+  return input == INPUT_LEFT ? INPUT_RIGHT : INPUT_LEFT;
+}
+
+static void startShift(InputQueue* queue, GameInputs direction, uint32_t time) {
+  queue->shift = direction;
+  queue->charged = false;
+  queue->shiftAt = time + queue->das;
+}
+
+static bool push(InputQueue* queue, GameInputs input, bool pressed, uint32_t time) {
+  if (input >= 8 || !(BIT(input) & QUEUED)) return false;
+  if (queue->tail - queue->head == INPUT_CAPACITY) {
+    queue->dropped++;
+    return false;
+  }
+  // Keep the ring in order
+  if (queue->tail != queue->head && !isDue(queue->last, time)) time = queue->last;
+  queue->last = time;
+
+  queue->events[SLOT(queue->tail)] = (InputEvent) { time, input, pressed };
+  queue->tail++;
+  return true;
+}
+
+/**
+ * Update what's held for one event. Returns true with the action for a press
+ */
+static bool applyEvent(InputQueue* queue, const InputEvent* event, InputAction* action) {
+  GameInputs input = event->input;
+  bool isDirection = input == INPUT_LEFT || input == INPUT_RIGHT;
+
+  if (!event->pressed) {
+    queue->held &= ~BIT(input);
+    if (input == queue->shift) {
+      // Fall back to the other direction if it's still down, from the start of its delay
+      GameInputs other = otherDirection(input);
+      if (queue->held & BIT(other)) {
+        startShift(queue, other, event->time);
+      } else {
+        queue->shift = INPUT_NONE;
+      }
+    }
+    return false;
+  }
+
+  queue->held |= BIT(input);
+  if (isDirection) startShift(queue, input, event->time);
+  *action = (InputAction) { .time = event->time, .input = input };
+  return true;
+}
+
+void input_init(InputQueue* queue, uint32_t das, uint32_t arr) {
+  *queue = (InputQueue) { .das = das, .arr = arr, .shift = INPUT_NONE };
+}
+
+void input_setRepeat(InputQueue* queue, uint32_t das, uint32_t arr) {
+  queue->das = das;
+  queue->arr = arr;
+}
+
+bool input_press(InputQueue* queue, GameInputs input, uint32_t time) {
+  return push(queue, input, true, time);
+}
+
+bool input_release(InputQueue* queue, GameInputs input, uint32_t time) {
+  return push(queue, input, false, time);
+}
+
+bool input_next(InputQueue* queue, uint32_t until, InputAction* action) {
+  while (true) {
+    const InputEvent* event = NULL;
+    if (queue->head != queue->tail && isDue(queue->events[SLOT(queue->head)].time, until)) {
+      event = &queue->events[SLOT(queue->head)];
+    }
+
+    // The delay or a repeat, if it falls due before the next event. Ties go to the event, so a
+    // release at the same moment cancels the shift
+    bool shifting = queue->shift != INPUT_NONE && (!queue->charged || queue->arr > 0);
+    if (shifting && isDue(queue->shiftAt, until) && !(event && isDue(event->time, queue->shiftAt))) {
+      *action = (InputAction) { queue->shiftAt, queue->shift, true, queue->arr == 0 };
+      queue->charged = true;
+      if (queue->arr == 0) {
+        queue->slidUntil = queue->shiftAt;
+      } else {
+        queue->shiftAt += queue->arr;
+      }
+      return true;
+    }
+
+    if (event) {
+      queue->head++;
+      if (applyEvent(queue, event, action)) return true;
+      continue;
+    }
+
+    // With arr 0 a charged shift holds the piece against the wall, once per read, so new pieces
+    // and pieces that rotate away from it go straight back
+    if (queue->shift != INPUT_NONE && queue->charged && queue->arr == 0 && queue->slidUntil != until) {
+      queue->slidUntil = until;
+      *action = (InputAction) { until, queue->shift, true, true };
+      return true;
+    }
+    return false;
+  }
+}
@@ -0,0 +1,78 @@
+// Once-only wrapper
+#ifndef INPUT_H_SEEN
+#define INPUT_H_SEEN
+
+#include "defs.h"
+
+/**
+ * Buttons as the player pressed them, for the engine to play back in order. Front-ends report
+ * presses and releases with the time they happened, in microseconds on any clock that only goes
+ * forward, as soon as they see them; however many arrive between steps, none are lost. Attach a
+ * queue with game_setInputs(), and game_applyInputs() plays everything up to a given time.
+ *
+ * Holding left or right shifts the piece once, then after das (delayed auto shift) again every
+ * arr (auto repeat rate). With arr 0 it goes straight to the wall, and new pieces follow it there
+ * while the button stays down. Pressing the other direction takes over and starts the delay again.
+ *
+ * Queued buttons are INPUT_LEFT, INPUT_RIGHT, INPUT_UP (rotate) and INPUT_DOWN (hard drop). Restart
+ * and quit need a seed or the front-end, so they don't go through here.
+ */
+
+#define INPUT_CAPACITY 32              // Power of two
+#define INPUT_DEFAULT_DAS_US 167000    // 10 frames at 60 Hz
+#define INPUT_DEFAULT_ARR_US 33000     // 2 frames
+
+struct InputEvent {
+  uint32_t time;
+  uint8_t input;    // GameInputs
+  uint8_t pressed;
+} typedef InputEvent;
+
+/**
+ * An action for the game, at the time it's due. Auto shifts are repeats, and with arr 0 go to the wall
+ */
+struct InputAction {
+  uint32_t time;
+  GameInputs input;
+  bool repeat;
+  bool toWall;
+} typedef InputAction;
+
+struct InputQueue {
+  InputEvent events[INPUT_CAPACITY];
+  uint32_t head;
+  uint32_t tail;
+  uint32_t dropped;
+  uint32_t das;
+  uint32_t arr;
+  uint32_t last;        // Time of the last event pushed
+  uint8_t held;         // Queued buttons down, as bits (1 << input)
+  uint8_t shift;        // INPUT_LEFT or INPUT_RIGHT while one auto shifts, else INPUT_NONE
+  bool charged;         // The delay has passed
+  uint32_t shiftAt;     // When it next shifts
+  uint32_t slidUntil;   // With arr 0, the last time it slid to the wall
+};
+
+void input_init(InputQueue* queue, uint32_t das, uint32_t arr);
+
+/**
+ * Change das and arr. Takes effect from the next press
+ */
+void input_setRepeat(InputQueue* queue, uint32_t das, uint32_t arr);
+
+/**
+ * Report a button going down or up. A time earlier than one still queued counts as that one. Returns
+ * false if the button isn't one that's queued, or if the queue is full (counted in queue->dropped)
+ */
+bool input_press(InputQueue* queue, GameInputs input, uint32_t time);
+
+bool input_release(InputQueue* queue, GameInputs input, uint32_t time);
+
+/**
+ * Take the next action due by 'until', in time order: presses, then auto shifts as they fall due.
+ * Returns false once there are none
+ */
+bool input_next(InputQueue* queue, uint32_t until, InputAction* action);
+
+// Once-only wrapper
+#endif // INPUT_H_SEEN
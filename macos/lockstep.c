@@ -0,0 +1,332 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "blocks.h"
+#include "lockstep.h"
+
+/**
+ * lockstep.c
+ * ================================================================================================
+ * Each step splits in two. Per-lane bookkeeping stays scalar, here: reading inputs, bounds checks
+ * that game.c does on coordinates, placement lookups for rotations and spawns, and the piece
+ * queue. Everything that touches rows runs on all lanes at once in lockstep_lanes.h: collision,
+ * moving and dropping pieces, locking and clearing lines.
+ * ================================================================================================
+ */
+
+#define LANES LOCKSTEP_LANES
+
+struct LaneMasks {
+  FieldRow left[LANES];
+  FieldRow right[LANES];
+  FieldRow rotate[LANES];
+  FieldRow soft[LANES];
+  FieldRow hard[LANES];
+  FieldRow blocked[LANES];            // Out of bounds before checking the field
+  int first;                          // Rows that moving, rotating and soft dropping pieces cover,
+  int last;                           // before and after
+  int hardFirst;                      // Rows that hard dropping pieces cover before they fall
+  int hardLast;
+  FieldRow rotated[HEIGHT][LANES];  // Rotating lanes' pieces in their next rotation
+} typedef LaneMasks;
+
+static bool isPlaying(const LockstepGames* games, int lane) {
+  return games->states[lane].playState == PLAY_PLAYING;
+}
+
+static const ShapePlacement* getLanePlacement(const GameState* state, int rotation, int x) {
+  return getShapePlacement(state->blockName, rotation, x);
+}
+
+static void widenRows(int* first, int* last, int top, int bottom) {
+  if (top < *first) *first = top;
+  if (bottom > *last) *last = bottom;
+}
+
+/**
+ * Rows covered by the current pieces of the lanes set in the mask. Returns false for no lanes
+ */
+static bool getPieceRows(const LockstepGames* games, const FieldRow lanes[LANES], int* first, int* last) {
+  *first = HEIGHT;
+  *last = -1;
+  for (int lane = 0; lane < LANES; lane++) {
+    if (!lanes[lane]) continue;
+    const GameState* state = &games->states[lane];
+    const ShapePlacement* placement = getLanePlacement(state, state->blockRotation, state->positionX);
+    widenRows(first, last, state->positionY + placement->top, state->positionY + placement->bottom);
+  }
+  return *first <= *last;
+}
+
+static void scatterPiece(FieldRow piece[HEIGHT][LANES], int lane, const ShapePlacement* placement, int y) {
+  for (int row = placement->top; row <= placement->bottom; row++) {
+    piece[y + row][lane] = placement->rows[row];
+  }
+}
+
+static const ShapePlacement* getCurrentPlacement(const GameState* state) {
+  return getLanePlacement(state, state->blockRotation, state->positionX);
+}
+
+/**
+ * Clear the lane's piece rows before its state moves the piece somewhere else. Only the rows the
+ * piece covers are touched, so this and mutateLane_setPiece() are a few stores, not a column
+ */
+static void mutateLane_clearPiece(LockstepGames* games, int lane) {
+  const GameState* state = &games->states[lane];
+  const ShapePlacement* placement = getCurrentPlacement(state);
+  for (int row = placement->top; row <= placement->bottom; row++) {
+    games->piece[state->positionY + row][lane] = 0;
+  }
+}
+
+/**
+ * Set the lane's piece rows from its state, e.g. after a spawn
+ */
+static void mutateLane_setPiece(LockstepGames* games, int lane) {
+  const GameState* state = &games->states[lane];
+  scatterPiece(games->piece, lane, getCurrentPlacement(state), state->positionY);
+}
+
+static void mutateLane_spawn(LockstepGames* games, int lane) {
+  GameState* state = &games->states[lane];
+  state->blockName = nextPiece(&state->queue);
+  state->blockRotation = 0;
+  int x, y;
+  getSpawnPosition(state->blockName, &x, &y);
+  state->positionX = x;
+  state->positionY = y;
+  mutateLane_setPiece(games, lane);
+}
+
+/**
+ * Which lanes do what this step, with the same coordinate checks as game_actionMovement() and
+ * game_actionRotate(). Lanes that are game over do nothing. Returns false if no lane does anything
+ */
+static bool fillMasks(const LockstepGames* games, const GameInputs inputs[LANES], LaneMasks* masks) {
+  memset(masks, 0, offsetof(LaneMasks, rotated));
+  masks->first = masks->hardFirst = HEIGHT;
+  masks->last = masks->hardLast = -1;
+  bool any = false;
+  bool rotating = false;
+
+  for (int lane = 0; lane < LANES; lane++) {
+    GameInputs input = inputs[lane];
+    if (input == INPUT_NONE || !isPlaying(games, lane)) continue;
+    const GameState* state = &games->states[lane];
+    const ShapePlacement* placement = getCurrentPlacement(state);
+    int top = state->positionY + placement->top;
+    int bottom = state->positionY + placement->bottom;
+
+    switch (input) {
+      case INPUT_LEFT:
+      case INPUT_RIGHT: {
+        int nextX = state->positionX + (input == INPUT_LEFT ? MOVE_LEFT : MOVE_RIGHT);
+        FieldRow* mask = input == INPUT_LEFT ? masks->left : masks->right;
+        mask[lane] = ROW_FULL;
+        bool inBounds = nextX >= -WALL_BITS && nextX < WIDTH;
+        if (!inBounds || getLanePlacement(state, state->blockRotation, nextX)->walls) masks->blocked[lane] = ROW_FULL;
+        widenRows(&masks->first, &masks->last, top, bottom);
+        break;
+      }
+      case INPUT_UP: {
+        const ShapePlacement* next = getLanePlacement(state, getNextRotation(state->blockRotation), state->positionX);
+        if (!rotating) memset(masks->rotated, 0, sizeof(masks->rotated));
+        rotating = true;
+        masks->rotate[lane] = ROW_FULL;
+        if (next->walls || state->positionY + next->bottom >= HEIGHT) {
+          masks->blocked[lane] = ROW_FULL;
+        } else {
+          scatterPiece(masks->rotated, lane, next, state->positionY);
+          widenRows(&masks->first, &masks->last, state->positionY + next->top, state->positionY + next->bottom);
+        }
+        widenRows(&masks->first, &masks->last, top, bottom);
+        break;
+      }
+      case INPUT_SOFTDROP:
+        masks->soft[lane] = ROW_FULL;
+        widenRows(&masks->first, &masks->last, top, bottom < HEIGHT - 1 ? bottom + 1 : bottom);
+        break;
+      case INPUT_DOWN:
+        masks->hard[lane] = ROW_FULL;
+        widenRows(&masks->hardFirst, &masks->hardLast, top, bottom);
+        break;
+      default:
+        continue;
+    }
+    any = true;
+  }
+
+  // Rotated rows outside the band are never read, so only clear them when something rotates
+  if (!rotating) {
+    for (int y = masks->first; y <= masks->last; y++) {
+      memset(masks->rotated[y], 0, sizeof(masks->rotated[y]));
+    }
+  }
+  return any;
+}
+
+static void applyMoves(LockstepGames* games, const GameInputs inputs[LANES], const FieldRow moved[LANES]) {
+  for (int lane = 0; lane < LANES; lane++) {
+    if (!moved[lane]) continue;
+    GameState* state = &games->states[lane];
+    switch (inputs[lane]) {
+      case INPUT_LEFT:
+        state->positionX += MOVE_LEFT;
+        break;
+      case INPUT_RIGHT:
+        state->positionX += MOVE_RIGHT;
+        break;
+      case INPUT_UP:
+        state->blockRotation = getNextRotation(state->blockRotation);
+        break;
+      case INPUT_SOFTDROP:
+        state->positionY++;
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+static void applyFalls(LockstepGames* games, const FieldRow fallen[LANES]) {
+  for (int lane = 0; lane < LANES; lane++) {
+    if (!fallen[lane]) continue;
+    mutateLane_clearPiece(games, lane);
+    games->states[lane].positionY += fallen[lane];
+    mutateLane_setPiece(games, lane);
+  }
+}
+
+/**
+ * After locking: count the piece and lines, as action_commitPiece() does, then spawn the next
+ */
+static void spawnPieces(LockstepGames* games, const FieldRow locked[LANES], const uint32_t cleared[LANES]) {
+  for (int lane = 0; lane < LANES; lane++) {
+    if (!locked[lane]) continue;
+    GameState* state = &games->states[lane];
+    state->pieces++;
+    state->clearedRows = cleared[lane];
+    state->clearedLines += __builtin_popcount(cleared[lane]);
+    mutateLane_clearPiece(games, lane);
+    mutateLane_spawn(games, lane);
+  }
+}
+
+/**
+ * Move each playing lane's piece to its landing and OR it into the field, as mutateField_insertBlock()
+ * does bar the colours. The lanes go in placing, and the rows they cover in first to last. Returns
+ * false if no lane places
+ */
+static bool insertPieces(LockstepGames* games, const Move landings[LANES], FieldRow placing[LANES], int* first,
+  int* last) {
+  *first = HEIGHT;
+  *last = -1;
+  for (int lane = 0; lane < LANES; lane++) {
+    placing[lane] = 0;
+    if (!isPlaying(games, lane)) continue;
+    mutateLane_clearPiece(games, lane);
+
+    GameState* state = &games->states[lane];
+    const Move* landing = &landings[lane];
+    state->positionX = landing->x;
+    state->positionY = landing->y;
+    state->blockRotation = landing->rotation;
+    const ShapePlacement* placement = getCurrentPlacement(state);
+    for (int row = placement->top; row <= placement->bottom; row++) {
+      games->rows[landing->y + row][lane] |= placement->rows[row];
+    }
+    placing[lane] = ROW_FULL;
+    widenRows(first, last, landing->y + placement->top, landing->y + placement->bottom);
+  }
+  return *first <= *last;
+}
+
+static void endGames(LockstepGames* games, const FieldRow toppedOut[LANES]) {
+  for (int lane = 0; lane < LANES; lane++) {
+    if (toppedOut[lane]) games->states[lane].playState = PLAY_GAMEOVER;
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X86 1
+#else
+#define X86 0
+#endif
+
+#define SUFFIX avx2
+#if X86
+#define TARGET __attribute__((target("avx2")))
+#else
+#define TARGET
+#endif
+#include "lockstep_lanes.h"
+
+#define SUFFIX vector
+#define TARGET
+#include "lockstep_lanes.h"
+
+static bool hasAvx2() {
+#if X86
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+/**
+ * Public functions
+ * ============================================================================
+ */
+
+void lockstep_restart(LockstepGames* games, const uint32_t seeds[LANES]) {
+  for (int y = 0; y < HEIGHT; y++) {
+    for (int lane = 0; lane < LANES; lane++) {
+      games->rows[y][lane] = ROW_EMPTY;
+    }
+  }
+  memset(games->piece, 0, sizeof(games->piece));
+
+  for (int lane = 0; lane < LANES; lane++) {
+    GameState* state = &games->states[lane];
+    memset(state, 0, sizeof(GameState));
+    state->seed = seeds[lane];
+    seedPieces(&state->queue, seeds[lane]);
+    state->playState = PLAY_PLAYING;
+    mutateLane_spawn(games, lane);
+  }
+}
+
+void lockstep_step(LockstepGames* games, const GameInputs inputs[LANES]) {
+  static int useAvx2 = -1;
+  if (useAvx2 < 0) useAvx2 = hasAvx2();
+
+  if (useAvx2) {
+    step_avx2(games, inputs);
+  } else {
+    step_vector(games, inputs);
+  }
+}
+
+void lockstep_place(LockstepGames* games, const Move landings[LANES]) {
+  static int useAvx2 = -1;
+  if (useAvx2 < 0) useAvx2 = hasAvx2();
+
+  if (useAvx2) {
+    place_avx2(games, landings);
+  } else {
+    place_vector(games, landings);
+  }
+}
+
+uint32_t lockstep_playing(const LockstepGames* games) {
+  uint32_t playing = 0;
+  for (int lane = 0; lane < LANES; lane++) {
+    if (isPlaying(games, lane)) playing |= 1u << lane;
+  }
+  return playing;
+}
+
+const char* lockstep_kernelName() {
+  return hasAvx2() ? "avx2" : "vector";
+}
@@ -0,0 +1,66 @@
+// Once-only wrapper
+#ifndef LOCKSTEP_H_SEEN
+#define LOCKSTEP_H_SEEN
+
+#include "defs.h"
+#include "movegen.h"
+
+/**
+ * Many games stepped together, for rollouts. Boards are stored structure-of-arrays: row y of every
+ * game sits side by side in rows[y], one row-sized lane per game, so collision, drops, locking and
+ * line clears work on whole vectors of games (AVX2 where the CPU has it). Each game takes its own
+ * input every step, and a lane that doesn't move, or whose game is over, is masked out.
+ *
+ * Each lane plays exactly as game.c does: the same inputs from the same seed give the same rows and
+ * GameState, bit for bit (the headless lockstep command checks this). Colours, features and
+ * hashes aren't kept, and nothing is recorded. One difference: actions on a finished game do
+ * nothing here, where game.c carries on applying them.
+ *
+ * There are two ways to play. lockstep_step() takes one input per lane, like a player, and isn't a
+ * speedup: on random inputs it runs at about half the speed of game.c, because lanes branch apart
+ * and the masks and per-lane bookkeeping cost more than the shared vector work saves.
+ * lockstep_place() takes a whole landing per lane, like a bot rollout, skips all of that, and runs
+ * about twice as fast as game_actionPlace() on the same landings.
+ */
+
+#ifndef LOCKSTEP_LANES
+#define LOCKSTEP_LANES 16
+#endif
+
+#if LOCKSTEP_LANES != 8 && LOCKSTEP_LANES != 16
+#error "LOCKSTEP_LANES must be 8 or 16"
+#endif
+
+struct LockstepGames {
+  FieldRow rows[HEIGHT][LOCKSTEP_LANES];   // Every game's field, interleaved by row
+  FieldRow piece[HEIGHT][LOCKSTEP_LANES];  // Every game's current piece, as rows to OR into the field
+  GameState states[LOCKSTEP_LANES];
+} typedef LockstepGames;
+
+/**
+ * Start a new game in every lane, each from its own seed
+ */
+void lockstep_restart(LockstepGames* games, const uint32_t seeds[LOCKSTEP_LANES]);
+
+/**
+ * Apply one input to each lane's game, as the matching game_action* call would: INPUT_LEFT and
+ * INPUT_RIGHT move, INPUT_UP rotates, INPUT_SOFTDROP drops one row (locking if it can't) and
+ * INPUT_DOWN hard drops. Anything else leaves the lane alone
+ */
+void lockstep_step(LockstepGames* games, const GameInputs inputs[LOCKSTEP_LANES]);
+
+/**
+ * Lock each lane's current piece at a landing from movegen_generate(), as game_actionPlace() would,
+ * then spawn the next. Lanes whose game is over ignore theirs
+ */
+void lockstep_place(LockstepGames* games, const Move landings[LOCKSTEP_LANES]);
+
+/**
+ * Bit (1 << lane) set for each lane still playing
+ */
+uint32_t lockstep_playing(const LockstepGames* games);
+
+const char* lockstep_kernelName();
+
+// Once-only wrapper
+#endif // LOCKSTEP_H_SEEN
@@ -0,0 +1,224 @@
+/**
+ * lockstep_lanes.h
+ * ================================================================================================
+ * The vector half of lockstep_step(), included once per instruction set by lockstep.c, the same
+ * way as evaluate_lanes.h. No include guard, on purpose. Define SUFFIX and TARGET before including.
+ *
+ * Lane masks are all ones for lanes taking part and zero otherwise, so every per-lane choice is
+ * a blend: (a & ~mask) | (b & mask).
+ * ================================================================================================
+ */
+
+#define STEP_NAME_(name, suffix) name##_##suffix
+#define STEP_NAME_EXPAND(name, suffix) STEP_NAME_(name, suffix)
+#define STEP_NAME(name) STEP_NAME_EXPAND(name, SUFFIX)
+
+#define Lanes STEP_NAME(Lanes)
+#define UnalignedLanes STEP_NAME(UnalignedLanes)
+
+typedef FieldRow Lanes __attribute__((vector_size(sizeof(FieldRow) * LOCKSTEP_LANES)));
+
+/**
+ * Vectors never go in or out of a call by value: the fallback's are 32 bytes (64 with 32 bit rows),
+ * which GCC passes differently without AVX and warns about. Helpers take and fill them by pointer,
+ * and loads read rows through an unaligned vector type, the way GCC's own loadu intrinsics do
+ */
+typedef FieldRow UnalignedLanes
+  __attribute__((vector_size(sizeof(FieldRow) * LOCKSTEP_LANES), aligned(sizeof(FieldRow)), may_alias));
+
+#define LOAD_LANES(from) (*(const UnalignedLanes*) (from))
+
+TARGET static inline void STEP_NAME(store)(FieldRow* to, const Lanes* v) {
+  memcpy(to, v, sizeof(*v));
+}
+
+TARGET static inline bool STEP_NAME(any)(const Lanes* v) {
+  uint64_t words[sizeof(Lanes) / 8];
+  memcpy(words, v, sizeof(*v));
+  uint64_t any = 0;
+  for (size_t i = 0; i < sizeof(Lanes) / 8; i++) {
+    any |= words[i];
+  }
+  return any != 0;
+}
+
+/**
+ * Set *colliding to the lanes whose piece overlaps the field, looking at rows first to last
+ */
+TARGET static void STEP_NAME(collide)(const LockstepGames* games, int first, int last, Lanes* colliding) {
+  Lanes overlap = { 0 };
+  for (int y = first; y <= last; y++) {
+    overlap |= LOAD_LANES(games->rows[y]) & LOAD_LANES(games->piece[y]);
+  }
+  *colliding = (Lanes) (overlap != 0);
+}
+
+/**
+ * Move, rotate or soft drop each lane in its mask where the result fits. The lanes that moved go in
+ * *moved; soft drop lanes that didn't are left in *landed
+ */
+TARGET static void STEP_NAME(shiftPieces)(LockstepGames* games, const LaneMasks* masks, Lanes* moved, Lanes* landed) {
+  Lanes left = LOAD_LANES(masks->left);
+  Lanes right = LOAD_LANES(masks->right);
+  Lanes rotate = LOAD_LANES(masks->rotate);
+  Lanes soft = LOAD_LANES(masks->soft);
+  Lanes moving = left | right | rotate | soft;
+
+  Lanes candidates[HEIGHT];
+  Lanes overlap = LOAD_LANES(games->piece[HEIGHT - 1]) & soft;  // Soft drop off the bottom
+  Lanes above = { 0 };  // No moving piece reaches above the band
+  for (int y = masks->first; y <= masks->last; y++) {
+    Lanes piece = LOAD_LANES(games->piece[y]);
+    Lanes candidate = ((piece << 1) & left) | ((piece >> 1) & right)
+      | (LOAD_LANES(masks->rotated[y]) & rotate) | (above & soft);
+    overlap |= LOAD_LANES(games->rows[y]) & candidate;
+    candidates[y] = candidate;
+    above = piece;
+  }
+
+  Lanes blocked = (Lanes) (overlap != 0) | LOAD_LANES(masks->blocked);
+  Lanes shifted = moving & ~blocked;
+  for (int y = masks->first; y <= masks->last; y++) {
+    Lanes piece = LOAD_LANES(games->piece[y]);
+    piece = (piece & ~shifted) | (candidates[y] & shifted);
+    STEP_NAME(store)(games->piece[y], &piece);
+  }
+  *moved = shifted;
+  *landed = soft & blocked;
+}
+
+/**
+ * How far each lane in the mask can drop before it lands. Their pieces cover rows first to last;
+ * rather than move them a row at a time, each distance checks the band against the field that
+ * far down, with the floor as a full row. The distances go in *fallen; the caller moves the pieces
+ * once it knows how far
+ */
+TARGET static void STEP_NAME(hardDrop)(const LockstepGames* games, const FieldRow* dropping, int first, int last,
+  Lanes* fallen) {
+  Lanes pieces[HEIGHT];
+  for (int y = first; y <= last; y++) {
+    pieces[y] = LOAD_LANES(games->piece[y]);
+  }
+
+  Lanes active = LOAD_LANES(dropping);
+  Lanes distances = { 0 };
+  for (int distance = 1; STEP_NAME(any)(&active); distance++) {
+    Lanes overlap = { 0 };
+    int aboveFloor = last < HEIGHT - distance ? last : HEIGHT - 1 - distance;
+    for (int y = first; y <= aboveFloor; y++) {
+      overlap |= pieces[y] & LOAD_LANES(games->rows[y + distance]);
+    }
+    for (int y = aboveFloor + 1; y <= last; y++) {
+      overlap |= pieces[y];
+    }
+    active &= (Lanes) (overlap == 0);
+    distances -= active;
+  }
+  *fallen = distances;
+}
+
+/**
+ * Clear full rows between first and last, top down so the rows still to check below haven't moved.
+ * Each lane's cleared rows go to cleared[lane], as bits (1 << y)
+ */
+TARGET static void STEP_NAME(clearLines)(LockstepGames* games, int first, int last, uint32_t cleared[LOCKSTEP_LANES]) {
+  for (int y = first; y <= last; y++) {
+    Lanes full = (Lanes) (LOAD_LANES(games->rows[y]) == ROW_FULL);
+    if (!STEP_NAME(any)(&full)) continue;
+
+    FieldRow fullLanes[LOCKSTEP_LANES];
+    STEP_NAME(store)(fullLanes, &full);
+    for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+      if (fullLanes[lane]) cleared[lane] |= 1u << y;
+    }
+    for (int r = y; r > 0; r--) {
+      Lanes row = (LOAD_LANES(games->rows[r]) & ~full) | (LOAD_LANES(games->rows[r - 1]) & full);
+      STEP_NAME(store)(games->rows[r], &row);
+    }
+    Lanes top = (LOAD_LANES(games->rows[0]) & ~full) | (ROW_EMPTY & full);
+    STEP_NAME(store)(games->rows[0], &top);
+  }
+}
+
+/**
+ * Lock each lane's piece (all within rows first to last) into its field, then clear lines
+ */
+TARGET static void STEP_NAME(lockPieces)(LockstepGames* games, const FieldRow* lockingLanes, int first, int last,
+  uint32_t cleared[LOCKSTEP_LANES]) {
+  Lanes locking = LOAD_LANES(lockingLanes);
+  for (int y = first; y <= last; y++) {
+    Lanes row = LOAD_LANES(games->rows[y]) | (LOAD_LANES(games->piece[y]) & locking);
+    STEP_NAME(store)(games->rows[y], &row);
+  }
+  STEP_NAME(clearLines)(games, first, last, cleared);
+}
+
+/**
+ * After locking: count and spawn, then end the games whose new piece doesn't fit
+ */
+TARGET static void STEP_NAME(respawn)(LockstepGames* games, const FieldRow* lockingLanes,
+  const uint32_t cleared[LOCKSTEP_LANES]) {
+  spawnPieces(games, lockingLanes, cleared);
+
+  int first, last;
+  getPieceRows(games, lockingLanes, &first, &last);
+  Lanes toppedOut;
+  STEP_NAME(collide)(games, first, last, &toppedOut);
+  toppedOut &= LOAD_LANES(lockingLanes);
+  FieldRow toppedOutLanes[LOCKSTEP_LANES];
+  STEP_NAME(store)(toppedOutLanes, &toppedOut);
+  endGames(games, toppedOutLanes);
+}
+
+TARGET static void STEP_NAME(step)(LockstepGames* games, const GameInputs inputs[LOCKSTEP_LANES]) {
+  LaneMasks masks;
+  if (!fillMasks(games, inputs, &masks)) return;
+
+  Lanes landed = { 0 };
+  if (masks.first <= masks.last) {
+    Lanes moved;
+    STEP_NAME(shiftPieces)(games, &masks, &moved, &landed);
+    FieldRow movedLanes[LOCKSTEP_LANES];
+    STEP_NAME(store)(movedLanes, &moved);
+    applyMoves(games, inputs, movedLanes);
+  }
+
+  int first, last;
+  if (masks.hardFirst <= masks.hardLast) {
+    Lanes fallen;
+    STEP_NAME(hardDrop)(games, masks.hard, masks.hardFirst, masks.hardLast, &fallen);
+    FieldRow fallenLanes[LOCKSTEP_LANES];
+    STEP_NAME(store)(fallenLanes, &fallen);
+    applyFalls(games, fallenLanes);
+  }
+
+  Lanes locking = landed | LOAD_LANES(masks.hard);
+  if (!STEP_NAME(any)(&locking)) return;
+  FieldRow lockingLanes[LOCKSTEP_LANES];
+  STEP_NAME(store)(lockingLanes, &locking);
+  getPieceRows(games, lockingLanes, &first, &last);
+
+  uint32_t cleared[LOCKSTEP_LANES] = { 0 };
+  STEP_NAME(lockPieces)(games, lockingLanes, first, last, cleared);
+  STEP_NAME(respawn)(games, lockingLanes, cleared);
+}
+
+/**
+ * The pieces are ORed into the field lane by lane, a few stores each, so only the line clears and
+ * the spawn check are left for the vectors
+ */
+TARGET static void STEP_NAME(place)(LockstepGames* games, const Move landings[LOCKSTEP_LANES]) {
+  FieldRow placing[LOCKSTEP_LANES];
+  int first, last;
+  if (!insertPieces(games, landings, placing, &first, &last)) return;
+
+  uint32_t cleared[LOCKSTEP_LANES] = { 0 };
+  STEP_NAME(clearLines)(games, first, last, cleared);
+  STEP_NAME(respawn)(games, placing, cleared);
+}
+
+#undef Lanes
+#undef UnalignedLanes
+#undef LOAD_LANES
+#undef SUFFIX
+#undef TARGET
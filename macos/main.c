@@ -1,15 +1,23 @@
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "./gfx/gfx.h"
 #include "game.h"
+#include "input.h"
+#include "replay.h"
+#include "timestep.h"
 
-void initRand() {
-  // Seed random number generator
-  // Discard the first rand, as it always is a multiple of 7
-  // https://stackoverflow.com/questions/7866754/why-does-rand-7-always-return-0)
-  srand(time(NULL));
-  rand();
+#define STEPS_PER_SECOND 60
+#define MAX_STEPS_PER_FRAME 8
+#define STEP_US (1000000 / STEPS_PER_SECOND)
+
+static GameInstance g_game;
+static InputQueue g_inputs;
+
+uint32_t newSeed() {
+  // Wall clock plus ticks, so quick restarts within the same second still differ
+  return (uint32_t) time(NULL) ^ (uint32_t) SDL_GetTicks64();
 }
 
 GameInputs parseKey(int keycode) {
@@ -35,82 +43,120 @@ GameInputs parseKey(int keycode) {
   }
 }
 
+/**
+ * Gravity interval in steps, rounded up so a piece never falls sooner than game_getSpeed() says
+ */
+static int gravitySteps() {
+  return (game_getSpeed(&g_game) * STEPS_PER_SECOND + 999) / 1000;
+}
+
+/**
+ * Advance the game one fixed step, ending at 'time' (microseconds, SDL ticks). sinceDrop counts
+ * steps since the piece last fell
+ */
+static void step(uint32_t time, bool restart, int* sinceDrop) {
+  // Every key pressed by the end of the step, and auto shifts, before gravity
+  // Hard drops should reset the gravity timer
+  if (game_applyInputs(&g_game, time)) {
+    *sinceDrop = 0;
+  } else if (g_game.state.playState == PLAY_PLAYING && ++*sinceDrop >= gravitySteps()) {
+    game_actionSoftDrop(&g_game);
+    *sinceDrop = 0;
+  }
+
+  if (restart && g_game.state.playState == PLAY_GAMEOVER) {
+    game_actionRestart(&g_game, newSeed());
+    *sinceDrop = 0;
+  }
+
+  game_tick(&g_game);
+}
+
 int main(int argc, char* argv[]) {
   printf("Start\n");
 
-  // Ignore unused args
-  (void) argv[argc - 1];
-
   if (gfx_init() == false) {
     printf("Startup failed, exiting\n");
     gfx_cleanup();
     return 1;
   }
 
-  initRand();
+  game_init(&g_game);
 
-  game_actionRestart();
+  // Optionally record a replay: notris.out --record FILE
+  FILE* replayFile = NULL;
+  ReplayWriter replay;
+  if (argc == 3 && strcmp(argv[1], "--record") == 0) {
+    replayFile = fopen(argv[2], "wb");
+    if (replayFile) {
+      replay_startWriter(&replay, replayFile, REPLAY_KEYFRAME_INTERVAL);
+      game_setRecorder(&g_game, &replay);
+    } else {
+      printf("Can't write replay to %s\n", argv[2]);
+    }
+  }
 
+  // Keys go to the game with their timestamps, which plays them and auto shift itself
+  input_init(&g_inputs, INPUT_DEFAULT_DAS_US, INPUT_DEFAULT_ARR_US);
+  game_setInputs(&g_game, &g_inputs);
+  game_actionRestart(&g_game, newSeed());
+
+  // The game steps at a fixed rate and renders whenever the display is ready; see timestep.h
+  Timestep timestep;
+  timestep_init(&timestep, SDL_GetPerformanceFrequency(), STEPS_PER_SECOND, MAX_STEPS_PER_FRAME,
+    SDL_GetPerformanceCounter());
+  bool vsync = gfx_hasVsync();
+  bool restart = false;
+  int sinceDrop = 0;
   bool quit = false;
   SDL_Event event;
-  Uint64 timeLastDrop = SDL_GetTicks64();
 
   while (!quit) {
-    GameInputs input = INPUT_NONE;
-
     // Drain queue of events since last loop iteration
     while (SDL_PollEvent(&event) != 0) {
-      if (event.type == SDL_KEYDOWN) {
+      GameInputs input = INPUT_NONE;
+      if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
         input = parseKey(event.key.keysym.sym);
       }
 
-      if (input == INPUT_QUIT || event.type == SDL_QUIT) {
+      if ((input == INPUT_QUIT && event.type == SDL_KEYDOWN) || event.type == SDL_QUIT) {
         quit = true;
         break;
       }
-    }
-
-    Uint64 timeFrameStart = SDL_GetTicks64();
-
-    if (game_p_gameState->playState == PLAY_PLAYING) {
-      // Handle rotations and left/right before dropping
-      if (input == INPUT_LEFT) {
-        game_actionMovement(MOVE_LEFT);
-      } else if (input == INPUT_RIGHT) {
-        game_actionMovement(MOVE_RIGHT);
-      } else if (input == INPUT_UP) {
-        game_actionRotate();
-      }
 
-      // Handle timed or forced drops
-      // These should reset the gravity timer
-      if (input == INPUT_DOWN) {
-        game_actionHardDrop();
-        timeLastDrop = timeFrameStart;
-      } else if ((timeFrameStart - timeLastDrop) > game_getSpeed()) {
-        game_actionSoftDrop();
-        timeLastDrop = timeFrameStart;
+      // The game repeats held keys itself, so the OS's repeats are ignored
+      uint32_t time = event.key.timestamp * 1000;
+      if (event.type == SDL_KEYDOWN && !event.key.repeat) {
+        if (input == INPUT_RESTART) restart = true;
+        input_press(&g_inputs, input, time);
+      } else if (event.type == SDL_KEYUP) {
+        input_release(&g_inputs, input, time);
       }
+    }
 
-    } else {
-      if (input == INPUT_RESTART) {
-        game_actionRestart();
-        timeLastDrop = timeFrameStart;
-      }
+    // Catch up on the steps due. The last ends now, the rest a step apart before it
+    int steps = timestep_advance(&timestep, SDL_GetPerformanceCounter());
+    uint32_t now = SDL_GetTicks64() * 1000;
+    for (int i = 0; i < steps; i++) {
+      step(now - (steps - 1 - i) * STEP_US, restart, &sinceDrop);
+      restart = false;
     }
 
-    game_updateDrawState();
-    gfx_draw(game_p_drawField, game_p_gameState);
-    
-    // Uint64 duration = SDL_GetTicks64() - start;
-    // printf("Frame took %d ms\n", duration);
+    game_updateDrawState(&g_game);
+    gfx_draw(&g_game.drawField, g_game.drawDirtyRows, &g_game.state);
 
-    // Limit to 60 fps
-    while ((SDL_GetTicks64() - timeFrameStart) < 18) {
-      SDL_Delay(1);
+    // Without vsync, sleep until the next step rather than redrawing the same frame
+    if (!vsync) {
+      uint64_t wait = timestep_untilNext(&timestep) * 1000 / SDL_GetPerformanceFrequency();
+      if (wait > 0) SDL_Delay(wait);
     }
   }
 
+  if (replayFile) {
+    replay_finishWriter(&replay, &g_game);
+    fclose(replayFile);
+  }
+
   gfx_cleanup();
   return 0;
 }
@@ -0,0 +1,283 @@
+#include <assert.h>
+#include <string.h>
+
+#include "movegen.h"
+
+/**
+ * movegen.c
+ * ================================================================================================
+ * The field is turned on its side: one 32 bit mask per column of the field rows, bit y set where
+ * the cell in row y is filled. Walls are solid columns and the rows below the field are solid too.
+ * A piece at (rotation, x) then fits at y unless one of its four cells hits something, so every y
+ * it fits at comes from four shifted column masks ORed together:
+ *
+ *   fits[rotation][x] = ~(column[x + dx0] >> dy0 | ... | column[x + dx3] >> dy3)
+ *
+ * Reachable positions are flood filled as masks of y too. A soft drop fills down through a run of
+ * fitting rows, a move or rotate carries the reached rows into the neighbouring (rotation, x) where
+ * they fit, and a position lands where the row below doesn't fit.
+ * ================================================================================================
+ */
+
+#define ROTATIONS 4
+#define NODES (ROTATIONS * PLACEMENT_COLUMNS)
+#define STATES (NODES * HEIGHT)
+#define FIELD_MASK ((uint32_t) ((1ull << HEIGHT) - 1))
+
+#if HEIGHT > 31
+#error "Column masks need a spare bit below the field"
+#endif
+
+struct ShapeCells {
+  int8_t x[4];
+  int8_t y[4];
+  int count;
+} typedef ShapeCells;
+
+/**
+ * Everything worked out from the field and piece before searching
+ */
+struct Board {
+  uint32_t fits[ROTATIONS][PLACEMENT_COLUMNS];  // Bit y set if the piece fits there
+  ShapeCells cells[ROTATIONS];
+} typedef Board;
+
+static int previousRotation(int rotation) {
+  return (rotation + ROTATIONS - 1) % ROTATIONS;
+}
+
+/**
+ * Cells in reading order, from the top left
+ */
+static void getShapeCells(BlockNames block, int rotation, ShapeCells* cells) {
+  shapeHex shape = getBlockShape(block, rotation);
+  cells->count = 0;
+  for (int bit = 0; bit < 16; bit++) {
+    if (!(shape & (GRID_BIT_OFFSET >> bit))) continue;
+    cells->x[cells->count] = bit % 4;
+    cells->y[cells->count] = bit / 4;
+    cells->count++;
+  }
+}
+
+static void buildBoard(const GameInstance* game, Board* board) {
+  uint32_t columns[ROW_BITS];
+  for (int c = 0; c < ROW_BITS; c++) {
+    bool wall = c < WALL_BITS || c >= WALL_BITS + WIDTH;
+    columns[c] = wall ? ~0u : ~FIELD_MASK;
+  }
+  for (int y = 0; y < HEIGHT; y++) {
+    // Only visit filled cells; most rows are empty
+    for (uint32_t cells = game->field.rows[y] & (FieldRow) ~ROW_EMPTY; cells; cells &= cells - 1) {
+      columns[ROW_BITS - 1 - __builtin_ctz(cells)] |= 1u << y;
+    }
+  }
+
+  BlockNames block = game->state.blockName;
+  for (int r = 0; r < ROTATIONS; r++) {
+    ShapeCells* cells = &board->cells[r];
+    getShapeCells(block, r, cells);
+
+    // One cell at a time across every x, which the compiler can vectorise
+    uint32_t blocked[PLACEMENT_COLUMNS] = { 0 };
+    for (int c = 0; c < cells->count; c++) {
+      const uint32_t* from = &columns[WALL_BITS + PLACEMENT_MIN_X + cells->x[c]];
+      int dy = cells->y[c];
+      for (int i = 0; i < PLACEMENT_COLUMNS; i++) {
+        blocked[i] |= from[i] >> dy;
+      }
+    }
+    for (int i = 0; i < PLACEMENT_COLUMNS; i++) {
+      board->fits[r][i] = ~blocked[i] & FIELD_MASK;
+    }
+  }
+}
+
+/**
+ * Extend each reached row down through the rows below it that fit (a Kogge-Stone fill, so five
+ * steps rather than one per row)
+ */
+static inline uint32_t fillDown(uint32_t reached, uint32_t fits) {
+  uint32_t open = fits;
+  reached |= (reached << 1) & open;
+  open &= open << 1;
+  reached |= (reached << 2) & open;
+  open &= open << 2;
+  reached |= (reached << 4) & open;
+  open &= open << 4;
+  reached |= (reached << 8) & open;
+  open &= open << 8;
+  reached |= (reached << 16) & open;
+  return reached;
+}
+
+/**
+ * Two rotations fill the same cells when one is the other moved by (dx, dy). Cells are listed in
+ * reading order, so it's enough to compare them pairwise
+ */
+static bool isTranslation(const ShapeCells* from, const ShapeCells* to, int* dx, int* dy) {
+  if (from->count != to->count || from->count == 0) return false;
+
+  *dx = to->x[0] - from->x[0];
+  *dy = to->y[0] - from->y[0];
+  for (int c = 1; c < from->count; c++) {
+    if (to->x[c] - from->x[c] != *dx || to->y[c] - from->y[c] != *dy) return false;
+  }
+  return true;
+}
+
+/**
+ * Drop landings that fill the same cells as one in an earlier rotation. A piece at (x, y) in
+ * rotation r covers the same cells as (x + dx, y + dy) in the earlier one
+ */
+static void removeDuplicates(const Board* board, uint32_t landings[ROTATIONS][PLACEMENT_COLUMNS]) {
+  for (int r = 1; r < ROTATIONS; r++) {
+    for (int earlier = 0; earlier < r; earlier++) {
+      int dx, dy;
+      if (!isTranslation(&board->cells[r], &board->cells[earlier], &dx, &dy)) continue;
+
+      for (int i = 0; i < PLACEMENT_COLUMNS; i++) {
+        int j = i + dx;
+        if (j < 0 || j >= PLACEMENT_COLUMNS) continue;
+        uint32_t same = dy >= 0 ? landings[earlier][j] >> dy : landings[earlier][j] << -dy;
+        landings[r][i] &= ~same;
+      }
+    }
+  }
+}
+
+int movegen_generate(const GameInstance* game, MoveList* list) {
+  list->count = 0;
+  const GameState* state = &game->state;
+  if (state->playState != PLAY_PLAYING || state->blockName == BLOCK_NONE) return 0;
+
+  Board board;
+  buildBoard(game, &board);
+
+  int startRotation = state->blockRotation;
+  int startColumn = state->positionX - PLACEMENT_MIN_X;
+  uint32_t startFits = board.fits[startRotation][startColumn];
+  if (!(startFits >> state->positionY & 1)) return 0;
+
+  uint32_t reached[ROTATIONS][PLACEMENT_COLUMNS] = { { 0 } };
+  reached[startRotation][startColumn] = fillDown(1u << state->positionY, startFits);
+
+  // Sweep each rotation right then left, carrying rows across and down, then turn into the next
+  // rotation. Repeat until nothing new is reached: usually two or three rounds
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int r = 0; r < ROTATIONS; r++) {
+      const uint32_t* fits = board.fits[r];
+      uint32_t* row = reached[r];
+      const uint32_t* turned = reached[previousRotation(r)];
+
+      for (int i = 0; i < PLACEMENT_COLUMNS; i++) {
+        uint32_t incoming = turned[i];
+        if (i > 0) incoming |= row[i - 1];
+        incoming &= fits[i] & ~row[i];
+        if (incoming) {
+          row[i] = fillDown(row[i] | incoming, fits[i]);
+          changed = true;
+        }
+      }
+      for (int i = PLACEMENT_COLUMNS - 2; i >= 0; i--) {
+        uint32_t incoming = row[i + 1] & fits[i] & ~row[i];
+        if (incoming) {
+          row[i] = fillDown(row[i] | incoming, fits[i]);
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // Landings are reached rows where the row below doesn't fit
+  uint32_t landings[ROTATIONS][PLACEMENT_COLUMNS];
+  for (int r = 0; r < ROTATIONS; r++) {
+    for (int i = 0; i < PLACEMENT_COLUMNS; i++) {
+      landings[r][i] = reached[r][i] & ~(board.fits[r][i] >> 1);
+    }
+  }
+  removeDuplicates(&board, landings);
+
+  for (int r = 0; r < ROTATIONS; r++) {
+    for (int i = 0; i < PLACEMENT_COLUMNS; i++) {
+      for (uint32_t bits = landings[r][i]; bits; bits &= bits - 1) {
+        Move* move = &list->moves[list->count++];
+        move->x = i + PLACEMENT_MIN_X;
+        move->y = __builtin_ctz(bits);
+        move->rotation = r;
+      }
+    }
+  }
+  return list->count;
+}
+
+/**
+ * Paths
+ * ================================================================================================
+ * A plain breadth-first search over (rotation, x, y), on the same fits masks
+ */
+
+static int stateIndex(int rotation, int column, int y) {
+  return (rotation * PLACEMENT_COLUMNS + column) * HEIGHT + y;
+}
+
+int movegen_path(const GameInstance* game, const Move* move, GameInputs* path) {
+  const GameState* state = &game->state;
+  if (state->playState != PLAY_PLAYING || state->blockName == BLOCK_NONE) return -1;
+
+  Board board;
+  buildBoard(game, &board);
+
+  int16_t parent[STATES];
+  uint8_t input[STATES];
+  int16_t queue[STATES];
+  memset(parent, -1, sizeof(parent));
+
+  int start = stateIndex(state->blockRotation, state->positionX - PLACEMENT_MIN_X, state->positionY);
+  int target = stateIndex(move->rotation, move->x - PLACEMENT_MIN_X, move->y);
+  int head = 0, tail = 0;
+  parent[start] = start;
+  queue[tail++] = start;
+
+  while (head < tail && parent[target] < 0) {
+    int current = queue[head++];
+    int y = current % HEIGHT;
+    int i = current / HEIGHT % PLACEMENT_COLUMNS;
+    int r = current / HEIGHT / PLACEMENT_COLUMNS;
+
+    // Same order as a player would try them: slide, turn, then drop
+    int nextRotation = getNextRotation(r);
+    struct { int r, i, y; GameInputs input; } steps[4] = {
+      { r, i - 1, y, INPUT_LEFT },
+      { r, i + 1, y, INPUT_RIGHT },
+      { nextRotation, i, y, INPUT_UP },
+      { r, i, y + 1, INPUT_SOFTDROP },
+    };
+    for (int s = 0; s < 4; s++) {
+      if (steps[s].i < 0 || steps[s].i >= PLACEMENT_COLUMNS || steps[s].y >= HEIGHT) continue;
+      if (!(board.fits[steps[s].r][steps[s].i] >> steps[s].y & 1)) continue;
+
+      int next = stateIndex(steps[s].r, steps[s].i, steps[s].y);
+      if (parent[next] >= 0) continue;
+      parent[next] = current;
+      input[next] = steps[s].input;
+      queue[tail++] = next;
+    }
+  }
+  if (parent[target] < 0) return -1;
+
+  // Walk back from the target, then reverse
+  int length = 0;
+  for (int current = target; current != start; current = parent[current]) {
+    path[length++] = input[current];
+  }
+  for (int a = 0, b = length - 1; a < b; a++, b--) {
+    GameInputs swap = path[a];
+    path[a] = path[b];
+    path[b] = swap;
+  }
+  path[length++] = INPUT_DOWN;
+  return length;
+}
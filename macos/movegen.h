@@ -0,0 +1,48 @@
+// Once-only wrapper
+#ifndef MOVEGEN_H_SEEN
+#define MOVEGEN_H_SEEN
+
+#include "blocks.h"
+#include "defs.h"
+
+/**
+ * Finds every place the current piece can land, using the same moves, rotations and collisions as
+ * game_actionMovement(), game_actionRotate() and game_actionSoftDrop(). Gravity's timing is ignored:
+ * a move is reachable if some sequence of inputs gets there, however slowly.
+ *
+ * Placements that leave the same cells filled (an O in any rotation, S/Z/I turned half way) are
+ * only listed once.
+ */
+
+// Landing rows in one column can't be adjacent, so at most half the rows can be landings
+#define MOVEGEN_MAX_MOVES (4 * PLACEMENT_COLUMNS * ((HEIGHT + 1) / 2))
+
+// Longest input path: every state at most once, then a hard drop
+#define MOVEGEN_MAX_PATH (4 * PLACEMENT_COLUMNS * HEIGHT + 1)
+
+struct Move {
+  int8_t x;
+  int8_t y;
+  uint8_t rotation;
+} typedef Move;
+
+struct MoveList {
+  int count;
+  Move moves[MOVEGEN_MAX_MOVES];
+} typedef MoveList;
+
+/**
+ * List every distinct landing placement for the game's current piece, from where it is now.
+ * Returns the count, 0 if the game is over
+ */
+int movegen_generate(const GameInstance* game, MoveList* list);
+
+/**
+ * Shortest inputs from the current piece position to a move from movegen_generate(): INPUT_LEFT,
+ * INPUT_RIGHT, INPUT_UP and INPUT_SOFTDROP, ending with INPUT_DOWN to hard drop. Returns the length,
+ * or -1 if the move can't be reached. path needs room for MOVEGEN_MAX_PATH inputs
+ */
+int movegen_path(const GameInstance* game, const Move* move, GameInputs* path);
+
+// Once-only wrapper
+#endif // MOVEGEN_H_SEEN
@@ -0,0 +1,473 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "replay.h"
+
+/**
+ * replay.c
+ * ================================================================================================
+ * A replay is a header, a stream of events, then an index of keyframes. Each event packs the
+ * frames since the previous event and a 3 bit GameInputs code into one LEB128 varint:
+ *
+ * varint( (frameDelta << 3) | input )
+ *
+ * so anything within 15 frames of the last event takes a single byte. INPUT_RESTART is followed by
+ * the game's seed as another varint, and INPUT_QUIT marks the end of the stream.
+ *
+ * INPUT_NONE is never recorded as an action, so it marks a keyframe instead: a varint length, then
+ * the frame, GameState and Field (see writeKeyframe). Events are the only thing that change the
+ * game, so the state at the start of interval n is the state before the first event at or after
+ * frame n * interval, and the keyframe is written just before that event. Intervals with no events
+ * in them share the keyframe of the next one that has.
+ *
+ * Header: "NTRP", a version byte, board width and height bytes, varint keyframe interval
+ * Index:  varint count, varint offset delta of each interval's keyframe, then the index's own
+ *         offset as 8 bytes little-endian and "NTIX", so it can be found from the end of the file
+ * ================================================================================================
+ */
+
+#define REPLAY_MAGIC "NTRP"
+#define REPLAY_INDEX_MAGIC "NTIX"
+#define REPLAY_VERSION 3
+#define REPLAY_FOOTER_BYTES 12
+#define INPUT_BITS 3
+#define INPUT_MASK ((1 << INPUT_BITS) - 1)
+#define INPUT_KEYFRAME INPUT_NONE
+#define KEYFRAME_MAX_BYTES (64 + HEIGHT * (ROW_BITS / 8 + (WIDTH + 1) / 2))  // State, then every row with colours
+
+/**
+ * Encoding helpers. Keyframes are built in memory (ByteBuffer) so their length can go first
+ * ================================================================================================
+ */
+
+struct ByteBuffer {
+  uint8_t* bytes;
+  int length;
+  int capacity;
+  bool overflow;
+} typedef ByteBuffer;
+
+static void putBuffer(ByteBuffer* buffer, uint8_t byte) {
+  if (buffer->length == buffer->capacity) {
+    buffer->overflow = true;
+    return;
+  }
+  buffer->bytes[buffer->length++] = byte;
+}
+
+static void putBufferVarint(ByteBuffer* buffer, uint64_t value) {
+  while (value >= 0x80) {
+    putBuffer(buffer, (value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  putBuffer(buffer, value);
+}
+
+static void putBufferSigned(ByteBuffer* buffer, int value) {
+  putBufferVarint(buffer, ((uint32_t) value << 1) ^ (uint32_t) (value >> 31));  // Zigzag
+}
+
+static uint8_t getBuffer(ByteBuffer* buffer) {
+  if (buffer->length == buffer->capacity) {
+    buffer->overflow = true;
+    return 0;
+  }
+  return buffer->bytes[buffer->length++];
+}
+
+static uint64_t getBufferVarint(ByteBuffer* buffer) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t byte = getBuffer(buffer);
+    result |= (uint64_t) (byte & 0x7F) << shift;
+    if (!(byte & 0x80)) break;
+  }
+  return result;
+}
+
+static int getBufferSigned(ByteBuffer* buffer) {
+  uint32_t zigzag = getBufferVarint(buffer);
+  return (int) (zigzag >> 1) ^ -(int) (zigzag & 1);
+}
+
+static void writeByte(ReplayWriter* writer, uint8_t byte) {
+  putc(byte, writer->file);
+  writer->offset++;
+}
+
+static void writeVarint(ReplayWriter* writer, uint64_t value) {
+  while (value >= 0x80) {
+    writeByte(writer, (value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  writeByte(writer, value);
+}
+
+static bool readVarint(FILE* file, uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = getc_unlocked(file);
+    if (byte == EOF) return false;
+
+    result |= (uint64_t) (byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Keyframes
+ * ================================================================================================
+ * Rows are written whole, walls and all, high byte first. Only rows with cells in them carry their
+ * colours, packed two cells to a byte, so an empty board costs ROW_BITS / 8 bytes a row.
+ */
+
+static bool rowHasCells(FieldRow row) {
+  return (row & (FieldRow) ~ROW_EMPTY) != 0;
+}
+
+static void encodeKeyframe(ByteBuffer* buffer, const GameInstance* game, uint32_t frame) {
+  const GameState* state = &game->state;
+  putBufferVarint(buffer, frame);
+  putBufferVarint(buffer, state->blockName);
+  putBufferSigned(buffer, state->blockRotation);
+  putBufferSigned(buffer, state->clearedLines);
+  putBufferVarint(buffer, state->clearedRows);
+  putBufferSigned(buffer, state->points);
+  putBufferSigned(buffer, state->pieces);
+  putBufferSigned(buffer, state->positionX);
+  putBufferSigned(buffer, state->positionY);
+  putBufferVarint(buffer, state->playState);
+  putBufferVarint(buffer, state->seed);
+  putBufferVarint(buffer, state->queue.random);
+  putBuffer(buffer, state->queue.bag);
+  putBuffer(buffer, state->queue.head);
+  for (int i = 0; i < PREVIEW_LENGTH; i++) {
+    putBuffer(buffer, state->queue.preview[i]);
+  }
+
+  for (int y = 0; y < HEIGHT; y++) {
+    FieldRow row = game->field.rows[y];
+    for (int shift = ROW_BITS - 8; shift >= 0; shift -= 8) {
+      putBuffer(buffer, (row >> shift) & 0xFF);
+    }
+    if (!rowHasCells(row)) continue;
+
+    for (int x = 0; x < WIDTH; x += 2) {
+      uint8_t right = x + 1 < WIDTH ? game->field.colours[y][x + 1] : BLOCK_NONE;
+      putBuffer(buffer, (game->field.colours[y][x] << 4) | right);
+    }
+  }
+}
+
+static uint32_t decodeKeyframe(ByteBuffer* buffer, GameInstance* game) {
+  GameState* state = &game->state;
+  uint32_t frame = getBufferVarint(buffer);
+  state->blockName = getBufferVarint(buffer);
+  state->blockRotation = getBufferSigned(buffer);
+  state->clearedLines = getBufferSigned(buffer);
+  state->clearedRows = getBufferVarint(buffer);
+  state->points = getBufferSigned(buffer);
+  state->pieces = getBufferSigned(buffer);
+  state->positionX = getBufferSigned(buffer);
+  state->positionY = getBufferSigned(buffer);
+  state->playState = getBufferVarint(buffer);
+  state->seed = getBufferVarint(buffer);
+  state->queue.random = getBufferVarint(buffer);
+  state->queue.bag = getBuffer(buffer);
+  state->queue.head = getBuffer(buffer);
+  for (int i = 0; i < PREVIEW_LENGTH; i++) {
+    state->queue.preview[i] = getBuffer(buffer);
+  }
+
+  for (int y = 0; y < HEIGHT; y++) {
+    FieldRow row = 0;
+    for (int i = 0; i < ROW_BITS / 8; i++) {
+      row = (FieldRow) (row << 8) | getBuffer(buffer);
+    }
+    game->field.rows[y] = row;
+    if (!rowHasCells(row)) {
+      memset(game->field.colours[y], BLOCK_NONE, sizeof(game->field.colours[y]));
+      continue;
+    }
+
+    for (int x = 0; x < WIDTH; x += 2) {
+      uint8_t pair = getBuffer(buffer);
+      game->field.colours[y][x] = pair >> 4;
+      if (x + 1 < WIDTH) game->field.colours[y][x + 1] = pair & 0xF;
+    }
+  }
+  game_computeFeatures(&game->field, &game->field.features);
+  game->field.hash = game_hashField(&game->field);
+  game->dirtyRows = ALL_FIELD_ROWS;
+  return frame;
+}
+
+/**
+ * Write one keyframe, and point every interval up to and including the one this frame is in at it
+ */
+static void writeKeyframe(ReplayWriter* writer, const GameInstance* game, uint32_t frame) {
+  uint32_t lastInterval = frame / writer->keyframeInterval;
+  if (lastInterval >= writer->keyframeCapacity) {
+    writer->keyframeCapacity = (lastInterval + 1) * 2;
+    writer->keyframes = realloc(writer->keyframes, writer->keyframeCapacity * sizeof(uint64_t));
+    assert(writer->keyframes != NULL);
+  }
+
+  uint32_t keyframeFrame = writer->keyframeCount * writer->keyframeInterval;
+  while (writer->keyframeCount <= lastInterval) {
+    writer->keyframes[writer->keyframeCount++] = writer->offset;
+  }
+
+  uint8_t bytes[KEYFRAME_MAX_BYTES];
+  ByteBuffer buffer = { bytes, 0, sizeof(bytes), false };
+  encodeKeyframe(&buffer, game, keyframeFrame);
+  assert(!buffer.overflow);
+
+  writeVarint(writer, (uint64_t) (keyframeFrame - writer->lastFrame) << INPUT_BITS | INPUT_KEYFRAME);
+  writer->lastFrame = keyframeFrame;
+  writeVarint(writer, buffer.length);
+  for (int i = 0; i < buffer.length; i++) {
+    writeByte(writer, bytes[i]);
+  }
+}
+
+static void writeEvent(ReplayWriter* writer, const GameInstance* game, GameInputs input) {
+  uint32_t frame = game->frame;
+  assert(frame >= writer->lastFrame);
+  if (frame / writer->keyframeInterval >= writer->keyframeCount) {
+    writeKeyframe(writer, game, frame);
+  }
+
+  uint64_t delta = frame - writer->lastFrame;
+  writer->lastFrame = frame;
+  writeVarint(writer, (delta << INPUT_BITS) | input);
+}
+
+/**
+ * Writing
+ * ================================================================================================
+ */
+
+void replay_startWriter(ReplayWriter* writer, FILE* file, uint32_t keyframeInterval) {
+  assert(keyframeInterval > 0);
+  writer->file = file;
+  writer->offset = 0;
+  writer->lastFrame = 0;
+  writer->keyframeInterval = keyframeInterval;
+  writer->keyframes = NULL;
+  writer->keyframeCount = 0;
+  writer->keyframeCapacity = 0;
+
+  for (int i = 0; i < 4; i++) {
+    writeByte(writer, REPLAY_MAGIC[i]);
+  }
+  writeByte(writer, REPLAY_VERSION);
+  writeByte(writer, WIDTH);
+  writeByte(writer, HEIGHT);
+  writeVarint(writer, keyframeInterval);
+}
+
+void replay_record(ReplayWriter* writer, const GameInstance* game, GameInputs input) {
+  writeEvent(writer, game, input);
+}
+
+void replay_recordRestart(ReplayWriter* writer, const GameInstance* game, uint32_t seed) {
+  writeEvent(writer, game, INPUT_RESTART);
+  writeVarint(writer, seed);
+}
+
+void replay_finishWriter(ReplayWriter* writer, const GameInstance* game) {
+  writeEvent(writer, game, INPUT_QUIT);
+
+  uint64_t indexOffset = writer->offset;
+  writeVarint(writer, writer->keyframeCount);
+  uint64_t previous = 0;
+  for (uint32_t i = 0; i < writer->keyframeCount; i++) {
+    writeVarint(writer, writer->keyframes[i] - previous);
+    previous = writer->keyframes[i];
+  }
+  for (int i = 0; i < 8; i++) {
+    writeByte(writer, indexOffset >> (i * 8));
+  }
+  for (int i = 0; i < 4; i++) {
+    writeByte(writer, REPLAY_INDEX_MAGIC[i]);
+  }
+  fflush(writer->file);
+
+  free(writer->keyframes);
+  writer->keyframes = NULL;
+  writer->keyframeCount = 0;
+  writer->keyframeCapacity = 0;
+}
+
+/**
+ * Reading
+ * ================================================================================================
+ */
+
+bool replay_startReader(ReplayReader* reader, FILE* file) {
+  char magic[4];
+  memset(reader, 0, sizeof(ReplayReader));
+  reader->file = file;
+
+  if (fread(magic, 1, sizeof(magic), file) != sizeof(magic)) return false;
+  if (memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0) return false;
+  if (getc(file) != REPLAY_VERSION) return false;
+
+  // Replays only play back on a board the same size
+  if (getc(file) != WIDTH || getc(file) != HEIGHT) return false;
+
+  uint64_t interval;
+  if (!readVarint(file, &interval) || interval == 0) return false;
+  reader->keyframeInterval = interval;
+  return true;
+}
+
+bool replay_openIndex(ReplayReader* reader) {
+  FILE* file = reader->file;
+  long position = ftell(file);
+  uint8_t footer[REPLAY_FOOTER_BYTES];
+
+  if (fseek(file, -REPLAY_FOOTER_BYTES, SEEK_END) != 0) return false;
+  if (fread(footer, 1, sizeof(footer), file) != sizeof(footer)) return false;
+  if (memcmp(footer + 8, REPLAY_INDEX_MAGIC, 4) != 0) return false;
+
+  uint64_t indexOffset = 0;
+  for (int i = 0; i < 8; i++) {
+    indexOffset |= (uint64_t) footer[i] << (i * 8);
+  }
+
+  uint64_t count;
+  if (fseek(file, indexOffset, SEEK_SET) != 0 || !readVarint(file, &count) || count == 0) return false;
+
+  uint64_t* keyframes = malloc(count * sizeof(uint64_t));
+  if (!keyframes) return false;
+
+  uint64_t offset = 0;
+  for (uint64_t i = 0; i < count; i++) {
+    uint64_t delta;
+    if (!readVarint(file, &delta)) {
+      free(keyframes);
+      return false;
+    }
+    offset += delta;
+    keyframes[i] = offset;
+  }
+
+  free(reader->keyframes);
+  reader->keyframes = keyframes;
+  reader->keyframeCount = count;
+  fseek(file, position, SEEK_SET);
+  return true;
+}
+
+void replay_closeReader(ReplayReader* reader) {
+  free(reader->keyframes);
+  reader->keyframes = NULL;
+  reader->keyframeCount = 0;
+}
+
+bool replay_next(ReplayReader* reader, ReplayEvent* event) {
+  if (reader->pending) {
+    reader->pending = false;
+    *event = reader->pendingEvent;
+    return true;
+  }
+  if (reader->finished) return false;
+
+  uint64_t packed;
+  while (true) {
+    if (!readVarint(reader->file, &packed)) return false;
+    reader->frame += packed >> INPUT_BITS;
+    if ((packed & INPUT_MASK) != INPUT_KEYFRAME) break;
+
+    // Playing straight through, so keyframes can be skipped
+    uint64_t length;
+    if (!readVarint(reader->file, &length)) return false;
+    while (length--) {
+      if (getc_unlocked(reader->file) == EOF) return false;
+    }
+  }
+
+  event->frame = reader->frame;
+  event->input = packed & INPUT_MASK;
+  event->seed = 0;
+
+  if (event->input == INPUT_RESTART) {
+    uint64_t seed;
+    if (!readVarint(reader->file, &seed)) return false;
+    event->seed = seed;
+  }
+
+  reader->finished = event->input == INPUT_QUIT;
+  return !reader->finished;
+}
+
+void replay_apply(GameInstance* game, const ReplayEvent* event) {
+  game->frame = event->frame;
+
+  switch (event->input) {
+    case INPUT_LEFT:
+      game_actionMovement(game, MOVE_LEFT);
+      break;
+    case INPUT_RIGHT:
+      game_actionMovement(game, MOVE_RIGHT);
+      break;
+    case INPUT_UP:
+      game_actionRotate(game);
+      break;
+    case INPUT_DOWN:
+      game_actionHardDrop(game);
+      break;
+    case INPUT_SOFTDROP:
+      game_actionSoftDrop(game);
+      break;
+    case INPUT_RESTART:
+      game_actionRestart(game, event->seed);
+      break;
+    default:
+      break;
+  }
+}
+
+bool replay_seek(ReplayReader* reader, GameInstance* game, uint32_t frame) {
+  if (!reader->keyframes) return false;
+
+  uint32_t interval = frame / reader->keyframeInterval;
+  if (interval >= reader->keyframeCount) {
+    interval = reader->keyframeCount - 1;
+  }
+  if (fseek(reader->file, reader->keyframes[interval], SEEK_SET) != 0) return false;
+
+  uint64_t packed, length;
+  if (!readVarint(reader->file, &packed) || (packed & INPUT_MASK) != INPUT_KEYFRAME) return false;
+  if (!readVarint(reader->file, &length) || length > KEYFRAME_MAX_BYTES) return false;
+
+  uint8_t bytes[KEYFRAME_MAX_BYTES];
+  if (fread(bytes, 1, length, reader->file) != length) return false;
+
+  ByteBuffer buffer = { bytes, 0, length, false };
+  reader->frame = decodeKeyframe(&buffer, game);
+  if (buffer.overflow) return false;
+
+  reader->pending = false;
+  reader->finished = false;
+  ReplayEvent event;
+  while (replay_next(reader, &event)) {
+    if (event.frame > frame) {
+      reader->pending = true;
+      reader->pendingEvent = event;
+      break;
+    }
+    replay_apply(game, &event);
+  }
+
+  game->frame = frame;
+  return true;
+}
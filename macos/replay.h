@@ -0,0 +1,94 @@
+// Once-only wrapper
+#ifndef REPLAY_H_SEEN
+#define REPLAY_H_SEEN
+
+#include <stdio.h>
+
+#include "defs.h"
+
+/**
+ * Replays record the seed and every action, rather than the board, and are re-simulated to play
+ * back. Keyframes of the whole game state every so many frames, and an index of them at the end of
+ * the file, let playback jump anywhere without starting from frame zero. See replay.c for the
+ * format.
+ */
+
+#define REPLAY_KEYFRAME_INTERVAL 600  // Ten seconds at 60fps
+
+struct ReplayWriter {
+  FILE* file;
+  uint64_t offset;         // Bytes written so far
+  uint32_t lastFrame;
+  uint32_t keyframeInterval;
+  uint64_t* keyframes;     // File offset of the keyframe for each interval
+  uint32_t keyframeCount;
+  uint32_t keyframeCapacity;
+};
+
+struct ReplayEvent {
+  uint32_t frame;
+  GameInputs input;  // INPUT_LEFT, _RIGHT, _UP (rotate), _DOWN (hard drop), _SOFTDROP or _RESTART
+  uint32_t seed;     // Only for INPUT_RESTART
+} typedef ReplayEvent;
+
+struct ReplayReader {
+  FILE* file;
+  uint32_t frame;
+  uint32_t keyframeInterval;
+  uint64_t* keyframes;     // Only after replay_openIndex()
+  uint32_t keyframeCount;
+  bool finished;
+  bool pending;            // replay_seek() read one event too far, and kept it here
+  ReplayEvent pendingEvent;
+} typedef ReplayReader;
+
+/**
+ * Write the header. Attach the writer with game_setRecorder() to record a game. A keyframe is
+ * written every keyframeInterval frames (REPLAY_KEYFRAME_INTERVAL is a good default)
+ */
+void replay_startWriter(ReplayWriter* writer, FILE* file, uint32_t keyframeInterval);
+
+void replay_record(ReplayWriter* writer, const GameInstance* game, GameInputs input);
+
+void replay_recordRestart(ReplayWriter* writer, const GameInstance* game, uint32_t seed);
+
+/**
+ * Write the end marker and the keyframe index. Doesn't close the file
+ */
+void replay_finishWriter(ReplayWriter* writer, const GameInstance* game);
+
+/**
+ * Check the header. Returns false if this isn't a replay (or is from another version, or board size)
+ */
+bool replay_startReader(ReplayReader* reader, FILE* file);
+
+/**
+ * Load the keyframe index from the end of the file, which must be seekable. Returns false if the
+ * index is missing, e.g. the recording was never finished
+ */
+bool replay_openIndex(ReplayReader* reader);
+
+/**
+ * Free the index. Doesn't close the file
+ */
+void replay_closeReader(ReplayReader* reader);
+
+/**
+ * Read the next event. Returns false at the end marker, or if the stream is cut short
+ */
+bool replay_next(ReplayReader* reader, ReplayEvent* event);
+
+/**
+ * Apply an event to a game through the usual game_action* functions
+ */
+void replay_apply(GameInstance* game, const ReplayEvent* event);
+
+/**
+ * Put the game in the state it was in at this frame: restore the keyframe at or before it, then
+ * apply at most one interval's worth of events. replay_next() carries on from there. Needs
+ * replay_openIndex(). The draw field isn't restored, call game_updateDrawState() after
+ */
+bool replay_seek(ReplayReader* reader, GameInstance* game, uint32_t frame);
+
+// Once-only wrapper
+#endif // REPLAY_H_SEEN
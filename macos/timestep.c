@@ -0,0 +1,43 @@
+#include <assert.h>
+
+#include "timestep.h"
+
+/**
+ * timestep.c
+ * ================================================================================================
+ * One step is frequency / stepsPerSecond counter ticks, which usually isn't a whole number (a
+ * nanosecond counter at 60 steps a second gives 16666666.67). Scaling the accumulator by
+ * stepsPerSecond makes a step exactly 'frequency' units, so every step is the same length and
+ * a minute of real time is always 3600 steps.
+ * ================================================================================================
+ */
+
+void timestep_init(Timestep* timestep, uint64_t frequency, int stepsPerSecond, int maxSteps, uint64_t now) {
+  assert(frequency > 0 && stepsPerSecond > 0 && maxSteps > 0);
+  *timestep = (Timestep) {
+    .frequency = frequency,
+    .stepsPerSecond = stepsPerSecond,
+    .last = now,
+    .maxSteps = maxSteps,
+  };
+}
+
+int timestep_advance(Timestep* timestep, uint64_t now) {
+  timestep->accumulator += (now - timestep->last) * timestep->stepsPerSecond;
+  timestep->last = now;
+
+  uint64_t due = timestep->accumulator / timestep->frequency;
+  timestep->accumulator -= due * timestep->frequency;
+  if (due > (uint64_t) timestep->maxSteps) {
+    timestep->dropped += due - timestep->maxSteps;
+    due = timestep->maxSteps;
+  }
+
+  timestep->steps += due;
+  return due;
+}
+
+uint64_t timestep_untilNext(const Timestep* timestep) {
+  uint64_t remaining = timestep->frequency - timestep->accumulator;
+  return (remaining + timestep->stepsPerSecond - 1) / timestep->stepsPerSecond;
+}
@@ -0,0 +1,43 @@
+// Once-only wrapper
+#ifndef TIMESTEP_H_SEEN
+#define TIMESTEP_H_SEEN
+
+#include <stdint.h>
+
+/**
+ * Fixed timestep scheduler. The game advances in steps of exactly 1 / stepsPerSecond, however
+ * often the front-end renders: each frame, timestep_advance() adds the time since the last call to
+ * an accumulator and says how many whole steps are due. A slow frame runs several steps to catch
+ * up, a fast one none. Because gravity and replays count steps, not frames, the same inputs on
+ * the same steps play the same game at any frame rate.
+ *
+ * Times are in the caller's counter ticks (e.g. SDL_GetPerformanceCounter()). The accumulator is
+ * kept in ticks * stepsPerSecond, so steps land exactly with no rounding drift. After a long stall
+ * (a debugger, a sleeping laptop) at most maxSteps run at once and the rest of the backlog is
+ * dropped, rather than the game racing to catch up.
+ */
+
+struct Timestep {
+  uint64_t frequency;       // Counter ticks per second
+  uint64_t stepsPerSecond;
+  uint64_t accumulator;     // Time not yet stepped, in ticks * stepsPerSecond
+  uint64_t last;            // Counter at the last call
+  int maxSteps;
+  uint64_t steps;           // Steps run so far
+  uint64_t dropped;         // Steps skipped after stalls
+} typedef Timestep;
+
+void timestep_init(Timestep* timestep, uint64_t frequency, int stepsPerSecond, int maxSteps, uint64_t now);
+
+/**
+ * Account for the time since the last call. Returns the steps to run now, 0 to maxSteps
+ */
+int timestep_advance(Timestep* timestep, uint64_t now);
+
+/**
+ * Counter ticks until the next step is due, for front-ends that sleep rather than wait on vsync
+ */
+uint64_t timestep_untilNext(const Timestep* timestep);
+
+// Once-only wrapper
+#endif // TIMESTEP_H_SEEN
@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "transposition.h"
+
+_Static_assert(sizeof(TTEntry) == 16, "TTEntry should be 16 bytes");
+_Static_assert(sizeof(TTBucket) == 64, "TTBucket should be one cache line");
+
+/**
+ * Low bits pick the bucket. Zero marks an empty entry, so key zero is stored as one
+ */
+static uint64_t toKey(uint64_t hash) {
+  return hash ? hash : 1;
+}
+
+static TTBucket* getBucket(const TranspositionTable* table, uint64_t key) {
+  return &table->buckets[key & table->bucketMask];
+}
+
+/**
+ * Entries from the current search beat older ones, then deeper beats shallower
+ */
+static int getWorth(const TranspositionTable* table, const TTEntry* entry) {
+  int age = (table->generation - TT_ENTRY_GENERATION(entry)) & (TT_GENERATIONS - 1);
+  return -age * (TT_MAX_DEPTH + 1) + TT_ENTRY_DEPTH(entry);
+}
+
+/**
+ * Public functions
+ * ============================================================================
+ */
+
+bool tt_init(TranspositionTable* table, size_t bytes) {
+  memset(table, 0, sizeof(TranspositionTable));
+  size_t buckets = 1;
+  while (buckets * 2 * sizeof(TTBucket) <= bytes) {
+    buckets *= 2;
+  }
+
+  table->buckets = aligned_alloc(sizeof(TTBucket), buckets * sizeof(TTBucket));
+  if (!table->buckets) return false;
+  table->bucketMask = buckets - 1;
+  tt_clear(table);
+  return true;
+}
+
+void tt_free(TranspositionTable* table) {
+  free(table->buckets);
+  table->buckets = NULL;
+}
+
+void tt_clear(TranspositionTable* table) {
+  memset(table->buckets, 0, tt_bytes(table));
+}
+
+void tt_newSearch(TranspositionTable* table) {
+  table->generation = (table->generation + 1) & (TT_GENERATIONS - 1);
+}
+
+bool tt_isCurrent(const TranspositionTable* table, const TTEntry* entry) {
+  return TT_ENTRY_GENERATION(entry) == table->generation;
+}
+
+const TTEntry* tt_probe(TranspositionTable* table, uint64_t hash) {
+  uint64_t key = toKey(hash);
+  TTBucket* bucket = getBucket(table, key);
+  table->stats.probes++;
+  for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+    if (bucket->entries[i].key == key) {
+      table->stats.hits++;
+      return &bucket->entries[i];
+    }
+  }
+  return NULL;
+}
+
+void tt_store(TranspositionTable* table, uint64_t hash, int depth, int32_t score, Move move) {
+  uint64_t key = toKey(hash);
+  TTBucket* bucket = getBucket(table, key);
+  table->stats.stores++;
+
+  // Same key or an empty entry first, else the least worth keeping
+  TTEntry* target = &bucket->entries[0];
+  for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+    TTEntry* entry = &bucket->entries[i];
+    if (entry->key == key || !entry->key) {
+      target = entry;
+      break;
+    }
+    if (getWorth(table, entry) < getWorth(table, target)) target = entry;
+  }
+  if (target->key && target->key != key) table->stats.replacements++;
+
+  *target = (TTEntry) {
+    .key = key,
+    .score = score,
+    .move = move,
+    .info = (depth < TT_MAX_DEPTH ? depth : TT_MAX_DEPTH) | table->generation << 4,
+  };
+}
+
+void tt_resetStats(TranspositionTable* table) {
+  table->stats = (TTStats) { 0 };
+}
+
+size_t tt_bytes(const TranspositionTable* table) {
+  return (table->bucketMask + 1) * sizeof(TTBucket);
+}
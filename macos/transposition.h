@@ -0,0 +1,92 @@
+// Once-only wrapper
+#ifndef TRANSPOSITION_H_SEEN
+#define TRANSPOSITION_H_SEEN
+
+#include <stddef.h>
+
+#include "defs.h"
+#include "movegen.h"
+
+/**
+ * Fixed-size table of search results keyed by 64 bit hashes (see game_hashField()). Entries are
+ * grouped four to a 64 byte bucket, one cache line, and a key only ever lives in its own bucket, so
+ * a probe touches one line. When a bucket is full, a store replaces the entry from the oldest
+ * search, then the shallowest.
+ *
+ * Call tt_newSearch() at the start of each search. Entries from earlier searches still hit;
+ * tt_isCurrent() tells them apart.
+ */
+
+#define TT_BUCKET_ENTRIES 4
+#define TT_MAX_DEPTH 15
+#define TT_GENERATIONS 16
+
+struct TTEntry {
+  uint64_t key;  // 0 for an empty entry
+  int32_t score;
+  Move move;
+  uint8_t info;  // Depth in the low four bits, search generation in the high four
+} typedef TTEntry;
+
+#define TT_ENTRY_DEPTH(entry) ((entry)->info & 15)
+#define TT_ENTRY_GENERATION(entry) ((entry)->info >> 4)
+
+struct TTBucket {
+  _Alignas(64) TTEntry entries[TT_BUCKET_ENTRIES];
+} typedef TTBucket;
+
+/**
+ * Counters since tt_init() or tt_resetStats(), for sizing the table: hits / probes is the hit
+ * rate, and replacements (live entries overwritten by a different key) climbing means it's too
+ * small
+ */
+struct TTStats {
+  uint64_t probes;
+  uint64_t hits;
+  uint64_t stores;
+  uint64_t replacements;
+} typedef TTStats;
+
+struct TranspositionTable {
+  TTBucket* buckets;
+  size_t bucketMask;  // Bucket count - 1, a power of two
+  uint8_t generation;  // Mod TT_GENERATIONS
+  TTStats stats;
+} typedef TranspositionTable;
+
+/**
+ * Allocate the largest power-of-two number of buckets that fits in bytes (at least one). Returns
+ * false if allocation fails
+ */
+bool tt_init(TranspositionTable* table, size_t bytes);
+
+void tt_free(TranspositionTable* table);
+
+/**
+ * Empty every bucket, keeping the allocation
+ */
+void tt_clear(TranspositionTable* table);
+
+void tt_newSearch(TranspositionTable* table);
+
+/**
+ * The entry for key, or NULL. The pointer is only good until the next store
+ */
+const TTEntry* tt_probe(TranspositionTable* table, uint64_t key);
+
+/**
+ * Whether the entry was stored since the last tt_newSearch()
+ */
+bool tt_isCurrent(const TranspositionTable* table, const TTEntry* entry);
+
+/**
+ * Store a result for key at depth (0 to TT_MAX_DEPTH), over any entry already there for the key
+ */
+void tt_store(TranspositionTable* table, uint64_t key, int depth, int32_t score, Move move);
+
+void tt_resetStats(TranspositionTable* table);
+
+size_t tt_bytes(const TranspositionTable* table);
+
+// Once-only wrapper
+#endif // TRANSPOSITION_H_SEEN
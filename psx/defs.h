@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <psxgpu.h>
 
@@ -17,6 +18,22 @@
 #define SIZE_PADDING 20
 #define GRID_BIT_OFFSET 0x8000
 
+// Field rows are bitboards: one bit per cell, read left-to-right from 0x8000 like the shape hexes.
+// Three solid 'wall' columns either side of the playable columns mean a shape hanging off the
+// field overlaps a wall bit, so bounds and overlap checks are the same AND.
+//
+// |www|cccccccccc|www|  (w = wall, c = cell)
+#define WALL_BITS 3
+#define ROW_FULL 0xFFFF
+#define ROW_LEFT_WALL (ROW_FULL << (16 - WALL_BITS) & ROW_FULL)
+#define ROW_RIGHT_WALL (ROW_FULL >> (16 - WALL_BITS))
+#define ROW_EMPTY (ROW_LEFT_WALL | ROW_RIGHT_WALL)
+#define ROW_CELL_BIT(x) (GRID_BIT_OFFSET >> (WALL_BITS + (x)))
+
+#if WIDTH + (2 * WALL_BITS) != 16
+#error "Field rows must be exactly 16 bits wide"
+#endif
+
 // Shim for max/min, just don't use with assignments like i++,j++
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
@@ -80,6 +97,26 @@ typedef enum BlockNames {
 
 typedef int16_t ShapeBits;
 typedef int RotationN;
+typedef uint16_t FieldRow;
+
+#define PLACEMENT_MIN_X (-WALL_BITS)
+#define PLACEMENT_COLUMNS (WIDTH + WALL_BITS)
+
+typedef enum PlacementWalls {
+  PLACEMENT_LEFTWALL = 1,
+  PLACEMENT_RIGHTWALL = 2
+} PlacementWalls;
+
+// A shape at a given x: its rows shifted ready to AND against field rows, the bounding box of its
+// cells within the 4x4 grid, and which walls (if any) it overlaps at that x
+typedef struct {
+  FieldRow rows[4];
+  int8_t top;
+  int8_t bottom;
+  int8_t left;
+  int8_t right;
+  uint8_t walls;
+} ShapePlacement;
 
 typedef enum PlayStates {
   PLAY_PLAYING,
@@ -108,19 +145,141 @@ typedef enum GameCollisions {
   COLLIDE_CELL
 } GameCollisions;
 
+// What fills a cell, as a BlockNames value. A byte rather than the enum's four, so the field's
+// colours and the draw field take 500 bytes of the PSX's 2 MB between them instead of 2000
+typedef uint8_t CellColour;
+
 // Full field of 'settled' squares. Two hidden rows at the top 'absorb' rotations of items just spawned in
-typedef BlockNames Field[HEIGHT][WIDTH];
+// Collisions only look at the occupancy rows; the colours are kept for drawing
+typedef struct {
+  FieldRow rows[HEIGHT];
+  CellColour colours[HEIGHT][WIDTH];
+} Field;
 
 // Field plus active piece, but minus hidden rows
-typedef BlockNames DrawField[HEIGHT - HIDDEN_ROWS][WIDTH];
+typedef CellColour DrawField[HEIGHT - HIDDEN_ROWS][WIDTH];
 
+// Upcoming pieces, plus the random state used to draw more (see blocks.c)
+#define PREVIEW_LENGTH 6
+
+typedef struct {
+  uint32_t random;                  // xorshift32 state, never zero
+  uint8_t bag;                      // Pieces left in the 7-bag, bit (1 << (block - 1))
+  uint8_t head;                     // Index of the next piece in preview
+  uint8_t preview[PREVIEW_LENGTH];  // Ring buffer of upcoming BlockNames
+} PieceQueue;
+
+// Fixed-width fields, widest first so nothing pads between them (36 bytes, down from 48)
 struct GameState {
-  BlockNames blockName;
-  int blockRotation;
-  int clearedLines;
-  int points;
-  int positionX;
-  int positionY;
-  PlayStates playState;
+  uint32_t seed;        // Seed this game's pieces were drawn from
+  uint32_t clearedRows; // Rows cleared by the last piece to land, as bits (1 << y)
+  int32_t clearedLines;
+  int32_t points;
+  PieceQueue queue;
+  uint8_t blockName;    // BlockNames
+  uint8_t blockRotation;
+  int8_t positionX;
+  int8_t positionY;
+  uint8_t playState;    // PlayStates
+  uint8_t spare[3];
 } typedef GameState;
 
+// Everything that affects play, bit-packed for search and rollback to copy around (60 bytes).
+// Occupancy is ten bits a row (no walls), top row first; cell colours aren't kept. See game_snapshot()
+#define SNAPSHOT_CELL_BYTES ((HEIGHT * WIDTH + 7) / 8)
+
+typedef struct {
+  uint32_t random;       // PieceQueue random
+  uint32_t queue;        // PieceQueue preview (3 bits each), then bag, then head
+  uint32_t seed;
+  uint32_t clearedRows;
+  uint32_t clearedLines;
+  uint32_t points;
+  uint8_t cells[SNAPSHOT_CELL_BYTES];
+  uint8_t piece;         // blockName, blockRotation << 3, playState << 5
+  int8_t positionX;
+  int8_t positionY;
+} GameSnapshot;
+
+// What the engine did, for front-ends to react to instead of re-reading state (see game/events.h)
+#define EVENTS_CAPACITY 32  // Power of two
+
+typedef enum GameEventTypes {
+  EVENT_RESTART,   // data is the seed
+  EVENT_SPAWN,     // A new piece at its spawn position
+  EVENT_MOVE,      // The piece moved: left, right, a soft drop, or a hard drop before it locks
+  EVENT_ROTATE,
+  EVENT_LOCK,      // The piece locked where it is, before any lines clear
+  EVENT_LINES,     // data is the rows cleared, as bits (1 << y)
+  EVENT_GAMEOVER
+} GameEventTypes;
+
+// Piece fields are the current piece after the event (for EVENT_LOCK, the piece that locked)
+typedef struct {
+  uint32_t data;
+  uint8_t type;
+  uint8_t blockName;
+  uint8_t blockRotation;
+  int8_t positionX;
+  int8_t positionY;
+} GameEvent;
+
+// Ring of events: the game pushes at tail, one consumer pops at head. Both count up and wrap
+typedef struct {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t dropped;  // Events that didn't fit because the consumer fell behind
+  GameEvent events[EVENTS_CAPACITY];
+} EventQueue;
+
+// Buttons as they went down and up, for the game to play back with auto shift (see game/input.h).
+// Times are microseconds
+#define INPUT_CAPACITY 32              // Power of two
+#define INPUT_DEFAULT_DAS_US 167000    // 10 frames
+#define INPUT_DEFAULT_ARR_US 33000     // 2 frames
+
+typedef struct {
+  uint32_t time;
+  uint8_t input;     // GameInputs
+  uint8_t pressed;
+} InputEvent;
+
+// An action for the game at the time it's due. Auto shifts are repeats, and with arr 0 go to the wall
+typedef struct {
+  uint32_t time;
+  GameInputs input;
+  bool repeat;
+  bool toWall;
+} InputAction;
+
+typedef struct {
+  InputEvent events[INPUT_CAPACITY];
+  uint32_t head;
+  uint32_t tail;
+  uint32_t dropped;
+  uint32_t das;
+  uint32_t arr;
+  uint32_t last;        // Time of the last event pushed
+  uint8_t held;         // Queued buttons down, as bits (1 << input)
+  uint8_t shift;        // INPUT_LEFT or INPUT_RIGHT while one auto shifts, else INPUT_NONE
+  bool charged;         // The delay has passed
+  uint32_t shiftAt;     // When it next shifts
+  uint32_t slidUntil;   // With arr 0, the last time it slid to the wall
+} InputQueue;
+
+#define ALL_FIELD_ROWS ((uint32_t) ((1ull << HEIGHT) - 1))
+
+// One running game: settled field, draw state and game state. Declared here (rather than hidden in
+// game.c) so callers can allocate instances wherever they like and pass them to game_* functions
+typedef struct {
+  Field field;
+  DrawField drawField;
+  GameState state;
+  uint32_t dirtyRows;      // Field rows changed since the last game_updateDrawState(), as bits (1 << y)
+  uint32_t drawnPiece;     // The piece it last drew, packed, and the field rows it covers
+  uint32_t drawnRows;
+  uint32_t drawDirtyRows;  // Draw rows it last rewrote, as bits (1 << y) for drawField[y]
+  EventQueue* events;      // Gets what happens when set
+  InputQueue* inputs;      // Buttons for game_applyInputs()
+} GameInstance;
+
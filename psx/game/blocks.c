@@ -1,5 +1,5 @@
 #include <assert.h>
-#include <psxapi.h>
+#include <stdbool.h>
 #include <stdlib.h>
 
 #include "blocks.h"
@@ -33,17 +33,72 @@
  * 
  * Therefore to get x,y = BITS & (0x8000 >> ((row * 4) + col))
  *
+ * Field rows are read from 0x8000 in the same way, so to line a shape row up with a field row we
+ * move it to the top nibble, then shift right by the wall width plus the x position. The placement
+ * table below does this ahead of time for every x
+ *
+ */
+
+#define SHAPE_HEXES(BLOCK) \
+  BLOCK(0, 0, 0, 0)                     /* NONE */ \
+  BLOCK(0x0F00, 0x4444, 0x0F00, 0x4444) /* I */ \
+  BLOCK(0xE200, 0x44C0, 0x8E00, 0xC880) /* J */ \
+  BLOCK(0xE800, 0xC440, 0x2E00, 0x88C0) /* L */ \
+  BLOCK(0xCC00, 0xCC00, 0xCC00, 0xCC00) /* O */ \
+  BLOCK(0x6C00, 0x8C40, 0x6C00, 0x8C40) /* S */ \
+  BLOCK(0x0E40, 0x4C40, 0x4E00, 0x4640) /* T */ \
+  BLOCK(0x4C80, 0xC600, 0x4C80, 0xC600) /* Z */
+
+#define AS_SHAPE_HEXES(r0, r1, r2, r3) { r0, r1, r2, r3 },
+
+static ShapeBits shapeHexes[8][4] = { SHAPE_HEXES(AS_SHAPE_HEXES) };
+
+/**
+ * PLACEMENT TABLE
+ * ================================================================================================
+ * Every block, rotation and x position, expanded by the preprocessor from the same SHAPE_HEXES
+ * list as above (so the two can't drift apart). Moves and rotations then only need a lookup plus
+ * one AND per occupied row, rather than 16 shifts and masks.
+ *
+ * Empty shapes get an inverted bounding box (top 4, bottom -1) so that row loops don't run
  */
 
-static ShapeBits shapeHexes[8][4] = {
-  { 0 },                              // NONE
-  { 0x0F00, 0x4444, 0x0F00, 0x4444 }, // I
-  { 0xE200, 0x44C0, 0x8E00, 0xC880 }, // J
-  { 0xE800, 0xC440, 0x2E00, 0x88C0 }, // L
-  { 0xCC00, 0xCC00, 0xCC00, 0xCC00 }, // O
-  { 0x6C00, 0x8C40, 0x6C00, 0x8C40 }, // S
-  { 0x0E40, 0x4C40, 0x4E00, 0x4640 }, // T
-  { 0x4C80, 0xC600, 0x4C80, 0xC600 }, // Z
+#define SHAPE_ROW(s, y, x) ((((s) << ((y) * 4)) & 0xF000) >> (WALL_BITS + (x)))
+#define SHAPE_COLUMNS(s) (((s) | ((s) << 4) | ((s) << 8) | ((s) << 12)) & 0xF000)
+
+#define SHAPE_TOP(s) \
+  ((s) & 0xF000 ? 0 : (s) & 0x0F00 ? 1 : (s) & 0x00F0 ? 2 : (s) & 0x000F ? 3 : 4)
+#define SHAPE_BOTTOM(s) \
+  ((s) & 0x000F ? 3 : (s) & 0x00F0 ? 2 : (s) & 0x0F00 ? 1 : (s) & 0xF000 ? 0 : -1)
+#define SHAPE_LEFT(s) \
+  ((s) & 0x8888 ? 0 : (s) & 0x4444 ? 1 : (s) & 0x2222 ? 2 : (s) & 0x1111 ? 3 : 4)
+#define SHAPE_RIGHT(s) \
+  ((s) & 0x1111 ? 3 : (s) & 0x2222 ? 2 : (s) & 0x4444 ? 1 : (s) & 0x8888 ? 0 : -1)
+
+#define SHAPE_WALLS(s, x) ( \
+  ((SHAPE_COLUMNS(s) >> (WALL_BITS + (x))) & ROW_LEFT_WALL ? PLACEMENT_LEFTWALL : 0) | \
+  ((SHAPE_COLUMNS(s) >> (WALL_BITS + (x))) & ROW_RIGHT_WALL ? PLACEMENT_RIGHTWALL : 0) \
+)
+
+#define PLACEMENT(s, x) { \
+  { SHAPE_ROW(s, 0, x), SHAPE_ROW(s, 1, x), SHAPE_ROW(s, 2, x), SHAPE_ROW(s, 3, x) }, \
+  SHAPE_TOP(s), SHAPE_BOTTOM(s), SHAPE_LEFT(s), SHAPE_RIGHT(s), \
+  SHAPE_WALLS(s, x) \
+}
+
+// One per x from -WALL_BITS to WIDTH - 1 (the 16 bit rows pin WIDTH to 10)
+#define PLACEMENTS(s) { \
+  PLACEMENT(s, -3), PLACEMENT(s, -2), PLACEMENT(s, -1), PLACEMENT(s, 0), PLACEMENT(s, 1), \
+  PLACEMENT(s, 2), PLACEMENT(s, 3), PLACEMENT(s, 4), PLACEMENT(s, 5), PLACEMENT(s, 6), \
+  PLACEMENT(s, 7), PLACEMENT(s, 8), PLACEMENT(s, 9) \
+}
+
+#define AS_PLACEMENTS(r0, r1, r2, r3) { \
+  PLACEMENTS(r0), PLACEMENTS(r1), PLACEMENTS(r2), PLACEMENTS(r3) \
+},
+
+static const ShapePlacement shapePlacements[8][4][PLACEMENT_COLUMNS] = {
+  SHAPE_HEXES(AS_PLACEMENTS)
 };
 
 int blocks_getShapeBit(ShapeBits s, int y, int x) {
@@ -62,19 +117,98 @@ ShapeBits blocks_getBlockShape(BlockNames block, RotationN r) {
   return shapeHexes[block][r];
 }
 
+const ShapePlacement* blocks_getShapePlacement(BlockNames block, RotationN r, int x) {
+  assert(block >= 0 && block < 8);
+  assert(r >= 0 && r < 4);
+  assert(x >= PLACEMENT_MIN_X && x < WIDTH);
+
+  return &shapePlacements[block][r][x - PLACEMENT_MIN_X];
+}
+
 /**
  * Randomisation
  * ================================================================================================
+ * Each game draws pieces from its own xorshift32 generator, seeded once at the start of the game.
+ * xorshift is only shifts and XORs, which the R3000 does in a cycle each, and the same seed always
+ * gives the same pieces.
+ *
+ * Pieces come out of a 7-bag: all seven once, in random order, then a fresh bag. The bag is a
+ * bitmask of the pieces not drawn yet. Drawn pieces wait in a ring buffer so we can look ahead.
+ */
+
+#define BAG_FULL 0x7F
+
+static uint32_t nextRandom(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/**
+ * Random number in [0, n) without modulo bias (Lemire's multiply-shift, retrying on the short bucket).
+ * The 32x32 -> 64 bit multiply is a single MULTU on the R3000
  */
+static uint32_t randomBelow(uint32_t* state, uint32_t n) {
+  uint64_t product = (uint64_t) nextRandom(state) * n;
+  uint32_t low = (uint32_t) product;
+  if (low < n) {
+    uint32_t threshold = -n % n;
+    while (low < threshold) {
+      product = (uint64_t) nextRandom(state) * n;
+      low = (uint32_t) product;
+    }
+  }
+  return product >> 32;
+}
+
+static BlockNames drawFromBag(PieceQueue* queue) {
+  if (queue->bag == 0) {
+    queue->bag = BAG_FULL;
+  }
+
+  int remaining = 0;
+  for (int bit = 0; bit < 7; bit++) {
+    remaining += (queue->bag >> bit) & 1;
+  }
+
+  uint32_t pick = randomBelow(&queue->random, remaining);
+  for (int bit = 0; bit < 7; bit++) {
+    if (!(queue->bag & (1 << bit))) continue;
+    if (pick-- == 0) {
+      queue->bag &= ~(1 << bit);
+      return bit + 1;
+    }
+  }
+
+  // Should never happen
+  assert(false);
+  return BLOCK_NONE;
+}
+
+void blocks_seedPieces(PieceQueue* queue, uint32_t seed) {
+  // Spread nearby seeds apart, and keep xorshift away from its stuck state of zero
+  seed *= 0x9E3779B9;
+  seed ^= seed >> 16;
+  queue->random = seed ? seed : 0x6D2B79F5;
+
+  queue->bag = 0;
+  queue->head = 0;
+  for (int i = 0; i < PREVIEW_LENGTH; i++) {
+    queue->preview[i] = drawFromBag(queue);
+  }
+}
 
-static int random() {
-  // Pseudo-random number based on function timing (first piece is deterministic)
-  int rootCount = GetRCnt(0);
-  srand(rootCount);
-  int result = rand();
+BlockNames blocks_nextPiece(PieceQueue* queue) {
+  BlockNames block = queue->preview[queue->head];
+  queue->preview[queue->head] = drawFromBag(queue);
+  queue->head = (queue->head + 1) % PREVIEW_LENGTH;
+  return block;
 }
 
-BlockNames blocks_randomBlock() {
-  // Not truly random (has skew) but probably fine for a game
-  return (random() % 7) + 1;
+BlockNames blocks_peekPiece(const PieceQueue* queue, int n) {
+  assert(n >= 0 && n < PREVIEW_LENGTH);
+  return queue->preview[(queue->head + n) % PREVIEW_LENGTH];
 }
@@ -12,4 +12,13 @@ RotationN blocks_getNextRotation(RotationN r);
 
 ShapeBits blocks_getBlockShape(BlockNames block, RotationN r);
 
-BlockNames blocks_randomBlock();
+const ShapePlacement* blocks_getShapePlacement(BlockNames block, RotationN r, int x);
+
+// Reset the queue to the start of the sequence for this seed
+void blocks_seedPieces(PieceQueue* queue, uint32_t seed);
+
+// Take the next piece (and draw another into the preview)
+BlockNames blocks_nextPiece(PieceQueue* queue);
+
+// Look at an upcoming piece without taking it; 0 is the piece blocks_nextPiece() returns next
+BlockNames blocks_peekPiece(const PieceQueue* queue, int n);
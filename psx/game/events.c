@@ -0,0 +1,40 @@
+#include <string.h>
+
+#include "events.h"
+
+/**
+ * EVENTS.C
+ * ############################################################################
+ * Single producer, single consumer ring. Head and tail only count up, so their difference is how
+ * many events are waiting and the low bits are the slot. The game and the UI run in the same loop
+ * on one CPU, so plain loads and stores are enough
+ */
+
+#define SLOT(index) ((index) & (EVENTS_CAPACITY - 1))
+
+void events_init(EventQueue* queue) {
+  memset(queue, 0, sizeof(EventQueue));
+}
+
+bool events_push(EventQueue* queue, const GameEvent* event) {
+  if (queue->tail - queue->head == EVENTS_CAPACITY) {
+    queue->dropped++;
+    return false;
+  }
+
+  queue->events[SLOT(queue->tail)] = *event;
+  queue->tail++;
+  return true;
+}
+
+bool events_pop(EventQueue* queue, GameEvent* event) {
+  if (queue->head == queue->tail) return false;
+
+  *event = queue->events[SLOT(queue->head)];
+  queue->head++;
+  return true;
+}
+
+uint32_t events_dropped(const EventQueue* queue) {
+  return queue->dropped;
+}
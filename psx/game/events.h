@@ -0,0 +1,21 @@
+#include <stdbool.h>
+
+#include "../defs.h"
+
+/**
+ * EVENTS.H
+ * ############################################################################
+ * A fixed ring of what the engine did (see GameEventTypes), so the UI only redoes work when
+ * something changed. Attach a queue with game_setEvents(). When it's full, new events are dropped
+ * and counted; a consumer that sees events_dropped() go up should re-read game->state
+ */
+
+void events_init(EventQueue* queue);
+
+// Returns false (and counts the event as dropped) if the queue is full
+bool events_push(EventQueue* queue, const GameEvent* event);
+
+// Take the oldest event. Returns false if there are none
+bool events_pop(EventQueue* queue, GameEvent* event);
+
+uint32_t events_dropped(const EventQueue* queue);
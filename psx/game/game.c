@@ -3,118 +3,123 @@
 
 #include "../defs.h"
 #include "blocks.h"
+#include "events.h"
+#include "input.h"
 
 /**
  * GAME.C
  * ############################################################################
  * Provides function for executing the game.
  * Expects to receive events via *action functions.
- * Exposes DrawField (graphics state) and GameState (game state) readonly ptrs
+ * All state lives in the GameInstance passed to each function, so games are independent
  */
 
 /**
- * Globals
+ * Private functions
  * ============================================================================
+ * - Only 'mutation' functions should alter the instance state
+ * -
  */
 
-static Field g_field = { 0 };
-static DrawField g_drawField = { 0 };
-static GameState g_gameState = { 
-  .blockName = BLOCK_NONE,
-  .blockRotation = 0,
-  .clearedLines = 0,
-  .points = 0,
-  .positionX = 0,
-  .positionY = 0  
-};
-
 /**
- * Private functions
- * ============================================================================
- * - Only 'mutation' functions should alter the shared state
- * -
+ * Tell the attached event queue, if any, with the piece as it is now
  */
+static void publish(GameInstance* game, GameEventTypes type, uint32_t data) {
+  if (!game->events) return;
+
+  GameEvent event = {
+    .data = data,
+    .type = type,
+    .blockName = game->state.blockName,
+    .blockRotation = game->state.blockRotation,
+    .positionX = game->state.positionX,
+    .positionY = game->state.positionY,
+  };
+  events_push(game->events, &event);
+}
 
-static ShapeBits getCurrentShape() {
-  return blocks_getBlockShape(
-    g_gameState.blockName,
-    g_gameState.blockRotation
-  );
+static const ShapePlacement* getPlacement(const GameInstance* game, RotationN rotation, int x) {
+  return blocks_getShapePlacement(game->state.blockName, rotation, x);
+}
+
+static const ShapePlacement* getCurrentPlacement(const GameInstance* game) {
+  return getPlacement(game, game->state.blockRotation, game->state.positionX);
 }
 
 /**
- * Get drop/spawn collisions for given shape and x/y values
+ * Get drop/spawn collisions for given placement and y value
  */
-static GameCollisions getDropCollision(ShapeBits shape, int x, int y) {
-  // Scan bottom-top left-to-right  
-  for (int row = 3; row >= 0; row--) {
-    for (int col = 0; col <= 3; col++) {
-      int bit = blocks_getShapeBit(shape, row, col);
-      // Is there something in the shape to collide with? Check if it would overlap anything
-      if (bit) {
-        int projectedY = y + row;
-        int projectedX = x + col;
-
-        // Check out of bounds
-        if (projectedY >= HEIGHT) return COLLIDE_BOTTOMWALL;
-          
-        // Check overlap
-        if (g_field[projectedY][projectedX]) return COLLIDE_CELL;
-      }
-    }
+static GameCollisions getDropCollision(const GameInstance* game, const ShapePlacement* placement, int y) {
+  // Check out of bounds
+  if (y + placement->bottom >= HEIGHT) return COLLIDE_BOTTOMWALL;
+
+  // Scan bottom-top, one field row at a time, checking if the shape would overlap anything
+  for (int row = placement->bottom; row >= placement->top; row--) {
+    if (game->field.rows[y + row] & placement->rows[row]) return COLLIDE_CELL;
   }
   return COLLIDE_NONE;
 }
 
 /**
- * Get all collisions for for given shape and x/y values.
- * This covers more cases than getDropCollision() but takes more steps, so it's more 
+ * Get all collisions for for given placement and y value.
+ * This covers more cases than getDropCollision(game) (it tells walls apart from cells), so it's more
  * for validating rotations
  */
-static GameCollisions getCollisions(ShapeBits shape, int x, int y) {
-  for (int row = 0; row <= 3; row++) {
-    for (int col = 0; col <= 3; col++) {
-      int bit = blocks_getShapeBit(shape, row, col);
-      // Is there something in the shape to collide with? Check if it would overlap anything
-      if (bit) {
-        int projectedY = y + row;
-        int projectedX = x + col;
-
-        // Check out of bounds
-        if (projectedX < 0) return COLLIDE_LEFTWALL;
-        if (projectedX >= WIDTH) return COLLIDE_RIGHTWALL;
-        if (projectedY >= HEIGHT) return COLLIDE_BOTTOMWALL;
-
-        // Check overlap
-        if (g_field[projectedY][projectedX]) return COLLIDE_CELL;
-      }
-    }
-  }
-  return COLLIDE_NONE;
+static GameCollisions getCollisions(const GameInstance* game, const ShapePlacement* placement, int y) {
+  // Check out of bounds
+  if (placement->walls & PLACEMENT_LEFTWALL) return COLLIDE_LEFTWALL;
+  if (placement->walls & PLACEMENT_RIGHTWALL) return COLLIDE_RIGHTWALL;
+
+  return getDropCollision(game, placement, y);
+}
+
+/**
+ * Whether the current piece can shift one column
+ */
+static bool canMove(const GameInstance* game, GameMovements movement) {
+  int nextX = game->state.positionX + movement;
+
+  // Check out of bounds
+  // (don't constrain on left, as the left edge of a block's 4x4 grid could be empty. We do a collide check anyway)
+  if (nextX >= WIDTH) return false;
+  if (nextX < -WALL_BITS) return false;
+
+  // Check collisions
+  GameCollisions moveCollision = getCollisions(
+    game,
+    getPlacement(game, game->state.blockRotation, nextX),
+    game->state.positionY
+  );
+  return moveCollision == COLLIDE_NONE;
 }
 
 /**
  * Clear the field grid
  */
-static void mutateField_clear() {
+static void mutateField_clear(GameInstance* game) {
   for (int y = 0; y < HEIGHT; y++) {
+    game->field.rows[y] = ROW_EMPTY;
     for (int x = 0; x < WIDTH; x++) {
-      g_field[y][x] = 0;
+      game->field.colours[y][x] = BLOCK_NONE;
     }
   }
+  game->dirtyRows = ALL_FIELD_ROWS;
 }
 
 /**
  * Insert a block (shape + colours) into the field of static bricks
  */
-static void mutateField_insertBlock(BlockNames blockType, ShapeBits shape, int x, int y) {
-  for (int col = 0; col < 4; col++) {
-    for (int row = 0; row < 4; row++) {
-      int bit = blocks_getShapeBit(shape, col, row);
-      if (bit) {
-        int projectedX = x + row;
-        int projectedY = y + col;
-        g_field[projectedY][projectedX] = blockType;
+static void mutateField_insertBlock(GameInstance* game, BlockNames blockType, const ShapePlacement* placement, int x, int y) {
+  for (int row = placement->top; row <= placement->bottom; row++) {
+    FieldRow mask = placement->rows[row];
+    int projectedY = y + row;
+    game->field.rows[projectedY] |= mask;
+    game->dirtyRows |= 1u << projectedY;
+
+    for (int col = placement->left; col <= placement->right; col++) {
+      int projectedX = x + col;
+      if (mask & ROW_CELL_BIT(projectedX)) {
+        game->field.colours[projectedY][projectedX] = blockType;
       }
     }
   }
@@ -123,61 +128,65 @@ static void mutateField_insertBlock(BlockNames blockType, ShapeBits shape, int x
 /**
  * Update state by spawning a new block
  */
-static GameCollisions mutateState_spawn() {
-  g_gameState.blockName = blocks_randomBlock();
-  g_gameState.blockRotation = 0;
-  g_gameState.positionX = 4;
-  g_gameState.positionY = 0;
+static GameCollisions mutateState_spawn(GameInstance* game) {
+  game->state.blockName = blocks_nextPiece(&game->state.queue);
+  game->state.blockRotation = 0;
+  game->state.positionX = 4;
+  game->state.positionY = 0;
 
   // Shunt initial position based on block type
-  switch (g_gameState.blockName) {
+  switch (game->state.blockName) {
     case BLOCK_I:
       // Spawns horizontally, just above visible area
-      g_gameState.positionX = 3;
-      g_gameState.positionY = 1;
+      game->state.positionX = 3;
+      game->state.positionY = 1;
       break;
     case BLOCK_T:
       // Spawns in T shape, with bottom half visible
-      g_gameState.positionY = 1;
+      game->state.positionY = 1;
       break;
     case BLOCK_J:
     case BLOCK_L:
     case BLOCK_O:
     case BLOCK_S:
     case BLOCK_Z:
-      g_gameState.positionY = 2;
+      game->state.positionY = 2;
       break;
     default:
       // Should never happen
-      assert(g_gameState.blockName != 0);
+      assert(game->state.blockName != 0);
   }
+  publish(game, EVENT_SPAWN, 0);
 
-  ShapeBits shape = getCurrentShape();
   // Does this 'drop' (spawning) create a collision? Triggers game over if so
-  return getDropCollision(shape, g_gameState.positionX, g_gameState.positionY);
+  return getDropCollision(game, getCurrentPlacement(game), game->state.positionY);
 }
 
-static void mutateState_resetGame() {
-  g_gameState.clearedLines = 0;
-  g_gameState.points = 0;
-  g_gameState.playState = PLAY_PLAYING;
-  mutateState_spawn();
+static void mutateState_resetGame(GameInstance* game, uint32_t seed) {
+  game->state.seed = seed;
+  blocks_seedPieces(&game->state.queue, seed);
+  game->state.clearedLines = 0;
+  game->state.clearedRows = 0;
+  game->state.points = 0;
+  game->state.playState = PLAY_PLAYING;
+  mutateState_spawn(game);
 }
 
-static void mutateState_gameOver() {
-  g_gameState.playState = PLAY_GAMEOVER;
+static void mutateState_gameOver(GameInstance* game) {
+  game->state.playState = PLAY_GAMEOVER;
+  publish(game, EVENT_GAMEOVER, 0);
 }
 
-static void mutateState_setRotation(int rotation) {
-  g_gameState.blockRotation = rotation;
+static void mutateState_setRotation(GameInstance* game, int rotation) {
+  game->state.blockRotation = rotation;
 }
 
-static void mutateState_setX(int nextX) {
-  g_gameState.positionX = nextX;
+static void mutateState_setX(GameInstance* game, int nextX) {
+  game->state.positionX = nextX;
 }
 
-static void mutateState_setY(int nextY) {
-  g_gameState.positionY = nextY;
+static void mutateState_setY(GameInstance* game, int nextY) {
+  game->state.positionY = nextY;
 }
 
 /**
@@ -185,14 +194,12 @@ static void mutateState_setY(int nextY) {
  * Success - updates positionY
  * Fail    - returns collision
  */
-static GameCollisions downOne() {
-  int nextX = g_gameState.positionX;
-  int nextY = g_gameState.positionY + 1;
-  ShapeBits shape = getCurrentShape();
+static GameCollisions downOne(GameInstance* game) {
+  int nextY = game->state.positionY + 1;
 
-  GameCollisions collision = getDropCollision(shape, nextX, nextY);
+  GameCollisions collision = getDropCollision(game, getCurrentPlacement(game), nextY);
   if (collision == COLLIDE_NONE) {
-    mutateState_setY(nextY);
+    mutateState_setY(game, nextY);
   }
 
   return collision;
@@ -201,91 +208,164 @@ static GameCollisions downOne() {
 /**
  * Move the piece down as many spaces as possible
  */
-static void downMany() {
+static void downMany(GameInstance* game) {
+  int startY = game->state.positionY;
   GameCollisions collision = COLLIDE_NONE;
   while (collision == COLLIDE_NONE) {
-    collision = downOne();
+    collision = downOne(game);
+  }
+  if (game->state.positionY != startY) {
+    publish(game, EVENT_MOVE, 0);
   }
 }
 
 /**
  * Is line at y full?
  */
-static bool isLineComplete(int y) {
-  BlockNames* line = g_field[y];
+static bool isLineComplete(const GameInstance* game, int y) {
+  return game->field.rows[y] == ROW_FULL;
+}
+
+/**
+ * Copy line 'from' over line 'to'
+ */
+static void mutateField_copyLine(GameInstance* game, int from, int to) {
+  game->field.rows[to] = game->field.rows[from];
+  game->dirtyRows |= 1u << to;
   for (int x = 0; x < WIDTH; x++) {
-    if (!line[x]) return false;
+    game->field.colours[to][x] = game->field.colours[from][x];
   }
-  return true;
 }
 
 /**
- * Clear the line at y, drop the lines above
+ * Blank the line at y
  */
-static void mutateField_clearLine(int row) {
-  // Copy from lines above, except top line
-  for (int y = row; y > 0; y--) {
-    BlockNames* line = g_field[y];
-    BlockNames* lineAbove = g_field[y - 1];
-    for (int x = 0; x < WIDTH; x++) {
-      line[x] = lineAbove[x];
-    }
-  }
-  // Refresh top line
+static void mutateField_emptyLine(GameInstance* game, int y) {
+  game->field.rows[y] = ROW_EMPTY;
+  game->dirtyRows |= 1u << y;
   for (int x = 0; x < WIDTH; x++) {
-    g_field[0][x] = BLOCK_NONE;
+    game->field.colours[y][x] = BLOCK_NONE;
   }
 }
 
 /**
- * Clear as many lines as possible from the field (e.g. after piece settled)
+ * Clear full lines between top and bottom (i.e. the rows the settled piece covers - no others can
+ * have filled up), then drop the lines above in a single pass.
+ * Returns a mask of cleared rows, bit (1 << y) for row y
  */
-static int mutateField_clearLines() {
-  int cleared = 0;
-  for (int y = 0; y < HEIGHT; y++) {
-    bool shouldClear = isLineComplete(y);
-    if (shouldClear) {
-      cleared++;
-      mutateField_clearLine(y);
+static uint32_t mutateField_clearLines(GameInstance* game, int top, int bottom) {
+  uint32_t cleared = 0;
+  int lowest = 0;
+  for (int y = top; y <= bottom; y++) {
+    if (isLineComplete(game, y)) {
+      cleared |= 1u << y;
+      lowest = y;
+    }
+  }
+  if (!cleared) return 0;
+
+  // Lines under the lowest cleared one stay put. Everything above moves down to close the gaps
+  int to = lowest;
+  for (int from = lowest; from >= 0; from--) {
+    if (cleared & (1u << from)) continue;
+    if (from != to) {
+      mutateField_copyLine(game, from, to);
     }
+    to--;
   }
+  // Whatever's left at the top is new, empty space
+  for (; to >= 0; to--) {
+    mutateField_emptyLine(game, to);
+  }
+
   return cleared;
 }
 
+/**
+ * Number of bits set in a row mask
+ */
+static int countRows(uint32_t rows) {
+  int count = 0;
+  for (; rows; rows &= rows - 1) {
+    count++;
+  }
+  return count;
+}
+
 /**
  * Piece has come to a stop; insert into field, check lines, respawn, check game over condition
  */
-static void mutate_commitPiece() {
+static void mutate_commitPiece(GameInstance* game) {
+  const ShapePlacement* placement = getCurrentPlacement(game);
+  int y = game->state.positionY;
+
   // Insert landed piece
   mutateField_insertBlock(
-    g_gameState.blockName,
-    getCurrentShape(),
-    g_gameState.positionX,
-    g_gameState.positionY
+    game,
+    game->state.blockName,
+    placement,
+    game->state.positionX,
+    y
   );
+  publish(game, EVENT_LOCK, 0);
 
   // Clear lines
-  int cleared = mutateField_clearLines();
+  uint32_t clearedRows = mutateField_clearLines(game, y + placement->top, y + placement->bottom);
+  game->state.clearedRows = clearedRows;
 
   // Update score
-  if (cleared) {
-    g_gameState.clearedLines += cleared;
+  if (clearedRows) {
+    game->state.clearedLines += countRows(clearedRows);
+    publish(game, EVENT_LINES, clearedRows);
   }
 
   // Respawn, check game over
-  GameCollisions spawnCollision = mutateState_spawn();
+  GameCollisions spawnCollision = mutateState_spawn(game);
   if (spawnCollision) {
-    mutateState_gameOver();
+    mutateState_gameOver(game);
   }
 }
 
 /**
- * Public values (see header)
+ * Snapshots
  * ============================================================================
  */
 
-DrawField* game_p_drawField = &g_drawField;
-GameState* game_p_state = &g_gameState;
+#define ROW_CELLS(row) (((row) >> WALL_BITS) & ((1 << WIDTH) - 1))
+#define QUEUE_BAG_SHIFT (3 * PREVIEW_LENGTH)
+#define QUEUE_HEAD_SHIFT (QUEUE_BAG_SHIFT + 7)
+
+static uint32_t packQueue(const PieceQueue* queue) {
+  uint32_t packed = 0;
+  for (int i = 0; i < PREVIEW_LENGTH; i++) {
+    packed |= (uint32_t) queue->preview[i] << (3 * i);
+  }
+  return packed | (uint32_t) queue->bag << QUEUE_BAG_SHIFT | (uint32_t) queue->head << QUEUE_HEAD_SHIFT;
+}
+
+static void unpackQueue(PieceQueue* queue, uint32_t random, uint32_t packed) {
+  queue->random = random;
+  for (int i = 0; i < PREVIEW_LENGTH; i++) {
+    queue->preview[i] = (packed >> (3 * i)) & 7;
+  }
+  queue->bag = (packed >> QUEUE_BAG_SHIFT) & 0x7F;
+  queue->head = (packed >> QUEUE_HEAD_SHIFT) & 7;
+}
+
+/**
+ * Set a row's occupancy, clearing the colour of any cell that's now empty
+ */
+static void mutateField_restoreRow(GameInstance* game, int y, FieldRow row) {
+  if (game->field.rows[y] == row) return;
+
+  game->field.rows[y] = row;
+  game->dirtyRows |= 1u << y;
+  for (int x = 0; x < WIDTH; x++) {
+    if (!(row & ROW_CELL_BIT(x))) {
+      game->field.colours[y][x] = BLOCK_NONE;
+    }
+  }
+}
 
 /**
  * Public functions
@@ -293,108 +373,207 @@ GameState* game_p_state = &g_gameState;
  * - 'Actions' are events from outside the game engine, that trigger changes
  */
 
-void game_actionRestart() {
-  mutateField_clear();
-  mutateState_resetGame();
+void game_setEvents(GameInstance* game, EventQueue* events) {
+  game->events = events;
+}
+
+void game_setInputs(GameInstance* game, InputQueue* inputs) {
+  game->inputs = inputs;
+}
+
+void game_actionRestart(GameInstance* game, uint32_t seed) {
+  publish(game, EVENT_RESTART, seed);
+  mutateField_clear(game);
+  mutateState_resetGame(game, seed);
+}
+
+/**
+ * Rows go through a 32 bit accumulator a byte at a time; 64 bit shifts are slow on the R3000
+ */
+void game_snapshot(const GameInstance* game, GameSnapshot* snapshot) {
+  const GameState* state = &game->state;
+  snapshot->random = state->queue.random;
+  snapshot->queue = packQueue(&state->queue);
+  snapshot->seed = state->seed;
+  snapshot->clearedRows = state->clearedRows;
+  snapshot->clearedLines = state->clearedLines;
+  snapshot->points = state->points;
+  snapshot->piece = state->blockName | state->blockRotation << 3 | state->playState << 5;
+  snapshot->positionX = state->positionX;
+  snapshot->positionY = state->positionY;
+
+  uint32_t bits = 0;
+  int bitCount = 0;
+  uint8_t* out = snapshot->cells;
+  for (int y = 0; y < HEIGHT; y++) {
+    bits |= (uint32_t) ROW_CELLS(game->field.rows[y]) << bitCount;
+    for (bitCount += WIDTH; bitCount >= 8; bitCount -= 8) {
+      *out++ = bits;
+      bits >>= 8;
+    }
+  }
+  if (bitCount) *out = bits;
+}
+
+void game_restore(GameInstance* game, const GameSnapshot* snapshot) {
+  GameState* state = &game->state;
+  unpackQueue(&state->queue, snapshot->random, snapshot->queue);
+  state->seed = snapshot->seed;
+  state->clearedRows = snapshot->clearedRows;
+  state->clearedLines = snapshot->clearedLines;
+  state->points = snapshot->points;
+  state->blockName = snapshot->piece & 7;
+  state->blockRotation = (snapshot->piece >> 3) & 3;
+  state->playState = snapshot->piece >> 5;
+  state->positionX = snapshot->positionX;
+  state->positionY = snapshot->positionY;
+
+  uint32_t bits = 0;
+  int bitCount = 0;
+  const uint8_t* in = snapshot->cells;
+  for (int y = 0; y < HEIGHT; y++) {
+    for (; bitCount < WIDTH; bitCount += 8) {
+      bits |= (uint32_t) *in++ << bitCount;
+    }
+    mutateField_restoreRow(game, y, ROW_EMPTY | (bits & ((1 << WIDTH) - 1)) << WALL_BITS);
+    bits >>= WIDTH;
+    bitCount -= WIDTH;
+  }
 }
 
 /**
  * Is the interval between pieces falling, measured in frames
  */
-int32_t game_getSpeed() {
-  int setsCleared = g_gameState.clearedLines / 4;
+int32_t game_getSpeed(const GameInstance* game) {
+  int setsCleared = game->state.clearedLines / 4;
   int level = MAX(MIN(1, setsCleared), 20);
   return 60 - (level * 2);
 }
 
 /**
  * Copies settled pieces and active piece into the DrawField. Call this just before rendering.
+ * Only rows that can have changed are copied: field rows changed since the last call, and if the
+ * piece moved, the rows it covered then and covers now. drawDirtyRows says which. main.c still
+ * draws every row: the GPU clears both framebuffers each frame and the blocks are rebuilt in the
+ * ordering table every time, so there's no last frame to keep the other rows from
  */
-void game_updateDrawState() {
+void game_updateDrawState(GameInstance* game) {
+  const GameState* state = &game->state;
+  const ShapePlacement* placement = getCurrentPlacement(game);
+
+  uint32_t rows = game->dirtyRows;
+  uint32_t piece = state->blockName | state->blockRotation << 3 | (state->positionX - PLACEMENT_MIN_X) << 5
+    | state->positionY << 9;
+  if (piece != game->drawnPiece) {
+    uint32_t pieceRows = 0;
+    if (placement->bottom >= placement->top) {
+      pieceRows = ((1u << (placement->bottom - placement->top + 1)) - 1) << (state->positionY + placement->top);
+    }
+    rows |= game->drawnRows | pieceRows;
+    game->drawnPiece = piece;
+    game->drawnRows = pieceRows;
+  }
+  // Transpose from field, ignoring the topmost two hidden rows
+  rows >>= HIDDEN_ROWS;
+
   for (int y = 0; y < DRAW_HEIGHT; y++) {
+    if (!(rows & (1u << y))) continue;
     for (int x = 0; x < WIDTH; x++) {
-      // Transpose from field, ignoring the topmost two hidden rows
-      g_drawField[y][x] = g_field[y + HIDDEN_ROWS][x];
+      game->drawField[y][x] = game->field.colours[y + HIDDEN_ROWS][x];
     }
   }
 
-  ShapeBits shape = getCurrentShape();
-  BlockNames block = g_gameState.blockName;
-
-  for (int y = 0; y <= 3; y++) {
-    for (int x = 0; x <= 3; x++) {
-      int bit = blocks_getShapeBit(shape, y, x);
-      // Skip if empty bit
-      if (bit == 0) continue;
-
-      // Get projections, bound to field limits (else we will overflow the arrays!)
-      int fieldY = g_gameState.positionY + y;
-      int fieldX = g_gameState.positionX + x;
-
+  // The piece is redrawn whenever a row under it was copied
+  if (rows & (game->drawnRows >> HIDDEN_ROWS)) {
+    for (int y = placement->top; y <= placement->bottom; y++) {
+      int fieldY = state->positionY + y;
       if (fieldY < HIDDEN_ROWS) continue;
-      if (fieldY >= HEIGHT) continue;
-      if (fieldX < 0) continue;
-      if (fieldX >= WIDTH) continue;
 
-      g_drawField[fieldY - HIDDEN_ROWS][fieldX] = block;
+      for (int x = placement->left; x <= placement->right; x++) {
+        int fieldX = state->positionX + x;
+        if (placement->rows[y] & ROW_CELL_BIT(fieldX)) {
+          game->drawField[fieldY - HIDDEN_ROWS][fieldX] = state->blockName;
+        }
+      }
     }
   }
+
+  game->drawDirtyRows = rows;
+  game->dirtyRows = 0;
 }
 
 /**
  * I slam that piece down!
  */
-void game_actionHardDrop() {
-  downMany();
-  mutate_commitPiece();
+void game_actionHardDrop(GameInstance* game) {
+  downMany(game);
+  mutate_commitPiece(game);
 }
 
 /**
  * Gravity pulls the piece down gradually
  */
-void game_actionSoftDrop() {
-  GameCollisions collision = downOne();
+void game_actionSoftDrop(GameInstance* game) {
+  GameCollisions collision = downOne(game);
   if (collision != COLLIDE_NONE) {
-    mutate_commitPiece();
+    mutate_commitPiece(game);
+  } else {
+    publish(game, EVENT_MOVE, 0);
   }
 }
 
 /**
  * I move the piece left or right by +/- 1
  */
-void game_actionMovement(GameMovements movement) {
-  int nextX = g_gameState.positionX + movement;
-
-  // Check out of bounds
-  // (don't constrain on left, as the left edge of a block's 4x4 grid could be empty. We do a collide check anyway)
-  if (nextX >= WIDTH) return;
-
-  // Check collisions
-  GameCollisions moveCollision = getCollisions(
-    getCurrentShape(),
-    nextX,
-    g_gameState.positionY
-  );
-  if (moveCollision != COLLIDE_NONE) return;
+void game_actionMovement(GameInstance* game, GameMovements movement) {
+  if (!canMove(game, movement)) return;
 
   // Otherwise, commit change
-  mutateState_setX(nextX);
+  mutateState_setX(game, game->state.positionX + movement);
+  publish(game, EVENT_MOVE, 0);
 }
 
 /**
  * I rotate the piece clockwise
  */
-void game_actionRotate() {
-  int nextRotation = blocks_getNextRotation(g_gameState.blockRotation);
+void game_actionRotate(GameInstance* game) {
+  int nextRotation = blocks_getNextRotation(game->state.blockRotation);
 
   // Check collisions
   GameCollisions rotationCollision = getCollisions(
-    blocks_getBlockShape(g_gameState.blockName, nextRotation),
-    g_gameState.positionX,
-    g_gameState.positionY
+    game,
+    getPlacement(game, nextRotation, game->state.positionX),
+    game->state.positionY
   );
   if (rotationCollision != COLLIDE_NONE) return;
 
   // Otherwise, commit change
-  mutateState_setRotation(nextRotation);
+  mutateState_setRotation(game, nextRotation);
+  publish(game, EVENT_ROTATE, 0);
+}
+
+bool game_applyInputs(GameInstance* game, uint32_t until) {
+  bool hardDropped = false;
+  InputAction action;
+  while (game->inputs && input_next(game->inputs, until, &action)) {
+    // Keep reading after game over, so held buttons are right on restart
+    if (game->state.playState != PLAY_PLAYING) continue;
+
+    if (action.input == INPUT_LEFT || action.input == INPUT_RIGHT) {
+      GameMovements movement = action.input == INPUT_LEFT ? MOVE_LEFT : MOVE_RIGHT;
+      if (!action.repeat) {
+        game_actionMovement(game, movement);
+      }
+      while (action.repeat && canMove(game, movement)) {
+        game_actionMovement(game, movement);
+        if (!action.toWall) break;
+      }
+    } else if (action.input == INPUT_ROTATE) {
+      game_actionRotate(game);
+    } else if (action.input == INPUT_DROP) {
+      game_actionHardDrop(game);
+      hardDropped = true;
+    }
+  }
+  return hardDropped;
 }
@@ -1,3 +1,4 @@
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "../defs.h"
@@ -7,21 +8,43 @@
  * ############################################################################
  * Provides function for executing the game.
  * Expects to receive events via *action functions.
- * Exposes DrawField (graphics state) and GameState (game state) readonly ptrs
+ * Every function takes the GameInstance to act on. Read game->drawField (graphics state) and
+ * game->state (game state) directly, but treat them as read-only
  */
 
-extern DrawField* game_p_drawField;
-extern GameState* game_p_state;
-
 /**
  * Informs caller how often to call (level speed)
  */
-int32_t game_getSpeed();
+int32_t game_getSpeed(const GameInstance* game);
+
+/**
+ * Push what happens from now on into this queue (NULL to stop), see events.h
+ */
+void game_setEvents(GameInstance* game, EventQueue* events);
+
+/**
+ * Take buttons from this queue (NULL to stop), see input.h
+ */
+void game_setInputs(GameInstance* game, InputQueue* inputs);
+
+/**
+ * Play every press and auto shift due by 'until' as moves, rotations and drops. Returns true if
+ * the piece was hard dropped, so the caller can restart its gravity
+ */
+bool game_applyInputs(GameInstance* game, uint32_t until);
 
 /**
  * Updates draw-state, call before render
  */
-void game_updateDrawState();
+void game_updateDrawState(GameInstance* game);
+
+/**
+ * Pack the game into a snapshot, or put one back, without allocating. Colours are only for drawing,
+ * so restoring clears the colour of each cell that's empty in the snapshot and leaves the rest
+ */
+void game_snapshot(const GameInstance* game, GameSnapshot* snapshot);
+
+void game_restore(GameInstance* game, const GameSnapshot* snapshot);
 
 /**
  * ACTIONS
@@ -32,12 +55,13 @@ void game_updateDrawState();
  * - soft drop (due to ticks)
  */
 
-void game_actionRestart();
+// Start a new game. The same seed always gives the same sequence of pieces
+void game_actionRestart(GameInstance* game, uint32_t seed);
 
-void game_actionHardDrop();
+void game_actionHardDrop(GameInstance* game);
 
-void game_actionSoftDrop();
+void game_actionSoftDrop(GameInstance* game);
 
-void game_actionMovement(GameMovements movement);
+void game_actionMovement(GameInstance* game, GameMovements movement);
 
-void game_actionRotate();
+void game_actionRotate(GameInstance* game);
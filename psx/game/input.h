@@ -0,0 +1,26 @@
+#include <stdbool.h>
+
+#include "../defs.h"
+
+/**
+ * INPUT.H
+ * ############################################################################
+ * Buttons as the player pressed them, for the game to play back in order with delayed auto shift
+ * (das) and auto repeat (arr). pad_poll() reports presses and releases; attach the queue with
+ * game_setInputs() and game_applyInputs() plays them. Holding left or right shifts once, then
+ * after das again every arr, or straight to the wall with arr 0. Only left, right, rotate and drop
+ * are queued
+ */
+
+void input_init(InputQueue* queue, uint32_t das, uint32_t arr);
+
+// Change das and arr. Takes effect from the next press
+void input_setRepeat(InputQueue* queue, uint32_t das, uint32_t arr);
+
+// Returns false if the button isn't queued, or if the queue is full (counted in queue->dropped)
+bool input_press(InputQueue* queue, GameInputs input, uint32_t time);
+
+bool input_release(InputQueue* queue, GameInputs input, uint32_t time);
+
+// Take the next press or auto shift due by 'until', in time order. Returns false once there are none
+bool input_next(InputQueue* queue, uint32_t until, InputAction* action);
@@ -2,9 +2,9 @@
 #include <psxapi.h>
 #include <psxpad.h>
 #include <stdbool.h>
-#include <limits.h>
 
 #include "../defs.h"
+#include "input.h"
 #include "pad.h"
 
 /**
@@ -16,9 +16,19 @@
 // Control input buffer - 2 controllers with 34 bytes each
 uint8_t pads[2][34];
 
-// Input event change polling
+// Buttons down at the last poll, to find what changed
 uint16_t lastBtn = 0;
-uint32_t btnHeldFor = 0;
+
+// Pad buttons the game queues, and what they do
+static const struct {
+  uint16_t button;
+  GameInputs input;
+} queued[] = {
+  { PAD_LEFT, INPUT_LEFT },
+  { PAD_RIGHT, INPUT_RIGHT },
+  { PAD_CIRCLE, INPUT_ROTATE },
+  { PAD_CROSS, INPUT_DROP },
+};
 
 void pad_init() {
   InitPAD(pads[0], 34, pads[1], 34);
@@ -43,35 +53,21 @@ static uint16_t pad_buttons1() {
   return ~ pad->btn;
 }
 
-GameInputs pad_getInput() {
+uint16_t pad_poll(InputQueue* queue, uint32_t time) {
   uint16_t btn = pad_buttons1();
-
-  // Watching for input changes
-  if (btn == lastBtn) {
-    btnHeldFor++;
-  } else {
-    lastBtn = btn;
-    btnHeldFor = 0;
+  uint16_t pressed = btn & ~lastBtn;
+  uint16_t released = lastBtn & ~btn;
+  lastBtn = btn;
+
+  // The game repeats held directions itself (see game/input.h), so only changes are queued
+  if (queue) {
+    for (int i = 0; i < 4; i++) {
+      if (pressed & queued[i].button) input_press(queue, queued[i].input, time);
+      if (released & queued[i].button) input_release(queue, queued[i].input, time);
+    }
   }
 
-  if (btnHeldFor == INT32_MAX) {
-    btnHeldFor = 0;
-  }
-
-  // Actions that don't repeat until the button is re-pressed
-  if (btnHeldFor == 0) {
-    if (btn & PAD_CIRCLE) return INPUT_ROTATE;
-    if (btn & PAD_CROSS) return INPUT_DROP;
-    if (btn & PAD_START) return INPUT_RESTART;
-  }
-
-  // Continuous actions that repeat quickly as the key is held
-  if (btnHeldFor % 15 == 0) {
-    if (btn & PAD_LEFT) return INPUT_LEFT;
-    if (btn & PAD_RIGHT) return INPUT_RIGHT;
-  }
-
- return INPUT_NONE;
+  return pressed;
 }
 
 // printf selected buttons e.g "up, x, L1 pressed"
@@ -92,7 +88,4 @@ void pad_debug() {
   if (btn & PAD_SELECT) printf("sel, ");
   if (btn & PAD_START) printf("start, ");
   if (btn) printf("pressed\n");
-
-  GameInputs parsed = pad_getInput();
-  printf("Parsed input val = %d\n", parsed);
 }
@@ -10,4 +10,7 @@
 
 void pad_debug();
 void pad_init();
-GameInputs pad_getInput();
+
+// Queue the buttons that went down or up since the last poll, at 'time' (microseconds), for the
+// game. Returns the buttons newly down, as PAD_* bits. Pass a NULL queue just to read them
+uint16_t pad_poll(InputQueue* queue, uint32_t time);
@@ -49,6 +49,11 @@ static int32_t titlePattern[5] = {
   0b1001011100100101010111
 };
 
+// What the play screen shows, kept up to date by ui_handleEvent() rather than re-read every frame
+static bool g_isAlive = true;
+static char g_scoreText[10] = "0";
+static char g_linesText[10] = "0";
+
 /**
  * Private functions
  * ============================================================================
@@ -101,16 +106,11 @@ static void renderControls(bool isAlive) {
   }
 }
 
-static void renderScores(int lines, int score) {
-  int y1 = Y_POS(3);
-  int y2 = Y_POS(4);
-  int x2 = TITLE_X + (FONT_GLYPH_SIZE * 6);
-
-  gfx_drawFontString(TITLE_X, y1, MSG_SCORE, 0);
-  gfx_drawFontString(TITLE_X, y2, MSG_LINES, 0);
-
-  char scoreText[10] = "";
-  char linesText[10] = "";
+/**
+ * Format the scores once when they change, not every frame
+ */
+static void formatScores(int lines) {
+  int score = lines * 12;
 
   // Values should wrap at 99999
   while (score >= MAX_SCORE) {
@@ -120,11 +120,19 @@ static void renderScores(int lines, int score) {
     lines -= MAX_SCORE;
   }
 
-  sprintf(scoreText, "%d", score);
-  gfx_drawFontString(x2, y1, scoreText, 0);
+  sprintf(g_scoreText, "%d", score);
+  sprintf(g_linesText, "%d", lines);
+}
 
-  sprintf(linesText, "%d", lines);
-  gfx_drawFontString(x2, y2, linesText, 0);
+static void renderScores() {
+  int y1 = Y_POS(3);
+  int y2 = Y_POS(4);
+  int x2 = TITLE_X + (FONT_GLYPH_SIZE * 6);
+
+  gfx_drawFontString(TITLE_X, y1, MSG_SCORE, 0);
+  gfx_drawFontString(TITLE_X, y2, MSG_LINES, 0);
+  gfx_drawFontString(x2, y1, g_scoreText, 0);
+  gfx_drawFontString(x2, y2, g_linesText, 0);
 }
 
 static void renderKredits() {
@@ -159,14 +167,33 @@ void ui_renderBlock(int u, int v, BlockNames block) {
   gfx_drawBlock(coords, p_colours->main, p_colours->light, p_colours->dark);
 }
 
-void ui_render(GameState* p_gameState) {
-  bool isAlive = p_gameState->playState == PLAY_PLAYING;
-  int score = p_gameState->clearedLines;
+void ui_handleEvent(const GameEvent* p_event, const GameState* p_gameState) {
+  switch (p_event->type) {
+    case EVENT_RESTART:
+      g_isAlive = true;
+      formatScores(0);
+      break;
+    case EVENT_LINES:
+      formatScores(p_gameState->clearedLines);
+      break;
+    case EVENT_GAMEOVER:
+      g_isAlive = false;
+      break;
+    default:
+      break;
+  }
+}
+
+void ui_sync(const GameState* p_gameState) {
+  g_isAlive = p_gameState->playState == PLAY_PLAYING;
+  formatScores(p_gameState->clearedLines);
+}
 
+void ui_render() {
   renderPlayArea();
-  renderTitle(isAlive);
-  renderScores(score, score * 12);
-  renderControls(isAlive);
+  renderTitle(g_isAlive);
+  renderScores();
+  renderControls(g_isAlive);
   renderKredits();
 }
 
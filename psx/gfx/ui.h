@@ -8,7 +8,13 @@
  * High level functions for drawing the play state
  */
 
-void ui_render(GameState* p_gameState);
+// Update what the play screen shows from one of the game's events (see game/events.h)
+void ui_handleEvent(const GameEvent* p_event, const GameState* p_gameState);
+
+// Re-read everything from the state, e.g. after events were dropped
+void ui_sync(const GameState* p_gameState);
+
+void ui_render();
 
 void ui_renderBlock(int u, int v, BlockNames block);
 
@@ -6,17 +6,33 @@
 
 #include <psxapi.h>
 #include <psxgpu.h>
+#include <psxpad.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <limits.h>
 
+#include "game/events.h"
 #include "game/game.h"
+#include "game/input.h"
 #include "game/pad.h"
 #include "gfx/gfx.h"
 #include "gfx/ui.h"
 #include "defs.h"
 
+// Pads are read once a vsync, so presses are timed to the frame. NTSC
+#define FRAME_US 16667
+
+static GameInstance g_game;
+static EventQueue g_events;
+static InputQueue g_inputs;
+static uint32_t g_frames = 0;
+
+// Seed from how many frames the player took to press start, with the root counter for sub-frame timing
+static uint32_t newSeed() {
+  return (g_frames << 16) ^ GetRCnt(0);
+}
+
 int main(int argc, char** argv) {
   // Configure graphics
   gfx_init();
@@ -28,60 +44,63 @@ int main(int argc, char** argv) {
   // Title screen - helps influence RNG
   bool started = false;
   while (!started) {
-    if (pad_getInput() == INPUT_RESTART) {
+    if (pad_poll(NULL, 0) & PAD_START) {
       started = true;
     }
 
     ui_renderTitleScreen();
 
     gfx_endFrame();
+    g_frames++;
   }
 
-  // Set up new game state
-  game_actionRestart();
+  // Set up new game state, with the UI following its events
+  events_init(&g_events);
+  game_setEvents(&g_game, &g_events);
+  input_init(&g_inputs, INPUT_DEFAULT_DAS_US, INPUT_DEFAULT_ARR_US);
+  game_setInputs(&g_game, &g_inputs);
+  uint32_t eventsDropped = 0;
+  game_actionRestart(&g_game, newSeed());
   int tickFrames = 0;
-  int tickSpeed = game_getSpeed();
+  int tickSpeed = game_getSpeed(&g_game);
 
   while (1) {
-    // Take controller input
-    switch (pad_getInput()) {
-      case INPUT_LEFT:
-        game_actionMovement(MOVE_LEFT);
-        break;
-      case INPUT_RIGHT:
-        game_actionMovement(MOVE_RIGHT);
-        break;
-      case INPUT_ROTATE:
-        game_actionRotate();
-        break;
-      case INPUT_DROP:
-        game_actionHardDrop();
-        break;
-      case INPUT_RESTART:
-        if (game_p_state->playState == PLAY_GAMEOVER) {
-          game_actionRestart();
-        }
-        break;
+    // Take controller input. The game plays it, repeating held directions itself
+    uint32_t now = g_frames * FRAME_US;
+    uint16_t pressed = pad_poll(&g_inputs, now);
+    game_applyInputs(&g_game, now);
+    if ((pressed & PAD_START) && g_game.state.playState == PLAY_GAMEOVER) {
+      game_actionRestart(&g_game, newSeed());
     }
 
     // Gravity
     tickFrames++;
     if (tickFrames >= tickSpeed) {
-      if (game_p_state->playState == PLAY_PLAYING) {
-        game_actionSoftDrop();
+      if (g_game.state.playState == PLAY_PLAYING) {
+        game_actionSoftDrop(&g_game);
       }
       tickFrames = 0;
-      tickSpeed = game_getSpeed();
+      tickSpeed = game_getSpeed(&g_game);
+    }
+
+    // Let the UI catch up with what happened this frame
+    GameEvent event;
+    while (events_pop(&g_events, &event)) {
+      ui_handleEvent(&event, &g_game.state);
+    }
+    if (events_dropped(&g_events) != eventsDropped) {
+      eventsDropped = events_dropped(&g_events);
+      ui_sync(&g_game.state);
     }
 
     // Draw UI
-    ui_render(game_p_state);
+    ui_render();
 
     // Draw pieces
-    game_updateDrawState();
+    game_updateDrawState(&g_game);
     for (int y = 0; y < DRAW_HEIGHT; y++) {
       for (int x = 0; x < WIDTH; x++) {
-        BlockNames block = (*game_p_drawField)[y][x];
+        BlockNames block = g_game.drawField[y][x];
         if (block) {
           ui_renderBlock(x, y, block);
         }
@@ -90,6 +109,7 @@ int main(int argc, char** argv) {
 
     // Performs vsync & frameswitch
     gfx_endFrame();
+    g_frames++;
   }
 
   return 0;